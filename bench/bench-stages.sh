@@ -0,0 +1,81 @@
+#!/bin/bash
+# bench-stages.sh - Ejecuta etapas de core-installer.sh contra el disco del benchmark
+#
+# Lo lanza run-bench.sh, una vez por pasada, como proceso propio: las métricas
+# por etapa del script (/proc/$$) tienen que medir este proceso y sus hijos.
+#
+# Uso: bench-stages.sh <dir_salida> <trazar: 0|1>
+# Entorno: LOC_INSTALLER_CONFIG, BENCH_CORE_INSTALLER, BENCH_DISK, BENCH_STAGES
+
+OUT="$1"
+TRACE="${2:-0}"
+
+# Solo funciones y configuración; el punto de entrada no se ejecuta al cargarlo
+source "$BENCH_CORE_INSTALLER"
+
+exec {EVENT_FD}>"$OUT/events.log"
+trap 'stop_rss_sampler; trace_end' EXIT
+
+# ========== ETAPAS ==========
+# Mismas llamadas que main_installation(). Locales, usuario, bootloader y
+# limpieza trabajan dentro del chroot de un sistema real y no se ejecutan.
+DISK="$BENCH_DISK"
+UEFI_MODE="uefi"
+USERNAME="bench"
+CREATE_SWAPFILE="false"
+
+bench_stage_partition() {
+    force_unmount_disk "$DISK"
+    settle_devices
+    partition_disk "$DISK" "$UEFI_MODE" "false" "0" "false"
+}
+
+bench_stage_mount() {
+    mount_partitions "$ROOT_PART" "$HOME_PART" "$BOOT_PART" "$EFI_PART"
+}
+
+bench_stage_copy() {
+    copy_system "$USERNAME"
+}
+
+bench_stage_fstab() {
+    create_fstab
+}
+
+bench_stage_unmount() {
+    unmount_all
+}
+
+# ========== SYSCALLS ==========
+# strace -c enganchado a este proceso (y a los hijos que cree) solo durante la etapa
+TRACE_PID=""
+
+trace_begin() {
+    strace -f -c -o "$1" -p $$ 2>/dev/null &
+    TRACE_PID=$!
+
+    # Esperar a que strace esté enganchado antes de empezar la etapa
+    local i
+    for ((i = 0; i < 50; i++)); do
+        [ "$(awk '/^TracerPid:/ { print $2 }' /proc/$$/status)" != "0" ] && return 0
+        sleep 0.1
+    done
+    warn "strace did not attach, syscall counts for this stage will be missing"
+}
+
+trace_end() {
+    [ -n "$TRACE_PID" ] || return 0
+    kill -INT "$TRACE_PID" 2>/dev/null || true
+    wait "$TRACE_PID" 2>/dev/null || true
+    TRACE_PID=""
+}
+
+# ========== EJECUCIÓN ==========
+for stage in $BENCH_STAGES; do
+    stage_begin "$stage" 0 "bench: $stage"
+    [ "$TRACE" = "1" ] && trace_begin "$OUT/syscalls-$stage.txt"
+    "bench_stage_$stage"
+    trace_end
+done
+
+write_stage_report "$OUT/stages.json"
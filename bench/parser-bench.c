@@ -0,0 +1,176 @@
+/*
+ * parser-bench.c - Microbenchmark del análisis de la salida del instalador
+ *
+ * Repite una salida grabada de core-installer.sh (o de loc-installer-sim)
+ * hasta el número de líneas pedido y la pasa por el mismo camino que recorre
+ * cada línea en el hilo de instalación: lector de líneas sobre un descriptor,
+ * recorte de los '\r' de rsync, event_parse() para las líneas LOC1 y
+ * ui_queue_push() para el resto. El anillo se vacía aquí mismo cuando se
+ * llena, sin hilo principal.
+ *
+ * Cada medida es la mejor de BENCH_PASSES pasadas, en CPU del hilo. La línea
+ * "read" es solo leer y partir líneas; "parse" es lo que añade el análisis.
+ *
+ * Uso: parser-bench <salida.log> [líneas]     (o: make bench-parser)
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "events.h"
+#include "runner.h"
+#include "uiqueue.h"
+
+#define DEFAULT_LINES   2000000L
+#define BENCH_PASSES    3
+
+typedef struct {
+    UiQueue *queue;
+    long lines;
+    long events;
+    long logs;
+} BenchState;
+
+/* ==================== HELPERS ==================== */
+
+static double thread_cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void drain_queue(UiQueue *q) {
+    while (ui_queue_peek(q) != NULL) ui_queue_release(q);
+}
+
+/* La grabación, repetida hasta tener al menos `lines` líneas, en un fichero temporal */
+static FILE* build_input(const char *path, long lines, long *total) {
+    FILE *in = fopen(path, "r");
+    if (!in) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+
+    char *text = NULL;
+    size_t size = 0;
+    FILE *mem = open_memstream(&text, &size);
+    char buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), in)) > 0) fwrite(buf, 1, n, mem);
+    fclose(in);
+    fclose(mem);
+
+    long per_copy = 0;
+    for (size_t i = 0; i < size; i++) per_copy += text[i] == '\n';
+    if (per_copy == 0) {
+        fprintf(stderr, "parser-bench: %s has no complete lines\n", path);
+        exit(EXIT_FAILURE);
+    }
+
+    FILE *out = tmpfile();
+    if (!out) {
+        perror("tmpfile");
+        exit(EXIT_FAILURE);
+    }
+    *total = 0;
+    while (*total < lines) {
+        fwrite(text, 1, size, out);
+        *total += per_copy;
+    }
+    fflush(out);
+    free(text);
+    return out;
+}
+
+/* ==================== CALLBACKS ==================== */
+
+static void count_line(char *line, void *data) {
+    BenchState *st = data;
+    (void)line;
+    st->lines++;
+}
+
+/* Lo mismo que handle_output_line() + parse_installation_output(), sin GTK */
+static void parse_line(char *line, void *data) {
+    BenchState *st = data;
+    st->lines++;
+
+    char *last_cr = strrchr(line, '\r');
+    if (last_cr) {
+        line = last_cr + 1;
+        if (line[0] == '\0' || line[0] == ' ') return;
+    }
+
+    if (event_is_protocol_line(line)) {
+        InstallerEvent ev;
+        if (event_parse(line, &ev)) st->events++;
+        return;
+    }
+
+    if (line[0] != '\0') {
+        if (st->logs % (UI_QUEUE_SLOTS / 2) == 0) drain_queue(st->queue);
+        ui_queue_push(st->queue, UI_MSG_LOG, 0, line);
+        st->logs++;
+    }
+}
+
+/* ==================== MAIN ==================== */
+
+static double run_pass(FILE *input, LineCallback cb, BenchState *st) {
+    int fd = fileno(input);
+    lseek(fd, 0, SEEK_SET);
+
+    LineReader reader = { 0 };
+    UiQueue *queue = st->queue;
+    memset(st, 0, sizeof(*st));
+    st->queue = queue;
+    drain_queue(queue);
+
+    double start = thread_cpu_ns();
+    while (line_reader_fill(&reader, fd, cb, st)) {
+    }
+    line_reader_flush(&reader, cb, st);
+    double elapsed = thread_cpu_ns() - start;
+
+    line_reader_free(&reader);
+    return elapsed;
+}
+
+static double best_pass(FILE *input, LineCallback cb, BenchState *st) {
+    double best = 0;
+    for (int i = 0; i < BENCH_PASSES; i++) {
+        double ns = run_pass(input, cb, st);
+        if (i == 0 || ns < best) best = ns;
+    }
+    return best;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <capture.log> [lines]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    long lines = argc > 2 ? atol(argv[2]) : DEFAULT_LINES;
+
+    long total;
+    FILE *input = build_input(argv[1], lines, &total);
+
+    UiQueue *queue = ui_queue_new();
+    if (!queue) return EXIT_FAILURE;
+
+    BenchState st = { .queue = queue };
+    double read_ns = best_pass(input, count_line, &st);
+    double parse_ns = best_pass(input, parse_line, &st);
+
+    printf("lines:  %ld (%ld events, %ld log lines)\n", st.lines, st.events, st.logs);
+    printf("read:   %7.1f ns/line  %8.1f ms\n", read_ns / st.lines, read_ns / 1e6);
+    printf("parse:  %7.1f ns/line  %8.1f ms  (%.2f M lines/s end to end)\n",
+           (parse_ns - read_ns) / st.lines, (parse_ns - read_ns) / 1e6, st.lines / parse_ns * 1e3);
+
+    ui_queue_free(queue);
+    fclose(input);
+    return EXIT_SUCCESS;
+}
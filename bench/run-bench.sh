@@ -0,0 +1,267 @@
+#!/bin/bash
+# run-bench.sh - Benchmark de extremo a extremo del instalador sobre dispositivos loop
+#
+# Crea un disco disperso en un dispositivo loop y un árbol de origen sintético
+# (muchos ficheros pequeños, algunos grandes, hardlinks, enlaces simbólicos y
+# xattrs) y ejecuta contra ellos las etapas de core-installer.sh que no
+# necesitan un sistema real: partition (con formateo), mount, copy, fstab y
+# unmount. Cada pasada empieza con la caché de páginas vacía.
+#
+# Resultado: un JSON con el informe por etapa del propio script (tiempo, CPU,
+# bytes leídos/escritos, pico de RSS) de cada pasada, el throughput de la
+# copia y, si hay strace, las syscalls por etapa medidas en una pasada aparte
+# para que el rastreo no falsee los tiempos.
+#
+# Uso: sudo bench/run-bench.sh [resultados.json]     (o: sudo make bench)
+#
+# Variables:
+#   BENCH_DISK_SIZE     tamaño del disco disperso (8G)
+#   BENCH_SMALL_FILES   ficheros pequeños, 512 B - 16 KiB (20000)
+#   BENCH_LARGE_FILES   ficheros grandes (4) de BENCH_LARGE_MB MiB (128)
+#   BENCH_RUNS          pasadas medidas (3)
+#   BENCH_STRACE        auto|0|1: pasada extra con strace -c (auto)
+#   BENCH_STAGES        etapas a ejecutar ("partition mount copy fstab unmount")
+#   BENCH_ROOT_FS       sistema de ficheros de la raíz: ext4, btrfs, xfs o f2fs (ext4)
+#   BENCH_WORKDIR       directorio de trabajo (/var/tmp); BENCH_KEEP=1 lo conserva
+
+set -e
+
+BENCH_DIR="$(dirname "$(readlink -f "$0")")"
+REPO_DIR="$(dirname "$BENCH_DIR")"
+
+BENCH_DISK_SIZE="${BENCH_DISK_SIZE:-8G}"
+BENCH_SMALL_FILES="${BENCH_SMALL_FILES:-20000}"
+BENCH_LARGE_FILES="${BENCH_LARGE_FILES:-4}"
+BENCH_LARGE_MB="${BENCH_LARGE_MB:-128}"
+BENCH_RUNS="${BENCH_RUNS:-3}"
+BENCH_STRACE="${BENCH_STRACE:-auto}"
+BENCH_STAGES="${BENCH_STAGES:-partition mount copy fstab unmount}"
+BENCH_ROOT_FS="${BENCH_ROOT_FS:-ext4}"
+BENCH_WORKDIR="${BENCH_WORKDIR:-/var/tmp}"
+RESULTS="${1:-$BENCH_DIR/results/bench-$(date +%Y%m%d-%H%M%S).json}"
+
+WORK=""
+LOOP_DEV=""
+
+# ========== UTILIDADES ==========
+say() {
+    echo "[bench] $*"
+}
+
+die() {
+    echo "[bench] ERROR: $*" >&2
+    exit 1
+}
+
+cleanup() {
+    if [ -n "$WORK" ]; then
+        # Lo que una pasada fallida dejara montado, de dentro hacia fuera
+        findmnt -rno TARGET | grep "^$WORK/target" | sort -r | while read -r mp; do
+            umount -l "$mp" 2>/dev/null || true
+        done
+    fi
+    if [ -n "$LOOP_DEV" ]; then
+        losetup -d "$LOOP_DEV" 2>/dev/null || true
+    fi
+    if [ -n "$WORK" ] && [ "${BENCH_KEEP:-0}" != "1" ]; then
+        rm -rf "$WORK"
+    fi
+}
+
+check_requirements() {
+    [ "$(id -u)" -eq 0 ] || die "must be run as root (loop devices, mkfs, mount)"
+
+    local tool
+    for tool in losetup rsync "mkfs.$BENCH_ROOT_FS" mkfs.fat findmnt blkid; do
+        command -v "$tool" >/dev/null 2>&1 || die "required tool not found: $tool"
+    done
+    [ -x "$REPO_DIR/loc-partitioner" ] || die "build the partitioning helper first (make loc-partitioner)"
+
+    case "$BENCH_STRACE" in
+        auto) command -v strace >/dev/null 2>&1 && BENCH_STRACE=1 || BENCH_STRACE=0 ;;
+        1) command -v strace >/dev/null 2>&1 || die "BENCH_STRACE=1 but strace is not installed" ;;
+    esac
+}
+
+# Cadena JSON a partir de texto sin comillas ni barras (rutas, modelos de CPU)
+json_str() {
+    printf '"%s"' "${1//\"/}"
+}
+
+# ========== ÁRBOL DE ORIGEN ==========
+# Determinista salvo el contenido de los ficheros grandes: mismos nombres,
+# tamaños, enlaces y xattrs en cada ejecución.
+make_source_tree() {
+    local src="$1"
+    say "Creating source tree: $BENCH_SMALL_FILES small files, $BENCH_LARGE_FILES x ${BENCH_LARGE_MB}MiB"
+
+    mkdir -p "$src"/{etc,boot,usr/lib/bench,usr/share/doc,var/lib/bench,home/live}
+    echo "bench" > "$src/etc/hostname"
+
+    # Ficheros pequeños repartidos en 200 directorios; sin procesos por fichero
+    local blob
+    blob=$(head -c 16384 /dev/urandom | base64 -w 0)
+    local i dir size
+    for ((i = 0; i < BENCH_SMALL_FILES; i++)); do
+        dir="$src/usr/share/doc/pkg$((i % 200))"
+        [ -d "$dir" ] || mkdir "$dir"
+        size=$(( 512 + (i * 7919) % 15872 ))
+        printf '%s' "${blob:0:size}" > "$dir/file$i"
+    done
+
+    for ((i = 0; i < BENCH_LARGE_FILES; i++)); do
+        head -c "$((BENCH_LARGE_MB * 1024 * 1024))" /dev/urandom > "$src/usr/lib/bench/large$i.bin"
+    done
+
+    # Hardlinks (rsync -H) y enlaces simbólicos
+    for ((i = 0; i < BENCH_SMALL_FILES; i += 50)); do
+        ln "$src/usr/share/doc/pkg$((i % 200))/file$i" "$src/var/lib/bench/hardlink$i"
+        ln -s "../../share/doc/pkg$((i % 200))/file$i" "$src/usr/lib/bench/symlink$i"
+    done
+
+    # xattrs (rsync -X); sin setfattr o sin soporte en el sistema de ficheros se omiten
+    if command -v setfattr >/dev/null 2>&1; then
+        for ((i = 0; i < BENCH_SMALL_FILES; i += 100)); do
+            setfattr -n user.loc.bench -v "$i" "$src/usr/share/doc/pkg$((i % 200))/file$i" 2>/dev/null || {
+                say "Extended attributes not supported under $BENCH_WORKDIR, skipping them"
+                break
+            }
+        done
+    else
+        say "setfattr not found, source tree has no extended attributes"
+    fi
+
+    chown -R 1000:1000 "$src/home/live"
+}
+
+write_bench_config() {
+    cat > "$WORK/bench.conf" << EOF
+# Configuración de core-installer.sh para el benchmark (generada)
+TARGET="$WORK/target"
+SOURCE_ROOT="$WORK/src"
+LIVE_HOME="$WORK/src/home/live"
+LOG_FILE="$WORK/installer.log"
+ERROR_LOG="$WORK/installer-error.log"
+RSYNC_EXCLUDES="$WORK/exclude.list"
+CUSTOM_EXCLUDES="$WORK/none"
+PARTITIONER="$REPO_DIR/loc-partitioner"
+USERDB="$REPO_DIR/loc-userdb"
+LIVE_SQUASHFS="$WORK/none"
+ROOT_FS="$BENCH_ROOT_FS"
+EOF
+}
+
+# ========== RESULTADOS ==========
+# "calls" total y las 8 syscalls más frecuentes de un resumen de strace -c
+syscalls_json() {
+    local file="$1"
+    local total
+    total=$(awk '$NF == "total" { print $4 }' "$file")
+
+    printf '{"calls": %d, "top": {' "${total:-0}"
+    awk '$1 ~ /^[0-9.]+$/ && $NF != "total" { print $4, $NF }' "$file" | sort -k1,1nr | head -n 8 |
+        awk '{ printf "%s\"%s\": %d", (NR > 1 ? ", " : ""), $2, $1 }'
+    printf '}}'
+}
+
+# Milisegundos de una etapa en el informe de core-installer.sh
+stage_wall_ms() {
+    sed -n "s/.*\"stage\": \"$2\", \"wall_ms\": \([0-9]*\).*/\1/p" "$1"
+}
+
+write_results() {
+    local source_files="$1" source_bytes="$2"
+
+    mkdir -p "$(dirname "$RESULTS")"
+    {
+        printf '{\n  "version": 1,\n'
+        printf '  "date": "%s",\n' "$(date -Iseconds)"
+        printf '  "kernel": %s,\n' "$(json_str "$(uname -r)")"
+        printf '  "cpu": %s,\n' "$(json_str "$(awk -F': ' '/^model name/ { print $2; exit }' /proc/cpuinfo)")"
+        printf '  "config": {"disk_size": "%s", "small_files": %d, "large_files": %d, "large_mb": %d, "stages": "%s", "root_fs": "%s"},\n' \
+            "$BENCH_DISK_SIZE" "$BENCH_SMALL_FILES" "$BENCH_LARGE_FILES" "$BENCH_LARGE_MB" "$BENCH_STAGES" "$BENCH_ROOT_FS"
+        printf '  "source": {"files": %d, "bytes": %d},\n' "$source_files" "$source_bytes"
+
+        printf '  "runs": [\n'
+        local run copy_ms
+        for ((run = 1; run <= BENCH_RUNS; run++)); do
+            copy_ms=$(stage_wall_ms "$WORK/run$run/stages.json" copy)
+            copy_ms=${copy_ms:-0}
+            printf '    {"run": %d, "copy_bytes_per_s": %d, "report": ' "$run" \
+                "$(( copy_ms > 0 ? source_bytes * 1000 / copy_ms : 0 ))"
+            tr -d '\n' < "$WORK/run$run/stages.json" | sed 's/  */ /g'
+            printf '}%s\n' "$([ "$run" -lt "$BENCH_RUNS" ] && echo ,)"
+        done
+        printf '  ],\n'
+
+        printf '  "syscalls": {'
+        if [ "$BENCH_STRACE" = "1" ]; then
+            local stage first=1
+            for stage in $BENCH_STAGES; do
+                [ -s "$WORK/trace/syscalls-$stage.txt" ] || continue
+                [ "$first" = "1" ] || printf ','
+                printf '\n    "%s": %s' "$stage" "$(syscalls_json "$WORK/trace/syscalls-$stage.txt")"
+                first=0
+            done
+            printf '\n  '
+        fi
+        printf '}\n}\n'
+    } > "$RESULTS"
+}
+
+# ========== EJECUCIÓN ==========
+run_pass() {
+    local out="$1" trace="$2"
+    mkdir -p "$out"
+
+    sync
+    echo 3 > /proc/sys/vm/drop_caches
+
+    LOC_INSTALLER_CONFIG="$WORK/bench.conf" \
+    BENCH_CORE_INSTALLER="$REPO_DIR/src/scripts/core-installer.sh" \
+    BENCH_DISK="$LOOP_DEV" \
+    BENCH_STAGES="$BENCH_STAGES" \
+    PATH="$WORK/bin:$PATH" \
+        bash "$BENCH_DIR/bench-stages.sh" "$out" "$trace" > "$out/output.log" ||
+        die "pass failed, see $out/output.log and $WORK/installer-error.log (BENCH_KEEP=1 keeps them)"
+}
+
+main() {
+    check_requirements
+    trap cleanup EXIT
+
+    WORK=$(mktemp -d "$BENCH_WORKDIR/loc-bench.XXXXXX")
+    say "Work directory: $WORK"
+
+    # partition_disk ejecuta "dmsetup remove_all": aquí no debe tocar los del equipo
+    mkdir -p "$WORK/bin"
+    printf '#!/bin/sh\nexit 0\n' > "$WORK/bin/dmsetup"
+    chmod +x "$WORK/bin/dmsetup"
+
+    truncate -s "$BENCH_DISK_SIZE" "$WORK/disk.img"
+    LOOP_DEV=$(losetup --find --show --partscan "$WORK/disk.img")
+    say "Disk: $LOOP_DEV ($BENCH_DISK_SIZE, sparse)"
+
+    make_source_tree "$WORK/src"
+    write_bench_config
+
+    local source_files source_bytes
+    source_files=$(find "$WORK/src" -type f | wc -l)
+    source_bytes=$(du -sb "$WORK/src" | cut -f1)
+
+    local run
+    for ((run = 1; run <= BENCH_RUNS; run++)); do
+        say "Run $run/$BENCH_RUNS..."
+        run_pass "$WORK/run$run" 0
+    done
+
+    if [ "$BENCH_STRACE" = "1" ]; then
+        say "Syscall pass (strace)..."
+        run_pass "$WORK/trace" 1
+    fi
+
+    write_results "$source_files" "$source_bytes"
+    say "Results: $RESULTS"
+}
+
+main "$@"
@@ -0,0 +1,181 @@
+/*
+ * events.c - Event protocol parser for LOC-OS 24 Installer (sin dependencias de GTK)
+ */
+
+#include <string.h>
+#include "events.h"
+
+/* ==================== TABLES ==================== */
+
+static const char *event_names[EV_COUNT] = {
+    [EV_UNKNOWN] = "unknown",
+    [EV_PLAN]    = "plan",
+    [EV_STAGE]   = "stage",
+    [EV_STAGE_END] = "stage_end",
+    [EV_COPY]    = "copy",
+    [EV_LOG]     = "log",
+    [EV_ERROR]   = "error",
+    [EV_DONE]    = "done",
+};
+
+typedef void (*FieldSetter)(InstallerEvent *ev, const char *value);
+
+/* Enteros sin signo o con '-': sin locale ni errno, como los escribe el script */
+static long long parse_number(const char *v) {
+    bool negative = (*v == '-');
+    if (negative) v++;
+
+    long long n = 0;
+    while (*v >= '0' && *v <= '9') n = n * 10 + (*v++ - '0');
+    return negative ? -n : n;
+}
+
+static void set_stage(InstallerEvent *ev, const char *v)       { ev->stage = v; }
+static void set_pct(InstallerEvent *ev, const char *v)         { ev->pct = (int) parse_number(v); }
+static void set_bytes(InstallerEvent *ev, const char *v)       { ev->bytes = parse_number(v); }
+static void set_rate(InstallerEvent *ev, const char *v)        { ev->rate = parse_number(v); }
+static void set_files(InstallerEvent *ev, const char *v)       { ev->files = (long) parse_number(v); }
+static void set_files_total(InstallerEvent *ev, const char *v) { ev->files_total = (long) parse_number(v); }
+static void set_eta(InstallerEvent *ev, const char *v)         { ev->eta = (long) parse_number(v); }
+static void set_wall_ms(InstallerEvent *ev, const char *v)     { ev->wall_ms = parse_number(v); }
+static void set_cpu_ms(InstallerEvent *ev, const char *v)      { ev->cpu_ms = parse_number(v); }
+static void set_read_bytes(InstallerEvent *ev, const char *v)  { ev->read_bytes = parse_number(v); }
+static void set_write_bytes(InstallerEvent *ev, const char *v) { ev->write_bytes = parse_number(v); }
+static void set_rss_kb(InstallerEvent *ev, const char *v)      { ev->rss_kb = parse_number(v); }
+static void set_stages(InstallerEvent *ev, const char *v)      { ev->stages = v; }
+static void set_copy_bytes(InstallerEvent *ev, const char *v)  { ev->copy_bytes = parse_number(v); }
+static void set_disk_class(InstallerEvent *ev, const char *v)  { ev->disk_class = v; }
+
+static void set_sev(InstallerEvent *ev, const char *v) {
+    if (strcmp(v, "warn") == 0) ev->sev = SEV_WARN;
+    else if (strcmp(v, "error") == 0) ev->sev = SEV_ERROR;
+    else ev->sev = SEV_INFO;
+}
+
+#define FIELD(key, setter)  { key, sizeof(key) - 1, setter }
+
+static const struct {
+    const char *key;
+    size_t len;
+    FieldSetter set;
+} field_table[] = {
+    FIELD("stage",       set_stage),
+    FIELD("pct",         set_pct),
+    FIELD("bytes",       set_bytes),
+    FIELD("rate",        set_rate),
+    FIELD("files",       set_files),
+    FIELD("files_total", set_files_total),
+    FIELD("eta",         set_eta),
+    FIELD("wall_ms",     set_wall_ms),
+    FIELD("cpu_ms",      set_cpu_ms),
+    FIELD("read_bytes",  set_read_bytes),
+    FIELD("write_bytes", set_write_bytes),
+    FIELD("rss_kb",      set_rss_kb),
+    FIELD("stages",      set_stages),
+    FIELD("copy_bytes",  set_copy_bytes),
+    FIELD("disk_class",  set_disk_class),
+    FIELD("sev",         set_sev),
+};
+
+/* Valores de "no viene" para los campos opcionales; se copia entera en cada evento */
+static const InstallerEvent event_defaults = {
+    .type = EV_UNKNOWN,
+    .stage = "",
+    .msg = "",
+    .pct = -1,
+    .bytes = -1,
+    .rate = -1,
+    .files = -1,
+    .files_total = -1,
+    .eta = -1,
+    .wall_ms = -1,
+    .cpu_ms = -1,
+    .read_bytes = -1,
+    .write_bytes = -1,
+    .rss_kb = -1,
+    .stages = "",
+    .copy_bytes = -1,
+    .disk_class = "",
+};
+
+/* ==================== PARSER ==================== */
+
+const char* event_type_name(EventType type) {
+    return (type >= 0 && type < EV_COUNT) ? event_names[type] : event_names[EV_UNKNOWN];
+}
+
+/* Se llama con cada línea de salida: comparación a mano, sin llamar a strncmp */
+bool event_is_protocol_line(const char *line) {
+    if (!line) return false;
+    for (int i = 0; i < EVENT_PROTO_LEN; i++) {
+        if (line[i] != EVENT_PROTO[i]) return false;
+    }
+    return line[EVENT_PROTO_LEN] == ' ';
+}
+
+static EventType event_type_lookup(const char *name, size_t len) {
+    for (int t = EV_UNKNOWN + 1; t < EV_COUNT; t++) {
+        const char *candidate = event_names[t];
+        if (candidate[0] == name[0] && strncmp(name, candidate, len) == 0 && candidate[len] == '\0') {
+            return (EventType) t;
+        }
+    }
+    return EV_UNKNOWN;
+}
+
+static void set_field(InstallerEvent *ev, const char *key, size_t len, const char *value) {
+    for (size_t i = 0; i < sizeof(field_table) / sizeof(field_table[0]); i++) {
+        if (field_table[i].len == len && field_table[i].key[0] == key[0] &&
+            memcmp(key, field_table[i].key, len) == 0) {
+            field_table[i].set(ev, value);
+            return;
+        }
+    }
+}
+
+/*
+ * Una sola pasada sobre la línea: cada token se corta en su sitio con '\0'
+ * y los campos de texto del evento apuntan dentro de ella. No reserva memoria.
+ */
+bool event_parse(char *line, InstallerEvent *ev) {
+    *ev = event_defaults;
+
+    if (!event_is_protocol_line(line)) return false;
+    char *p = line + EVENT_PROTO_LEN + 1;
+
+    // Marca de tiempo
+    while (*p == ' ') p++;
+    char *ts = p;
+    while (*p && *p != ' ') p++;
+    if (p == ts) return false;
+    ev->ts_ms = parse_number(ts);
+
+    // Nombre del evento
+    while (*p == ' ') p++;
+    char *name = p;
+    while (*p && *p != ' ') p++;
+    ev->type = event_type_lookup(name, (size_t) (p - name));
+    if (ev->type == EV_UNKNOWN) return false;
+
+    // clave=valor ... [msg=resto de la línea]
+    while (*p) {
+        while (*p == ' ') p++;
+        if (*p == '\0') break;
+
+        if (strncmp(p, "msg=", 4) == 0) {
+            ev->msg = p + 4;
+            break;
+        }
+
+        char *key = p;
+        char *eq = NULL;
+        while (*p && *p != ' ') {
+            if (*p == '=' && !eq) eq = p;
+            p++;
+        }
+        if (*p) *p++ = '\0';
+        if (eq) set_field(ev, key, (size_t) (eq - key), eq + 1);
+    }
+
+    return true;
+}
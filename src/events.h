@@ -0,0 +1,77 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+/*
+ * events.h - Event protocol between core-installer.sh and the GUI
+ *
+ * Una línea por evento, campos clave=valor separados por espacios; msg= va
+ * siempre al final y ocupa el resto de la línea:
+ *
+ *   LOC1 <ts_ms> <evento> [clave=valor ...] [msg=texto libre]
+ *
+ * Eventos:
+ *   plan   stages=<id,id,...> copy_bytes=<n> disk_class=hdd|ssd
+ *                                                  etapas previstas, antes de la primera
+ *   stage  stage=<id> pct=<0-100> msg=...          comienzo de etapa
+ *   copy   stage=copy pct= bytes= files= files_total= rate= eta=
+ *   log    sev=info|warn|error msg=...
+ *   stage_end stage=<id> wall_ms= cpu_ms= read_bytes= write_bytes= rss_kb=
+ *                                                  métricas de la etapa que termina
+ *   error  stage=<id> msg=...                       error fatal
+ *   done   msg=...                                  instalación completada
+ */
+
+#include <stdbool.h>
+
+#define EVENT_PROTO         "LOC1"
+#define EVENT_PROTO_LEN     4
+
+typedef enum {
+    EV_UNKNOWN = 0,
+    EV_PLAN,
+    EV_STAGE,
+    EV_STAGE_END,
+    EV_COPY,
+    EV_LOG,
+    EV_ERROR,
+    EV_DONE,
+    EV_COUNT
+} EventType;
+
+typedef enum {
+    SEV_INFO = 0,
+    SEV_WARN,
+    SEV_ERROR
+} EventSeverity;
+
+typedef struct {
+    EventType type;
+    long long ts_ms;
+    const char *stage;          /* apunta dentro de la línea */
+    const char *msg;            /* apunta dentro de la línea */
+    EventSeverity sev;
+    int pct;                    /* -1 si no viene */
+    long long bytes;            /* -1 si no viene */
+    long long rate;             /* bytes/s, -1 si no viene */
+    long files;
+    long files_total;
+    long eta;                   /* segundos, -1 si no viene */
+    long long wall_ms;          /* métricas de stage_end, -1 si no vienen */
+    long long cpu_ms;
+    long long read_bytes;
+    long long write_bytes;
+    long long rss_kb;
+    const char *stages;         /* plan: ids separados por comas */
+    long long copy_bytes;       /* plan: bytes a copiar, -1 si no viene */
+    const char *disk_class;     /* plan: "hdd" o "ssd" */
+} InstallerEvent;
+
+/* true si la línea empieza por el prefijo del protocolo */
+bool event_is_protocol_line(const char *line);
+
+/* Analiza la línea (la modifica: separa campos con '\0'). false si no es un evento válido. */
+bool event_parse(char *line, InstallerEvent *ev);
+
+const char* event_type_name(EventType type);
+
+#endif /* EVENTS_H */
@@ -0,0 +1,629 @@
+/*
+ * headless.c - Unattended installation driven by a preseed file for LOC-OS 24 Installer
+ *
+ * Rellena el mismo InstallConfig que el asistente a partir de un fichero
+ * clave=valor o de un objeto JSON plano, lo valida con las mismas reglas y
+ * lanza run_installation_thread() sin gtk_init. El hilo principal vacía la
+ * cola de UI hacia la terminal (texto) o hacia stdout como JSON por líneas.
+ *
+ *   loc-installer --preseed=/ruta/preseed.conf [--progress=text|json]
+ *
+ * Códigos de salida: 0 instalado, 1 fallo de la instalación, 2 preseed inválido.
+ */
+
+#include "installer.h"
+
+/* ==================== PRESEED KEYS ==================== */
+
+typedef enum {
+    PRESEED_STRING,
+    PRESEED_BOOL,
+    PRESEED_INT
+} PreseedType;
+
+#define PRESEED_FIELD(key, type, field) \
+    { key, type, offsetof(InstallConfig, field), sizeof(((InstallConfig*)0)->field) }
+
+static const struct {
+    const char *key;
+    PreseedType type;
+    size_t offset;
+    size_t size;
+} preseed_keys[] = {
+    PRESEED_FIELD("language",         PRESEED_STRING, language),
+    PRESEED_FIELD("timezone",         PRESEED_STRING, timezone),
+    PRESEED_FIELD("keyboard",         PRESEED_STRING, keyboard),
+    PRESEED_FIELD("keyboard_variant", PRESEED_STRING, keyboard_variant),
+    PRESEED_FIELD("disk",             PRESEED_STRING, disk_device),
+    PRESEED_FIELD("uefi",             PRESEED_BOOL,   uefi_mode),
+    PRESEED_FIELD("auto_partition",   PRESEED_BOOL,   auto_partition),
+    PRESEED_FIELD("separate_home",    PRESEED_BOOL,   separate_home),
+    PRESEED_FIELD("separate_boot",    PRESEED_BOOL,   separate_boot),
+    PRESEED_FIELD("add_swap",         PRESEED_BOOL,   add_swap),
+    PRESEED_FIELD("swapfile",         PRESEED_BOOL,   create_swapfile),
+    PRESEED_FIELD("swap_size_mb",     PRESEED_INT,    swap_size_mb),
+    PRESEED_FIELD("root_fs",          PRESEED_STRING, root_fs),
+    PRESEED_FIELD("raid",             PRESEED_BOOL,   raid),
+    PRESEED_FIELD("raid_level",       PRESEED_INT,    raid_level),
+    PRESEED_FIELD("raid_disks",       PRESEED_STRING, raid_disks),
+    PRESEED_FIELD("fanout_disks",     PRESEED_STRING, fanout_disks),
+    PRESEED_FIELD("probe_other_os",   PRESEED_BOOL,   probe_other_os),
+    PRESEED_FIELD("username",         PRESEED_STRING, username),
+    PRESEED_FIELD("realname",         PRESEED_STRING, realname),
+    PRESEED_FIELD("hostname",         PRESEED_STRING, hostname),
+    PRESEED_FIELD("password",         PRESEED_STRING, password),
+    PRESEED_FIELD("root_password",    PRESEED_STRING, root_password),
+    PRESEED_FIELD("autologin",        PRESEED_BOOL,   autologin),
+    PRESEED_FIELD("root_partition",   PRESEED_STRING, root_partition),
+    PRESEED_FIELD("home_partition",   PRESEED_STRING, home_partition),
+    PRESEED_FIELD("boot_partition",   PRESEED_STRING, boot_partition),
+    PRESEED_FIELD("swap_partition",   PRESEED_STRING, swap_partition),
+    PRESEED_FIELD("efi_partition",    PRESEED_STRING, efi_partition),
+};
+
+static bool parse_preseed_bool(const char *value, bool *out) {
+    if (g_ascii_strcasecmp(value, "true") == 0 || g_ascii_strcasecmp(value, "yes") == 0 ||
+        strcmp(value, "1") == 0) {
+        *out = true;
+        return true;
+    }
+    if (g_ascii_strcasecmp(value, "false") == 0 || g_ascii_strcasecmp(value, "no") == 0 ||
+        strcmp(value, "0") == 0) {
+        *out = false;
+        return true;
+    }
+    return false;
+}
+
+static void set_preseed_value(InstallConfig *config, const char *key, const char *value,
+                              int line, GString *errors) {
+    for (size_t i = 0; i < G_N_ELEMENTS(preseed_keys); i++) {
+        if (strcmp(key, preseed_keys[i].key) != 0) continue;
+
+        char *field = (char*) config + preseed_keys[i].offset;
+        switch (preseed_keys[i].type) {
+            case PRESEED_STRING:
+                if (strlen(value) >= preseed_keys[i].size) {
+                    g_string_append_printf(errors, _("line %d: value for '%s' is too long\n"), line, key);
+                } else {
+                    g_strlcpy(field, value, preseed_keys[i].size);
+                }
+                break;
+
+            case PRESEED_BOOL:
+                if (!parse_preseed_bool(value, (bool*) field)) {
+                    g_string_append_printf(errors, _("line %d: '%s' must be true or false\n"), line, key);
+                }
+                break;
+
+            case PRESEED_INT: {
+                char *end = NULL;
+                long n = strtol(value, &end, 10);
+                if (*value == '\0' || *end != '\0' || n < 0 || n > INT_MAX) {
+                    g_string_append_printf(errors, _("line %d: '%s' must be a number\n"), line, key);
+                } else {
+                    *(int*) field = (int) n;
+                }
+                break;
+            }
+        }
+        return;
+    }
+
+    g_string_append_printf(errors, _("line %d: unknown key '%s'\n"), line, key);
+}
+
+/* ==================== PRESEED PARSERS ==================== */
+
+/* clave=valor, una por línea; '#' comenta y las comillas del valor son opcionales */
+static void parse_preseed_kv(char *text, InstallConfig *config, GString *errors) {
+    gchar **lines = g_strsplit(text, "\n", -1);
+
+    for (int i = 0; lines[i]; i++) {
+        int line_no = i + 1;
+        char *line = g_strstrip(lines[i]);
+        if (*line == '\0' || *line == '#') continue;
+
+        char *eq = strchr(line, '=');
+        if (!eq) {
+            g_string_append_printf(errors, _("line %d: expected key=value\n"), line_no);
+            continue;
+        }
+        *eq = '\0';
+        char *key = g_strstrip(line);
+        char *value = g_strstrip(eq + 1);
+
+        size_t len = strlen(value);
+        if (len >= 2 && (value[0] == '"' || value[0] == '\'') && value[len - 1] == value[0]) {
+            value[len - 1] = '\0';
+            value++;
+        }
+        set_preseed_value(config, key, value, line_no, errors);
+    }
+    g_strfreev(lines);
+}
+
+typedef struct {
+    const char *p;
+    int line;
+} JsonCursor;
+
+static void json_skip_space(JsonCursor *c) {
+    while (*c->p == ' ' || *c->p == '\t' || *c->p == '\r' || *c->p == '\n') {
+        if (*c->p == '\n') c->line++;
+        c->p++;
+    }
+}
+
+/* Cadena JSON con sus escapes; NULL si está mal formada */
+static char* json_string(JsonCursor *c) {
+    if (*c->p != '"') return NULL;
+    c->p++;
+
+    GString *out = g_string_new(NULL);
+    while (*c->p && *c->p != '"') {
+        if (*c->p != '\\') {
+            g_string_append_c(out, *c->p++);
+            continue;
+        }
+
+        c->p++;
+        switch (*c->p) {
+            case '"':  g_string_append_c(out, '"'); break;
+            case '\\': g_string_append_c(out, '\\'); break;
+            case '/':  g_string_append_c(out, '/'); break;
+            case 'n':  g_string_append_c(out, '\n'); break;
+            case 't':  g_string_append_c(out, '\t'); break;
+            case 'u': {
+                char hex[5] = { 0 };
+                for (int i = 0; i < 4 && g_ascii_isxdigit(c->p[i + 1]); i++) hex[i] = c->p[i + 1];
+                if (strlen(hex) != 4) {
+                    g_string_free(out, TRUE);
+                    return NULL;
+                }
+                g_string_append_unichar(out, (gunichar) strtoul(hex, NULL, 16));
+                c->p += 4;
+                break;
+            }
+            default:
+                g_string_free(out, TRUE);
+                return NULL;
+        }
+        c->p++;
+    }
+
+    if (*c->p != '"') {
+        g_string_free(out, TRUE);
+        return NULL;
+    }
+    c->p++;
+    return g_string_free(out, FALSE);
+}
+
+/* Objeto plano: valores cadena, número o true/false */
+static void parse_preseed_json(const char *text, InstallConfig *config, GString *errors) {
+    JsonCursor c = { text, 1 };
+
+    json_skip_space(&c);
+    if (*c.p++ != '{') {
+        g_string_append_printf(errors, _("line %d: expected '{'\n"), c.line);
+        return;
+    }
+
+    json_skip_space(&c);
+    if (*c.p == '}') return;
+
+    for (;;) {
+        json_skip_space(&c);
+        char *key = json_string(&c);
+        json_skip_space(&c);
+        if (!key || *c.p++ != ':') {
+            g_string_append_printf(errors, _("line %d: expected \"key\": value\n"), c.line);
+            g_free(key);
+            return;
+        }
+
+        json_skip_space(&c);
+        char *value = NULL;
+        if (*c.p == '"') {
+            value = json_string(&c);
+        } else {
+            const char *start = c.p;
+            while (g_ascii_isalnum(*c.p) || *c.p == '-' || *c.p == '.') c.p++;
+            if (c.p > start) value = g_strndup(start, (gsize) (c.p - start));
+        }
+        if (!value) {
+            g_string_append_printf(errors, _("line %d: invalid value for '%s'\n"), c.line, key);
+            g_free(key);
+            return;
+        }
+
+        set_preseed_value(config, key, value, c.line, errors);
+        g_free(key);
+        g_free(value);
+
+        json_skip_space(&c);
+        if (*c.p == ',') {
+            c.p++;
+        } else if (*c.p == '}') {
+            return;
+        } else {
+            g_string_append_printf(errors, _("line %d: expected ',' or '}'\n"), c.line);
+            return;
+        }
+    }
+}
+
+bool preseed_load(const char *path, InstallConfig *config, GString *errors) {
+    gchar *text = NULL;
+    GError *error = NULL;
+
+    if (!g_file_get_contents(path, &text, NULL, &error)) {
+        g_string_append_printf(errors, "%s\n", error->message);
+        g_error_free(error);
+        return false;
+    }
+
+    // JSON si empieza por '{'; si no, clave=valor
+    size_t before = errors->len;
+    const char *first = text;
+    while (g_ascii_isspace(*first)) first++;
+    if (*first == '{') {
+        parse_preseed_json(text, config, errors);
+    } else {
+        parse_preseed_kv(text, config, errors);
+    }
+
+    g_free(text);
+    return errors->len == before;
+}
+
+/* ==================== VALIDATION ==================== */
+
+static bool is_block_device(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISBLK(st.st_mode);
+}
+
+static void require_block_device(const char *key, const char *path, GString *errors) {
+    if (path[0] != '\0' && !is_block_device(path)) {
+        g_string_append_printf(errors, _("%s: %s is not a block device\n"), key, path);
+    }
+}
+
+static void default_string(char *field, size_t size, char *value) {
+    if (field[0] == '\0' && value) g_strlcpy(field, value, size);
+    free(value);
+}
+
+/* Las mismas reglas que el asistente; rellena lo que el preseed omite */
+bool preseed_validate(InstallConfig *config, GString *errors) {
+    size_t before = errors->len;
+
+    if (!is_valid_username(config->username)) {
+        g_string_append(errors, _("Invalid username. Use 2-32 characters, letters, numbers, "
+                                  "'_' and '-', not starting with a number.\n"));
+    }
+    // Con fan-out cada disco lleva su número: %n se sustituye por él y, si no
+    // hay %n, se añade -N (como fanout_hostname). Se valida el del último disco,
+    // el más largo.
+    gchar *hostname = g_strdup(config->hostname);
+    if (config->fanout_disks[0]) {
+        int disks = 1;
+        gchar **targets = g_strsplit(config->fanout_disks, ",", -1);
+        for (gchar **t = targets; *t; t++) {
+            if (**t) disks++;
+        }
+        g_strfreev(targets);
+
+        gchar *number = g_strdup_printf("%d", disks);
+        gchar **parts = g_strsplit(config->hostname, "%n", -1);
+        g_free(hostname);
+        hostname = strstr(config->hostname, "%n")
+                 ? g_strjoinv(number, parts)
+                 : g_strdup_printf("%s-%s", config->hostname, number);
+        g_strfreev(parts);
+        g_free(number);
+    }
+    if (!is_valid_hostname(hostname)) {
+        g_string_append(errors, _("Invalid hostname. Use 1-63 characters, "
+                                  "letters, numbers and hyphens only.\n"));
+    }
+    g_free(hostname);
+    if (!is_valid_password(config->password)) {
+        g_string_append(errors, _("Invalid password. Use at least 1 character\n"));
+    }
+
+    if (config->auto_partition) {
+        if (config->disk_device[0] == '\0') {
+            g_string_append(errors, _("disk is required for automatic partitioning\n"));
+        }
+        require_block_device("disk", config->disk_device, errors);
+
+        static const char * const filesystems[] = { "ext4", "btrfs", "xfs", "f2fs", NULL };
+        if (!g_strv_contains(filesystems, config->root_fs)) {
+            g_string_append_printf(errors, _("root_fs: %s is not supported (ext4, btrfs, xfs or f2fs)\n"),
+                                   config->root_fs);
+        }
+    } else {
+        if (config->raid) {
+            g_string_append(errors, _("raid requires automatic partitioning\n"));
+        }
+        if (config->fanout_disks[0]) {
+            g_string_append(errors, _("fanout_disks requires automatic partitioning\n"));
+        }
+        if (config->root_partition[0] == '\0') {
+            g_string_append(errors, _("root_partition is required for manual partitioning\n"));
+        }
+        require_block_device("root_partition", config->root_partition, errors);
+        require_block_device("home_partition", config->home_partition, errors);
+        require_block_device("boot_partition", config->boot_partition, errors);
+        require_block_device("swap_partition", config->swap_partition, errors);
+        require_block_device("efi_partition", config->efi_partition, errors);
+
+        // En manual, las particiones opcionales deciden las opciones
+        config->separate_home = config->home_partition[0] != '\0';
+        config->separate_boot = config->boot_partition[0] != '\0';
+        if (config->swap_partition[0] != '\0') config->add_swap = true;
+    }
+
+    if (config->raid && config->auto_partition) {
+        if (config->raid_level != 0 && config->raid_level != 1) {
+            g_string_append(errors, _("raid_level must be 0 or 1\n"));
+        }
+        if (config->raid_disks[0] == '\0') {
+            g_string_append(errors, _("raid_disks is required for RAID (at least one more disk)\n"));
+        }
+
+        gchar **members = g_strsplit(config->raid_disks, ",", -1);
+        for (gchar **m = members; *m; m++) {
+            if (strcmp(*m, config->disk_device) == 0) {
+                g_string_append_printf(errors, _("raid_disks: %s is already the main disk\n"), *m);
+            }
+            require_block_device("raid_disks", *m, errors);
+        }
+        g_strfreev(members);
+    } else {
+        config->raid_disks[0] = '\0';
+    }
+
+    if (config->fanout_disks[0] && config->auto_partition) {
+        if (config->raid) {
+            g_string_append(errors, _("fanout_disks cannot be combined with raid\n"));
+        }
+
+        gchar **targets = g_strsplit(config->fanout_disks, ",", -1);
+        for (gchar **t = targets; *t; t++) {
+            if (strcmp(*t, config->disk_device) == 0) {
+                g_string_append_printf(errors, _("fanout_disks: %s is already the main disk\n"), *t);
+            }
+            require_block_device("fanout_disks", *t, errors);
+        }
+        g_strfreev(targets);
+    }
+
+    if (config->add_swap && config->swap_size_mb <= 0) {
+        g_string_append(errors, _("swap_size_mb must be greater than 0\n"));
+    }
+
+    if (config->realname[0] == '\0') {
+        g_strlcpy(config->realname, config->username, sizeof(config->realname));
+    }
+    config->same_root_password = config->root_password[0] == '\0';
+
+    default_string(config->timezone, sizeof(config->timezone), get_current_timezone());
+    default_string(config->language, sizeof(config->language), get_current_language());
+    default_string(config->keyboard, sizeof(config->keyboard), get_current_keyboard());
+    default_string(config->keyboard_variant, sizeof(config->keyboard_variant), strdup("default"));
+
+    return errors->len == before;
+}
+
+/* ==================== PROGRESS OUTPUT ==================== */
+
+static volatile sig_atomic_t headless_interrupted = 0;
+
+static void on_headless_signal(int sig) {
+    (void) sig;
+    headless_interrupted = 1;
+}
+
+typedef struct {
+    FILE *out;
+    bool json;
+    bool tty;
+    bool transient_shown;       /* la última línea de la terminal es progreso de rsync */
+    int last_pct;
+    char last_status[UI_MESSAGE_TEXT];
+    char last_progress[UI_MESSAGE_TEXT];
+} HeadlessOutput;
+
+static void json_append_string(GString *out, const char *text) {
+    g_string_append_c(out, '"');
+    for (const unsigned char *p = (const unsigned char*) text; *p; p++) {
+        switch (*p) {
+            case '"':  g_string_append(out, "\\\""); break;
+            case '\\': g_string_append(out, "\\\\"); break;
+            case '\n': g_string_append(out, "\\n"); break;
+            case '\r': g_string_append(out, "\\r"); break;
+            case '\t': g_string_append(out, "\\t"); break;
+            default:
+                if (*p < 0x20) g_string_append_printf(out, "\\u%04x", *p);
+                else g_string_append_c(out, (char) *p);
+        }
+    }
+    g_string_append_c(out, '"');
+}
+
+static void emit_json(HeadlessOutput *o, const char *type, int pct, const char *text) {
+    GString *line = g_string_new("{\"type\":");
+    json_append_string(line, type);
+    if (pct >= 0) g_string_append_printf(line, ",\"pct\":%d", pct);
+    if (text) {
+        g_string_append(line, ",\"text\":");
+        json_append_string(line, text);
+    }
+    g_string_append(line, "}\n");
+    fputs(line->str, o->out);
+    g_string_free(line, TRUE);
+}
+
+/* Texto: el progreso de rsync se sobreescribe solo si la salida es una terminal */
+static void emit_text(HeadlessOutput *o, const char *text, bool transient) {
+    if (transient && !o->tty) return;
+
+    if (o->transient_shown) {
+        fputs(transient ? "\r\033[K" : "\n", o->out);
+    }
+    fputs(text, o->out);
+    if (!transient) fputc('\n', o->out);
+    o->transient_shown = transient;
+}
+
+static void headless_message(HeadlessOutput *o, LogStore *log, const UiMessage *msg) {
+    char line[UI_MESSAGE_TEXT + 16];
+
+    switch (msg->kind) {
+        case UI_MSG_LOG:
+            logstore_append(log, msg->text);
+            if (o->json) emit_json(o, "log", -1, msg->text);
+            else emit_text(o, msg->text, false);
+            break;
+
+        case UI_MSG_LOG_REPLACE:
+            logstore_set_transient(log, msg->text);
+            if (o->json) emit_json(o, "log_replace", -1, msg->text);
+            else emit_text(o, msg->text, true);
+            break;
+
+        case UI_MSG_CLEAR_LOG:
+            logstore_reset(log);
+            break;
+
+        case UI_MSG_STATUS:
+            if (strcmp(msg->text, o->last_status) == 0) break;
+            g_strlcpy(o->last_status, msg->text, sizeof(o->last_status));
+            if (o->json) emit_json(o, "status", -1, msg->text);
+            break;
+
+        case UI_MSG_PROGRESS:
+            // En texto, una línea por punto porcentual; en JSON también cada cambio de ETA
+            if (o->json) {
+                if (msg->percent == o->last_pct && strcmp(msg->text, o->last_progress) == 0) break;
+                emit_json(o, "progress", msg->percent, msg->text);
+            } else {
+                if (msg->percent == o->last_pct) break;
+                snprintf(line, sizeof(line), "[%3d%%] %s", msg->percent, msg->text);
+                emit_text(o, line, false);
+            }
+            o->last_pct = msg->percent;
+            g_strlcpy(o->last_progress, msg->text, sizeof(o->last_progress));
+            break;
+    }
+}
+
+/* ==================== HEADLESS RUN ==================== */
+
+int headless_run(const char *preseed_path, const char *progress_format) {
+    bool json = strcmp(progress_format, "json") == 0;
+    if (!json && strcmp(progress_format, "text") != 0) {
+        fprintf(stderr, _("Unknown progress format '%s' (use text or json)\n"), progress_format);
+        return 2;
+    }
+
+    InstallerApp *app = installer_app_new();
+    if (!app) return 1;
+    app->headless = true;
+
+    GString *errors = g_string_new(NULL);
+    if (!preseed_load(preseed_path, &app->config, errors) || !preseed_validate(&app->config, errors)) {
+        fprintf(stderr, _("Invalid preseed %s:\n%s"), preseed_path, errors->str);
+        g_string_free(errors, TRUE);
+        ui_queue_free(app->ui_queue);
+        logstore_free(app->log_store);
+        pthread_mutex_destroy(&app->mutex);
+        free(app);
+        return 2;
+    }
+    g_string_free(errors, TRUE);
+
+    // El progreso sale por el stdout original; los mensajes de depuración
+    // del hilo (printf) pasan a stderr para no mezclarse con él
+    HeadlessOutput output = { 0 };
+    output.json = json;
+    output.last_pct = -1;
+    output.tty = isatty(STDOUT_FILENO);
+    int out_fd = dup(STDOUT_FILENO);
+    output.out = out_fd >= 0 ? fdopen(out_fd, "w") : NULL;
+    if (!output.out) output.out = stderr;
+    setvbuf(output.out, NULL, _IOLBF, 0);
+    fflush(stdout);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+
+    struct sigaction sa = { 0 };
+    sa.sa_handler = on_headless_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    app->config.installation_started = true;
+    int thread_result = pthread_create(&app->install_thread, NULL, run_installation_thread, app);
+    if (thread_result != 0) {
+        fprintf(stderr, _("Failed to create installation thread: %s\n"), strerror(thread_result));
+        ui_queue_close(app->ui_queue);
+    } else {
+        app->thread_running = true;
+    }
+
+    // Mismo ritmo que la interfaz; sin GTK no hace falta más
+    bool cancel_sent = false;
+    while (!ui_queue_finished(app->ui_queue)) {
+        const UiMessage *msg;
+        while ((msg = ui_queue_peek(app->ui_queue)) != NULL) {
+            headless_message(&output, app->log_store, msg);
+            ui_queue_release(app->ui_queue);
+        }
+        logstore_flush(app->log_store);
+
+        if (headless_interrupted && !cancel_sent) {
+            if (json) emit_json(&output, "status", -1, _("Interrupted, stopping installation..."));
+            else emit_text(&output, _("Interrupted, stopping installation..."), false);
+            cancel_installation(app);
+            cancel_sent = true;
+        }
+        g_usleep(UI_DRAIN_INTERVAL_MS * 1000);
+    }
+
+    if (app->thread_running) {
+        pthread_join(app->install_thread, NULL);
+    }
+    if (output.transient_shown) fputc('\n', output.out);
+
+    bool ok = app->exit_code == 0 || app->exit_code == 23 || app->exit_code == 24;
+    logstore_flush(app->log_store);
+    if (json) {
+        GString *line = g_string_new(NULL);
+        g_string_append_printf(line, "{\"type\":\"result\",\"ok\":%s,\"exit_code\":%d,\"log\":",
+                               ok ? "true" : "false", app->exit_code);
+        json_append_string(line, logstore_path(app->log_store));
+        if (!ok && app->last_error[0] != '\0') {
+            g_string_append(line, ",\"error\":");
+            json_append_string(line, app->last_error);
+        }
+        g_string_append(line, "}\n");
+        fputs(line->str, output.out);
+        g_string_free(line, TRUE);
+    } else {
+        fprintf(output.out, ok ? _("Installation completed successfully. Log: %s\n")
+                               : _("Installation failed. Log: %s\n"),
+                logstore_path(app->log_store));
+    }
+
+    if (output.out != stderr) fclose(output.out);
+    ui_queue_free(app->ui_queue);
+    logstore_free(app->log_store);
+    pthread_mutex_destroy(&app->mutex);
+    free(app);
+
+    return ok ? 0 : 1;
+}
@@ -6,74 +6,33 @@
 
 /* ==================== SYSTEM INFO FUNCTIONS ==================== */
 
-char** get_system_list(const char *command, int *count) {
-    FILE *fp;
-    char line[512];
-    char **list = NULL;
-    int capacity = 1000;
-    int i = 0;
-
-    list = malloc(capacity * sizeof(char*));
-    if (!list) return NULL;
+StrTable* get_system_list(const char *command) {
+    FILE *fp = popen(command, "r");
+    if (!fp) return NULL;
 
-    fp = popen(command, "r");
-    if (!fp) {
-        free(list);
-        return NULL;
-    }
-
-    while (fgets(line, sizeof(line), fp) && i < capacity) {
-        line[strcspn(line, "\n")] = 0;
-        if (strlen(line) > 0) {
-            list[i] = strdup(line);
-            i++;
-        }
+    StrTable *list = strtable_new();
+    if (list) {
+        strtable_read(list, fp);
     }
 
     pclose(fp);
-    *count = i;
     return list;
 }
 
-char** get_timezones(int *count) {
-    return get_system_list(SYSINFO_SCRIPT " timezones", count);
+StrTable* get_timezones(void) {
+    return get_system_list(SYSINFO_SCRIPT " timezones");
 }
 
-char** get_keyboard_layouts(int *count) {
-    return get_system_list(SYSINFO_SCRIPT " keyboards", count);
+StrTable* get_keyboard_layouts(void) {
+    return get_system_list(SYSINFO_SCRIPT " keyboards");
 }
 
-char** get_languages(int *count) {
-    return get_system_list(SYSINFO_SCRIPT " languages", count);
+StrTable* get_languages(void) {
+    return get_system_list(SYSINFO_SCRIPT " languages");
 }
 
-char** get_disks(int *count) {
-    FILE *fp;
-    char line[256];
-    char **disks = NULL;
-    int capacity = 20;
-    int i = 0;
-
-    disks = malloc(capacity * sizeof(char*));
-    if (!disks) return NULL;
-
-    fp = popen(SYSINFO_SCRIPT " disks", "r");
-    if (!fp) {
-        free(disks);
-        return NULL;
-    }
-
-    while (fgets(line, sizeof(line), fp) && i < capacity) {
-        line[strcspn(line, "\n")] = 0;
-        if (strlen(line) > 0) {
-            disks[i] = strdup(line);
-            i++;
-        }
-    }
-
-    pclose(fp);
-    *count = i;
-    return disks;
+StrTable* get_disks(void) {
+    return get_system_list(SYSINFO_SCRIPT " disks");
 }
 
 char* get_current_timezone(void) {
@@ -126,400 +85,524 @@ char* get_current_language(void) {
 
 /* ==================== INSTALLATION FUNCTIONS ==================== */
 
-void parse_installation_output(const char *line, InstallerApp *app) {
-    if (!line || !app) return;
-    printf("PARSING OUTPUT: %s\n", line);  // DEBUG
+/*
+ * Actualizaciones de UI desde el hilo de instalación: van a la cola SPSC y
+ * drain_ui_queue() las aplica por lotes en el hilo principal.
+ */
+static void post_log(InstallerApp *app, const char *text) {
+    ui_queue_push(app->ui_queue, UI_MSG_LOG, 0, text);
+}
 
-    // Detectar líneas de progreso de rsync (con o sin RSYNC_PROGRESS:)
-    if (strstr(line, "RSYNC_PROGRESS:") != NULL) {
-        // Formato: "RSYNC_PROGRESS: 12% 10.5MB/s 0:01:23"
-        const char *progress_info = line + strlen("RSYNC_PROGRESS:");
+static void post_log_replace(InstallerApp *app, const char *text) {
+    ui_queue_push(app->ui_queue, UI_MSG_LOG_REPLACE, 0, text);
+}
 
-        // Buscar porcentaje
-        char percent_str[10] = "0%";
-        char speed_str[20] = "0.0MB/s";
-        char time_str[10] = "0:00:00";
+static void post_status(InstallerApp *app, const char *message) {
+    ui_queue_push(app->ui_queue, UI_MSG_STATUS, 0, message);
+}
 
-        if (sscanf(progress_info, " %9[^ ] %19[^ ] %9[^ \n]",
-            percent_str, speed_str, time_str) >= 1) {
+static void post_progress(InstallerApp *app, int percent, const char *message) {
+    ui_queue_push(app->ui_queue, UI_MSG_PROGRESS, percent, message);
+}
 
-            // Actualizar la última línea del log
-            char clean_progress[256];
-        snprintf(clean_progress, sizeof(clean_progress), "Copying files: %s %s %s",
-                 percent_str, speed_str, time_str);
+/* Diálogos y botones: sin ventana (modo desatendido) no hay nada que actualizar */
+static void post_idle(InstallerApp *app, GSourceFunc func, gpointer data) {
+    if (!app->headless) g_idle_add(func, data);
+}
 
-        LogData *log_data = create_log_data(app, clean_progress);
-        if (log_data) {
-            g_idle_add(update_last_log_line_idle, log_data);
-        }
+/* El diálogo se queda con message */
+static void post_error_dialog(InstallerApp *app, char *message) {
+    ErrorData *edata = app->headless ? NULL : malloc(sizeof(ErrorData));
+    if (edata) {
+        edata->app = app;
+        edata->message = message;
+        g_idle_add((GSourceFunc)show_error_dialog, edata);
+    } else {
+        g_free(message);
+    }
+}
+
+/* ==================== PROGRESS ESTIMATE ==================== */
+
+static double monotonic_ms(void) {
+    return g_get_monotonic_time() / 1000.0;
+}
+
+/* Perfil de tiempos aprendido en este equipo; se superpone al del sistema */
+static gchar* user_stage_profile(void) {
+    return g_build_filename(g_get_user_cache_dir(), "loc-installer", "stage-profile", NULL);
+}
+
+static void load_stage_profiles(InstallerApp *app) {
+    progress_model_init(&app->progress);
+    progress_model_load(&app->progress, STAGE_PROFILE);
 
-        // También actualizar el status
-        StatusData *sdata = malloc(sizeof(StatusData));
-        if (sdata) {
-            sdata->app = app;
-            sdata->message = g_strdup_printf("Copying system files... %s %s",
-                                             percent_str, speed_str);
-            g_idle_add(update_status_ui, sdata);
+    gchar *path = user_stage_profile();
+    progress_model_load(&app->progress, path);
+    g_free(path);
+}
+
+static void save_stage_profile(InstallerApp *app) {
+    gchar *path = user_stage_profile();
+    gchar *dir = g_path_get_dirname(path);
+    bool ok = g_mkdir_with_parents(dir, 0700) == 0;
+
+    progress_model_finish(&app->progress, monotonic_ms(), ok ? path : NULL);
+    g_free(dir);
+    g_free(path);
+}
+
+/* Barra y ETA según el modelo de costes; llamado en cada vuelta del bucle de lectura */
+static void post_estimate(InstallerApp *app) {
+    if (!app->progress.planned) return;
+
+    long eta;
+    int pct = progress_model_estimate(&app->progress, monotonic_ms(), &eta);
+
+    char text[192];
+    if (eta > 0) {
+        snprintf(text, sizeof(text), "%s (%ld:%02ld left)", app->progress_msg, eta / 60, eta % 60);
+    } else {
+        g_strlcpy(text, app->progress_msg, sizeof(text));
+    }
+    post_progress(app, pct, text);
+}
+
+/* ==================== EVENT HANDLERS ==================== */
+
+static void on_event_plan(InstallerApp *app, const InstallerEvent *ev) {
+    progress_model_plan(&app->progress, ev->stages, ev->copy_bytes > 0 ? (double) ev->copy_bytes : 0,
+                        ev->disk_class);
+}
+
+static void on_event_stage(InstallerApp *app, const InstallerEvent *ev) {
+    g_strlcpy(app->progress_msg, ev->msg, sizeof(app->progress_msg));
+
+    // Con plan, la barra la calcula el modelo; el pct del script queda para scripts sin plan
+    if (app->progress.planned) {
+        if (strcmp(ev->stage, "done") != 0) {
+            progress_model_stage(&app->progress, ev->stage, monotonic_ms());
         }
+        post_estimate(app);
+    } else if (ev->pct >= 0 && ev->pct <= 100) {
+        post_progress(app, ev->pct, ev->msg);
+    }
+    post_status(app, ev->msg);
+}
+
+static void format_duration(char *buf, size_t size, long long ms) {
+    long long s = ms / 1000;
+    if (s >= 60) {
+        snprintf(buf, size, "%lldm %02llds", s / 60, s % 60);
+    } else {
+        snprintf(buf, size, "%lld.%llds", s, (ms % 1000) / 100);
+    }
+}
+
+static void on_event_stage_end(InstallerApp *app, const InstallerEvent *ev) {
+    if (app->stage_metric_count >= STAGE_METRICS_MAX) return;
+
+    StageMetrics *m = &app->stage_metrics[app->stage_metric_count++];
+    g_strlcpy(m->stage, ev->stage, sizeof(m->stage));
+    m->wall_ms = ev->wall_ms;
+    m->cpu_ms = ev->cpu_ms;
+    m->read_bytes = ev->read_bytes;
+    m->write_bytes = ev->write_bytes;
+    m->rss_kb = ev->rss_kb;
+
+    char wall[32], cpu[32];
+    format_duration(wall, sizeof(wall), m->wall_ms);
+    format_duration(cpu, sizeof(cpu), m->cpu_ms);
+    char *read = g_format_size(m->read_bytes > 0 ? m->read_bytes : 0);
+    char *written = g_format_size(m->write_bytes > 0 ? m->write_bytes : 0);
+    char *rss = g_format_size(m->rss_kb > 0 ? m->rss_kb * 1024 : 0);
+
+    char line[256];
+    snprintf(line, sizeof(line), "Stage %s: %s wall, %s CPU, %s read, %s written, %s peak RSS",
+             m->stage, wall, cpu, read, written, rss);
+    post_log(app, line);
+
+    g_free(read);
+    g_free(written);
+    g_free(rss);
+}
+
+/* Como g_format_size() (unidades SI), pero sin reservar memoria */
+static void format_size(char *buf, size_t size, long long bytes) {
+    static const char *units[] = { "kB", "MB", "GB", "TB", "PB" };
+
+    if (bytes < 1000) {
+        snprintf(buf, size, "%lld bytes", bytes > 0 ? bytes : 0);
         return;
-            }
     }
-    // Detectar líneas de progreso de rsync directas (sin RSYNC_PROGRESS:)
-    else if (strstr(line, "MB/s") != NULL || strstr(line, "KB/s") != NULL ||
-        strstr(line, "GB/s") != NULL) {
-        // Intentar extraer información
-        char percent_str[10] = "0%";
-    char speed_str[20] = "0.0MB/s";
-
-    // Buscar porcentaje (patrón: número seguido de %)
-    const char *p = line;
-    while (*p && !isdigit(*p)) p++;
-    if (isdigit(*p)) {
-        char *end;
-        long percent_num = strtol(p, &end, 10);
-        if (end > p && *end == '%') {
-            snprintf(percent_str, sizeof(percent_str), "%ld%%", percent_num);
-        }
+    double value = (double) bytes;
+    int unit = -1;
+    while (value >= 1000.0 && unit < 4) {
+        value /= 1000.0;
+        unit++;
     }
+    snprintf(buf, size, "%.1f %s", value, units[unit]);
+}
 
-    // Buscar velocidad (MB/s, KB/s, GB/s)
-    const char *speed_pos = strstr(line, "B/s");
-    if (speed_pos) {
-        // Retroceder para encontrar el número
-        const char *speed_start = speed_pos;
-        while (speed_start > line && (isdigit(*(speed_start-1)) ||
-            *(speed_start-1) == '.' || *(speed_start-1) == 'M' ||
-            *(speed_start-1) == 'K' || *(speed_start-1) == 'G')) {
-            speed_start--;
-            }
-            size_t speed_len = speed_pos - speed_start + 3; // +3 para "B/s"
-            if (speed_len < sizeof(speed_str)) {
-                strncpy(speed_str, speed_start, speed_len);
-                speed_str[speed_len] = '\0';
-            }
+static void on_event_copy(InstallerApp *app, const InstallerEvent *ev) {
+    progress_model_copy(&app->progress, (double) ev->bytes, (double) ev->rate, ev->pct);
+
+    // Llega muchas veces por segundo: todo en buffers de la pila
+    char copied[32], rate[32];
+    format_size(copied, sizeof(copied), ev->bytes);
+    format_size(rate, sizeof(rate), ev->rate);
+    char eta[32] = "";
+    if (ev->eta >= 0) {
+        snprintf(eta, sizeof(eta), "%ld:%02ld:%02ld", ev->eta / 3600, (ev->eta / 60) % 60, ev->eta % 60);
     }
 
-    // Actualizar última línea
-    char clean_progress[256];
-    snprintf(clean_progress, sizeof(clean_progress), "Copying: %s %s",
-             percent_str, speed_str);
+    char line[256];
+    if (ev->files_total > 0) {
+        snprintf(line, sizeof(line), "Copying files: %d%% %s, %ld/%ld files, %s/s %s",
+                 ev->pct, copied, ev->files, ev->files_total, rate, eta);
+    } else {
+        snprintf(line, sizeof(line), "Copying files: %d%% %s, %s/s %s", ev->pct, copied, rate, eta);
+    }
 
-    LogData *log_data = create_log_data(app, clean_progress);
-    if (log_data) {
-        g_idle_add(update_last_log_line_idle, log_data);
+    post_log_replace(app, line);
+
+    char status[128];
+    snprintf(status, sizeof(status), "Copying system files... %d%% %s/s", ev->pct, rate);
+    post_status(app, status);
+}
+
+static void on_event_log(InstallerApp *app, const InstallerEvent *ev) {
+    if (ev->sev >= SEV_WARN) {
+        post_status(app, ev->msg);
     }
-    return;
-        }
+}
 
-        // Para TODAS las otras líneas, añadir al log normalmente
-        if (strlen(line) > 0) {
-            LogData *log_data = create_log_data(app, line);
-            if (log_data) {
-                g_idle_add(append_to_log_idle, log_data);
-            }
-        }
+static void on_event_error(InstallerApp *app, const InstallerEvent *ev) {
+    // El diálogo se muestra al terminar el proceso, con este mensaje
+    g_strlcpy(app->last_error, ev->msg, sizeof(app->last_error));
+    printf("ERROR DETECTED (stage %s): %s\n", ev->stage, ev->msg);  // DEBUG
+    post_status(app, ev->msg);
+}
 
-        // Luego procesar comandos especiales para actualizar UI
-        if (strncmp(line, "PROGRESS:", 9) == 0) {
-            char *percent_str = strdup(line + 9);
-            if (!percent_str) return;
-            char *message = strchr(percent_str, ':');
-            if (message) {
-                *message = '\0';
-                message++;
-                char *endptr;
-                long percent = strtol(percent_str, &endptr, 10);
-                if (endptr != percent_str && percent >= 0 && percent <= 100) {
-                    ProgressData *pdata = malloc(sizeof(ProgressData));
-                    if (pdata) {
-                        pdata->app = app;
-                        pdata->percent = (int)percent;
-                        pdata->message = g_strdup(message);
-                        g_idle_add(update_progress_ui, pdata);
-                    }
-                }
-            }
-            free(percent_str);
-        }
-        else if (strncmp(line, "ERROR:", 6) == 0) {
-            ErrorData *edata = malloc(sizeof(ErrorData));
-            if (edata) {
-                edata->app = app;
-                edata->message = g_strdup(line + 6);
-                printf("ERROR DETECTED: %s\n", edata->message);  // DEBUG
-                g_idle_add((GSourceFunc)show_error_dialog, edata);
-            }
-        }
-        else if (strncmp(line, "SUCCESS:", 8) == 0) {
-            printf("SUCCESS DETECTED\n");  // DEBUG
-            g_idle_add((GSourceFunc)show_success_dialog, app);
-            app->config.installation_complete = true;
-            app->config.installation_started = false;
-            g_idle_add((GSourceFunc)update_navigation_buttons, app);
-
-            ProgressData *final_progress = malloc(sizeof(ProgressData));
-            if (final_progress) {
-                final_progress->app = app;
-                final_progress->percent = 100;
-                final_progress->message = g_strdup("Installation complete!");
-                g_idle_add(update_progress_ui, final_progress);
-            }
+static void on_event_done(InstallerApp *app, const InstallerEvent *ev) {
+    (void) ev;
+    printf("SUCCESS DETECTED\n");  // DEBUG
+    // Los tiempos de una simulación no dicen nada del disco real
+    if (app->progress.planned && !app->simulator) {
+        save_stage_profile(app);
+    }
+    post_idle(app, (GSourceFunc)show_success_dialog, app);
+    app->config.installation_complete = true;
+    app->config.installation_started = false;
+    post_idle(app, (GSourceFunc)update_navigation_buttons, app);
 
-            StatusData *sdata = malloc(sizeof(StatusData));
-            if (sdata) {
-                sdata->app = app;
-                sdata->message = g_strdup("Installation completed successfully!");
-                g_idle_add(update_status_ui, sdata);
-            }
-        }
-        else if (strncmp(line, "INFO:", 5) == 0) {
-            StatusData *sdata = malloc(sizeof(StatusData));
-            if (sdata) {
-                sdata->app = app;
-                sdata->message = g_strdup(line + 5);
-                g_idle_add(update_status_ui, sdata);
-            }
+    post_progress(app, 100, "Installation complete!");
+    post_status(app, "Installation completed successfully!");
+}
+
+typedef void (*EventHandler)(InstallerApp *app, const InstallerEvent *ev);
+
+static const EventHandler event_handlers[EV_COUNT] = {
+    [EV_PLAN]  = on_event_plan,
+    [EV_STAGE] = on_event_stage,
+    [EV_STAGE_END] = on_event_stage_end,
+    [EV_COPY]  = on_event_copy,
+    [EV_LOG]   = on_event_log,
+    [EV_ERROR] = on_event_error,
+    [EV_DONE]  = on_event_done,
+};
+
+/* Analiza la línea en su sitio (la modifica): el evento apunta dentro del
+ * buffer del lector de líneas, sin copias ni reservas de memoria */
+void parse_installation_output(char *line, InstallerApp *app) {
+    if (!line || !app) return;
+
+    // Eventos del protocolo (por el FIFO, o por stdout si no hay FIFO)
+    if (event_is_protocol_line(line)) {
+        InstallerEvent ev;
+        if (event_parse(line, &ev) && event_handlers[ev.type]) {
+            event_handlers[ev.type](app, &ev);
         }
-        else if (strlen(line) > 0) {
-            if (strchr(line, ':') &&
-                strncmp(line, "PROGRESS:", 9) != 0 &&
-                strncmp(line, "ERROR:", 6) != 0 &&
-                strncmp(line, "SUCCESS:", 8) != 0 &&
-                strncmp(line, "INFO:", 5) != 0) {
-                StatusData *sdata = malloc(sizeof(StatusData));
-            if (sdata) {
-                sdata->app = app;
-                sdata->message = g_strdup(line);
-                g_idle_add(update_status_ui, sdata);
-            }
-                }
-                else if (strlen(line) < 100) {
-                    StatusData *sdata = malloc(sizeof(StatusData));
-                    if (sdata) {
-                        sdata->app = app;
-                        sdata->message = g_strdup(line);
-                        g_idle_add(update_status_ui, sdata);
-                    }
-                }
+        return;
+    }
+
+    // El resto es salida de los comandos: solo va al log
+    if (line[0] != '\0') {
+        post_log(app, line);
+    }
+}
+
+/* ==================== OUTPUT READING ==================== */
+
+/* CPU del hilo de instalación: lo que cuesta procesar la salida del proceso */
+static gint64 thread_cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (gint64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void handle_output_line(char *line, void *data) {
+    InstallerApp *app = (InstallerApp*)data;
+
+    // rsync usa \r para sobreescribir la misma línea: quedarse con lo último
+    char *clean_line = line;
+    char *last_cr = strrchr(line, '\r');
+    if (last_cr) {
+        clean_line = last_cr + 1;
+        if (clean_line[0] == '\0' || clean_line[0] == ' ') {
+            return;
         }
+    }
+
+#ifdef DEBUG
+    printf("[INSTALLER] %s\n", clean_line);
+#endif
+    app->output_lines++;
+    parse_installation_output(clean_line, app);
 }
 
-void* run_installation_thread(void *data) {
+/* stderr: al log, y la primera línea como error si el script no envió ninguno */
+static void handle_error_line(char *line, void *data) {
     InstallerApp *app = (InstallerApp*)data;
 
-    printf("=== INSTALLATION THREAD STARTED ===\n");
+#ifdef DEBUG
+    printf("[INSTALLER:stderr] %s\n", line);
+#endif
+    app->output_lines++;
+    if (line[0] == '\0') return;
 
-    // Asegurarnos de que estamos en la pestaña de progreso
-    gtk_notebook_set_current_page(GTK_NOTEBOOK(app->notebook), TAB_PROGRESS);
-    g_idle_add((GSourceFunc)update_navigation_buttons, app);
+    post_log(app, line);
+    if (app->last_error[0] == '\0') {
+        g_strlcpy(app->last_error, line, sizeof(app->last_error));
+    }
+}
 
-    // Limpiar log anterior
-    g_idle_add(clear_log_idle, app);
+static void add_arg(GPtrArray *args, const char *format, ...) G_GNUC_PRINTF(2, 3);
 
-    // Mensaje inicial al log
-    LogData *init_log = create_log_data(app, "=== Starting LOC-OS Installation ===");
-    if (init_log) g_idle_add(append_to_log_idle, init_log);
+static void add_arg(GPtrArray *args, const char *format, ...) {
+    va_list ap;
+    va_start(ap, format);
+    g_ptr_array_add(args, g_strdup_vprintf(format, ap));
+    va_end(ap);
+}
 
-    // Mensaje de estado inicial
-    StatusData *initial_status = malloc(sizeof(StatusData));
-    if (initial_status) {
-        initial_status->app = app;
-        initial_status->message = g_strdup("Preparing installation...");
-        g_idle_add(update_status_ui, initial_status);
+/*
+ * Parámetros de bootloader: la lista de otros sistemas la genera el propio
+ * instalador (lsblk, sin montar nada) para que update-grub no ejecute os-prober.
+ * En modo automático se excluye el disco de destino, que se va a borrar
+ * (con RAID, todos los discos del array); en manual, las particiones elegidas,
+ * porque el resto del disco puede llevar otro sistema. Los discos de un fan-out acaban en
+ * otras máquinas, así que no llevan entradas de los sistemas de esta.
+ */
+static void add_bootloader_args(InstallerApp *app, GPtrArray *args) {
+    // Simulación: no se sondea ningún disco
+    if (!app->config.probe_other_os || app->simulator ||
+        (app->config.auto_partition && app->config.fanout_disks[0])) {
+        add_arg(args, "--os-prober=false");
+        return;
     }
 
-    // Progreso inicial
-    ProgressData *initial_progress = malloc(sizeof(ProgressData));
-    if (initial_progress) {
-        initial_progress->app = app;
-        initial_progress->percent = 0;
-        initial_progress->message = g_strdup("Starting...");
-        g_idle_add(update_progress_ui, initial_progress);
+    // Con RAID se borran todos los miembros: se excluyen todos (lista separada por comas)
+    char disks[sizeof(app->config.disk_device) + sizeof(app->config.raid_disks) + 1] = "";
+    if (app->config.auto_partition) {
+        g_strlcpy(disks, app->config.disk_device, sizeof(disks));
+        if (app->config.raid && app->config.raid_disks[0]) {
+            g_strlcat(disks, ",", sizeof(disks));
+            g_strlcat(disks, app->config.raid_disks, sizeof(disks));
+        }
+    } else {
+        const char *parts[] = {
+            app->config.root_partition, app->config.home_partition, app->config.boot_partition
+        };
+        for (size_t i = 0; i < G_N_ELEMENTS(parts); i++) {
+            if (!parts[i][0]) continue;
+            if (disks[0]) g_strlcat(disks, ",", sizeof(disks));
+            g_strlcat(disks, parts[i], sizeof(disks));
+        }
     }
 
-    // Construir comando de manera segura
-    char cmd[8192];
-    printf("Building installation command...\n");
+    char *exclude = g_shell_quote(disks);
+    char *probe_cmd = g_strdup_printf(SYSINFO_SCRIPT " other-os %s", exclude);
+    g_free(exclude);
 
-    // Escapar todos los parámetros para shell
-    char *escaped_disk = g_shell_quote(app->config.disk_device);
-    char *escaped_username = g_shell_quote(app->config.username);
-    char *escaped_realname = g_shell_quote(app->config.realname);
-    char *escaped_hostname = g_shell_quote(app->config.hostname);
-    char *escaped_password = g_shell_quote(app->config.password);
-    char *escaped_timezone = g_shell_quote(app->config.timezone);
-    char *escaped_keyboard = g_shell_quote(app->config.keyboard);
-    char *escaped_language = g_shell_quote(app->config.language);
-    char *escaped_keyboard_variant = g_shell_quote(app->config.keyboard_variant);
+    FILE *in = popen(probe_cmd, "r");
+    g_free(probe_cmd);
+    FILE *out = in ? fopen(OTHER_OS_LIST, "w") : NULL;
 
-    // IMPORTANTE: Escapar también la contraseña de root
-    char *escaped_root_password = g_shell_quote(app->config.root_password);
+    if (!in || !out) {
+        if (in) pclose(in);
+        // Sin lista: comportamiento anterior (os-prober en update-grub)
+        return;
+    }
 
-    // Construir la parte de la contraseña de root
-    char root_params[256] = "";
+    char line[512];
+    int found = 0;
+    while (fgets(line, sizeof(line), in)) {
+        if (strchr(line, '|')) {
+            fputs(line, out);
+            found++;
+        }
+    }
+    pclose(in);
+    fclose(out);
 
-    // SIEMPRE enviar root-password (ya sea misma que usuario o diferente)
-    if (strlen(app->config.root_password) > 0) {
-        snprintf(root_params, sizeof(root_params),
-                 "--root-password=%s ", escaped_root_password);
-        printf("DEBUG: Sending root password: %s\n", app->config.root_password);
+    printf("DEBUG: %d other operating system(s) detected\n", found);
+    add_arg(args, "--other-os=" OTHER_OS_LIST);
+}
+
+void* run_installation_thread(void *data) {
+    InstallerApp *app = (InstallerApp*)data;
+
+    printf("=== INSTALLATION THREAD STARTED ===\n");
+
+    // Asegurarnos de que estamos en la pestaña de progreso
+    if (!app->headless) {
+        gtk_notebook_set_current_page(GTK_NOTEBOOK(app->notebook), TAB_PROGRESS);
     }
+    post_idle(app, (GSourceFunc)update_navigation_buttons, app);
+
+    // Limpiar log anterior
+    ui_queue_push(app->ui_queue, UI_MSG_CLEAR_LOG, 0, NULL);
+    app->stage_metric_count = 0;
+    app->exit_code = -1;
+    load_stage_profiles(app);
+    g_strlcpy(app->progress_msg, "Starting...", sizeof(app->progress_msg));
+
+    // Mensaje inicial al log, estado y progreso iniciales
+    post_log(app, "=== Starting LOC-OS Installation ===");
+    char log_path_msg[512];
+    snprintf(log_path_msg, sizeof(log_path_msg), "Full log: %s", logstore_path(app->log_store));
+    post_log(app, log_path_msg);
+    post_status(app, "Preparing installation...");
+    post_progress(app, 0, "Starting...");
+
+    // Construir argv: sin shell, así que no hace falta escapar nada
+    printf("Building installation command...\n");
+    GPtrArray *args = g_ptr_array_new_with_free_func(g_free);
+    if (app->simulator) {
+        add_arg(args, "%s", app->simulator);
+    } else {
+        add_arg(args, "sudo");
+        add_arg(args, CORE_INSTALLER);
+    }
+    add_arg(args, "install");
 
     if (app->config.auto_partition) {
         printf("Using AUTO partitioning\n");
 
-        // Construir la parte de swap según el tipo
-        char swap_params[256] = "";
+        add_arg(args, "--disk=%s", app->config.disk_device);
+        add_arg(args, "--auto-partition=true");
+        add_arg(args, "--uefi-mode=%s", app->config.uefi_mode ? "true" : "false");
+        add_arg(args, "--sep-home=%s", app->config.separate_home ? "true" : "false");
+        add_arg(args, "--root-fs=%s", app->config.root_fs);
 
+        // Swap según el tipo
         if (app->config.add_swap) {
+            add_arg(args, "--add-swap=true");
             if (app->config.create_swapfile) {
-                snprintf(swap_params, sizeof(swap_params),
-                         "--add-swap=true "
-                         "--create-swapfile=true "
-                         "--swapfile-size=%d ",
-                         app->config.swap_size_mb);
+                add_arg(args, "--create-swapfile=true");
+                add_arg(args, "--swapfile-size=%d", app->config.swap_size_mb);
             } else {
-                snprintf(swap_params, sizeof(swap_params),
-                         "--add-swap=true "
-                         "--create-swapfile=false "
-                         "--swap-size=%d ",
-                         app->config.swap_size_mb);
+                add_arg(args, "--create-swapfile=false");
+                add_arg(args, "--swap-size=%d", app->config.swap_size_mb);
             }
         } else {
-            snprintf(swap_params, sizeof(swap_params),
-                     "--add-swap=false ");
+            add_arg(args, "--add-swap=false");
+        }
+
+        // RAID: --disk es el primer miembro, el resto va aparte
+        if (app->config.raid) {
+            add_arg(args, "--raid-level=%d", app->config.raid_level);
+            add_arg(args, "--raid-disks=%s", app->config.raid_disks);
         }
 
-        // En el comando para modo auto:
-        snprintf(cmd, sizeof(cmd),
-                 "sudo " CORE_INSTALLER " install "
-                 "--disk=%s "
-                 "--auto-partition=true "
-                 "--uefi-mode=%s "
-                 "--sep-home=%s "
-                 "%s"  // Swap params
-                 "--username=%s "
-                 "--realname=%s "
-                 "--hostname=%s "
-                 "--password=%s "
-                 "%s"  // Root password params (SIEMPRE enviarlo)
-        "--autologin=%s "
-        "--timezone=%s "
-        "--keyboard=%s "
-        "--keyboard-variant=%s "
-        "--language=%s "
-        "2>&1",
-        escaped_disk,
-        app->config.uefi_mode ? "true" : "false",
-        app->config.separate_home ? "true" : "false",
-        swap_params,
-        escaped_username,
-        escaped_realname,
-        escaped_hostname,
-        escaped_password,
-        root_params,  // <-- ESTO es lo que faltaba
-        app->config.autologin ? "true" : "false",
-        escaped_timezone,
-        escaped_keyboard,
-        escaped_keyboard_variant,
-        escaped_language);
+        // Fan-out: la misma instalación en otros discos a la vez
+        if (app->config.fanout_disks[0]) {
+            add_arg(args, "--fanout-disks=%s", app->config.fanout_disks);
+        }
     } else {
         printf("Using MANUAL partitioning\n");
 
-        // Construir parámetros de particiones
-        char partitions_params[1024] = "";
+        add_arg(args, "--auto-partition=false");
+        add_arg(args, "--uefi-mode=%s", app->config.uefi_mode ? "true" : "false");
 
+        // Parámetros de particiones
         if (strlen(app->config.root_partition) > 0) {
-            char *escaped_root = g_shell_quote(app->config.root_partition);
-            snprintf(partitions_params + strlen(partitions_params),
-                     sizeof(partitions_params) - strlen(partitions_params),
-                     "--root-part=%s ", escaped_root);
-            g_free(escaped_root);
+            add_arg(args, "--root-part=%s", app->config.root_partition);
         }
-
         if (app->config.separate_home && strlen(app->config.home_partition) > 0) {
-            char *escaped_home = g_shell_quote(app->config.home_partition);
-            snprintf(partitions_params + strlen(partitions_params),
-                     sizeof(partitions_params) - strlen(partitions_params),
-                     "--home-part=%s ", escaped_home);
-            g_free(escaped_home);
+            add_arg(args, "--home-part=%s", app->config.home_partition);
         }
-
         if (app->config.separate_boot && strlen(app->config.boot_partition) > 0) {
-            char *escaped_boot = g_shell_quote(app->config.boot_partition);
-            snprintf(partitions_params + strlen(partitions_params),
-                     sizeof(partitions_params) - strlen(partitions_params),
-                     "--boot-part=%s ", escaped_boot);
-            g_free(escaped_boot);
+            add_arg(args, "--boot-part=%s", app->config.boot_partition);
         }
-
         if (app->config.add_swap && strlen(app->config.swap_partition) > 0) {
-            char *escaped_swap = g_shell_quote(app->config.swap_partition);
-            snprintf(partitions_params + strlen(partitions_params),
-                     sizeof(partitions_params) - strlen(partitions_params),
-                     "--swap-part=%s ", escaped_swap);
-            g_free(escaped_swap);
+            add_arg(args, "--swap-part=%s", app->config.swap_partition);
         }
-
         if (app->config.uefi_mode && strlen(app->config.efi_partition) > 0) {
-            char *escaped_efi = g_shell_quote(app->config.efi_partition);
-            snprintf(partitions_params + strlen(partitions_params),
-                     sizeof(partitions_params) - strlen(partitions_params),
-                     "--efi-part=%s ", escaped_efi);
-            g_free(escaped_efi);
+            add_arg(args, "--efi-part=%s", app->config.efi_partition);
         }
+    }
+
+    add_bootloader_args(app, args);
 
-        snprintf(cmd, sizeof(cmd),
-                 "sudo " CORE_INSTALLER " install "
-                 "--auto-partition=false "
-                 "--uefi-mode=%s "
-                 "%s"  // Parámetros de particiones
-                 "--username=%s "
-                 "--realname=%s "
-                 "--hostname=%s "
-                 "--password=%s "
-                 "%s"  // Root password params (SIEMPRE enviarlo)
-        "--autologin=%s "
-        "--timezone=%s "
-        "--keyboard=%s "
-        "--keyboard-variant=%s "
-        "--language=%s "
-        "2>&1",
-        app->config.uefi_mode ? "true" : "false",
-        partitions_params,
-        escaped_username,
-        escaped_realname,
-        escaped_hostname,
-        escaped_password,
-        root_params,  // <-- ESTO es lo que faltaba
-        app->config.autologin ? "true" : "false",
-        escaped_timezone,
-        escaped_keyboard,
-        escaped_keyboard_variant,
-        escaped_language);
-    }
-
-    // Liberar strings escapados
-    g_free(escaped_disk);
-    g_free(escaped_username);
-    g_free(escaped_realname);
-    g_free(escaped_hostname);
-    g_free(escaped_password);
-    g_free(escaped_timezone);
-    g_free(escaped_keyboard);
-    g_free(escaped_language);
-    g_free(escaped_keyboard_variant);
-    g_free(escaped_root_password);  // Liberar la nueva
+    // Canal de eventos: FIFO privado, abierto en lectura/escritura para que nunca
+    // bloquee ni dé EOF; el fin lo marca el stdout del proceso
+    app->last_error[0] = '\0';
+    gchar *event_dir = g_dir_make_tmp("loc-installer-XXXXXX", NULL);
+    gchar *event_fifo = event_dir ? g_build_filename(event_dir, "events", NULL) : NULL;
+    int event_fd = -1;
 
+    if (event_fifo && mkfifo(event_fifo, 0600) == 0) {
+        event_fd = open(event_fifo, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    }
+    if (event_fd >= 0) {
+        add_arg(args, "--event-fifo=%s", event_fifo);
+    } else {
+        printf("WARNING: Event FIFO unavailable, events will arrive on stdout\n");
+    }
+
+    add_arg(args, "--username=%s", app->config.username);
+    add_arg(args, "--realname=%s", app->config.realname);
+    add_arg(args, "--hostname=%s", app->config.hostname);
+    add_arg(args, "--password=%s", app->config.password);
+
+    // SIEMPRE enviar root-password (ya sea misma que usuario o diferente)
+    if (strlen(app->config.root_password) > 0) {
+        add_arg(args, "--root-password=%s", app->config.root_password);
+        printf("DEBUG: Sending root password: %s\n", app->config.root_password);
+    }
+
+    add_arg(args, "--autologin=%s", app->config.autologin ? "true" : "false");
+    add_arg(args, "--timezone=%s", app->config.timezone);
+    add_arg(args, "--keyboard=%s", app->config.keyboard);
+    add_arg(args, "--keyboard-variant=%s", app->config.keyboard_variant);
+    add_arg(args, "--language=%s", app->config.language);
+    g_ptr_array_add(args, NULL);
+
+    char *cmd = g_strjoinv(" ", (char**) args->pdata);
     printf("DEBUG: Executing command (root password included): %s\n", cmd);
+    g_free(cmd);
 
     // Añadir comando al log (version segura sin contraseñas)
-    LogData *cmd_log = create_log_data(app, "=== Installation Command (passwords hidden) ===");
-    if (cmd_log) g_idle_add(append_to_log_idle, cmd_log);
+    post_log(app, "=== Installation Command (passwords hidden) ===");
 
     // Mostrar comando truncado por seguridad (sin contraseña)
     char safe_cmd[1024];
-    if (app->config.auto_partition) {
+    if (app->simulator) {
+        snprintf(safe_cmd, sizeof(safe_cmd),
+                 "Command: %s install (simulated backend, no disk is touched)", app->simulator);
+    } else if (app->config.auto_partition && app->config.raid) {
+        snprintf(safe_cmd, sizeof(safe_cmd),
+                 "Command: sudo " CORE_INSTALLER " install "
+                 "--disk=%s --raid-level=%d --raid-disks=%s --username=%s --hostname=%s "
+                 "(passwords hidden) ...",
+                 app->config.disk_device,
+                 app->config.raid_level,
+                 app->config.raid_disks,
+                 app->config.username,
+                 app->config.hostname);
+    } else if (app->config.auto_partition) {
         snprintf(safe_cmd, sizeof(safe_cmd),
                  "Command: sudo " CORE_INSTALLER " install "
                  "--disk=%s --username=%s --hostname=%s "
@@ -536,84 +619,154 @@ void* run_installation_thread(void *data) {
                  app->config.username,
                  app->config.hostname);
     }
-    LogData *safe_cmd_log = create_log_data(app, safe_cmd);
-    if (safe_cmd_log) g_idle_add(append_to_log_idle, safe_cmd_log);
-
-    // Ejecutar comando
-    printf("Opening pipe to installation command...\n");
-    FILE *fp = popen(cmd, "r");
-    if (!fp) {
-        printf("ERROR: Failed to popen command\n");
-        char *error_msg = g_strdup_printf(_("Failed to start installation process: %s"), strerror(errno));
-        LogData *error_log = create_log_data(app, error_msg);
-        if (error_log) g_idle_add(append_to_log_idle, error_log);
-
-        // Crear ErrorData y pasar a show_error_dialog
-        ErrorData *edata = malloc(sizeof(ErrorData));
-        if (edata) {
-            edata->app = app;
-            edata->message = error_msg;
-            g_idle_add((GSourceFunc)show_error_dialog, edata);
-        } else {
-            free(error_msg);
-        }
+    post_log(app, safe_cmd);
+
+    // Ejecutar comando en su propio grupo de procesos
+    printf("Spawning installation command...\n");
+    ChildProcess child;
+    int spawn_error = child_spawn(&child, (char**) args->pdata);
+    g_ptr_array_free(args, TRUE);
+
+    if (spawn_error != 0) {
+        printf("ERROR: Failed to spawn command\n");
+        char *error_msg = g_strdup_printf(_("Failed to start installation process: %s"), strerror(spawn_error));
+        post_log(app, error_msg);
+
+        post_error_dialog(app, error_msg);
+
+        if (event_fd >= 0) close(event_fd);
+        if (event_fifo) unlink(event_fifo);
+        if (event_dir) rmdir(event_dir);
+        g_free(event_fifo);
+        g_free(event_dir);
 
         app->config.installation_started = false;
         app->config.installation_complete = false;
-        g_idle_add((GSourceFunc)update_navigation_buttons, app);
+        post_idle(app, (GSourceFunc)update_navigation_buttons, app);
 
+        ui_queue_close(app->ui_queue);
         return NULL;
     }
 
+    pthread_mutex_lock(&app->mutex);
+    app->child_pgid = child.pid;
+    bool cancelled = app->cancel_requested;
+    pthread_mutex_unlock(&app->mutex);
+    if (cancelled) child_signal(&child, SIGTERM);
+
     printf("Command started, reading output...\n");
-    char line_buffer[2048];  // Buffer más grande
-    int line_count = 0;
 
     // Actualizar estado a "en progreso"
-    StatusData *running_status = malloc(sizeof(StatusData));
-    if (running_status) {
-        running_status->app = app;
-        running_status->message = g_strdup("Installation in progress...");
-        g_idle_add(update_status_ui, running_status);
-    }
-
-    while (fgets(line_buffer, sizeof(line_buffer), fp)) {
-        line_count++;
-
-        // Eliminar el \n al final si existe
-        line_buffer[strcspn(line_buffer, "\n")] = '\0';
-
-        // IMPORTANTE: Manejar los \r (retorno de carro) de rsync
-        // rsync usa \r para sobreescribir la misma línea
-        char *clean_line = line_buffer;
+    post_status(app, "Installation in progress...");
+
+    // Leer stdout, stderr y el FIFO de eventos a la vez
+    LineReader out_reader = { 0 };
+    LineReader err_reader = { 0 };
+    LineReader event_reader = { 0 };
+    bool out_open = true;
+    bool err_open = true;
+    gint64 kill_deadline = 0;
+    bool kill_sent = false;
+    bool still_running = false;
+    gint64 next_estimate = 0;
+    gint64 output_cpu_ns = 0;
+    app->output_lines = 0;
+
+    while (out_open || err_open) {
+        struct pollfd fds[3] = {
+            { .fd = out_open ? child.out_fd : -1, .events = POLLIN },
+            { .fd = err_open ? child.err_fd : -1, .events = POLLIN },
+            { .fd = event_fd,                     .events = POLLIN },
+        };
+
+        // Con timeout, para atender una cancelación aunque el hijo no escriba
+        if (poll(fds, 3, CHILD_POLL_MS) < 0 && errno != EINTR) {
+            break;
+        }
 
-        // Buscar el último \r en la línea
-        char *last_cr = strrchr(line_buffer, '\r');
-        if (last_cr) {
-            // Si hay un \r, usar solo lo que viene después del último \r
-            clean_line = last_cr + 1;
+        gint64 cpu_start = thread_cpu_ns();
+        if (fds[2].revents & POLLIN) {
+            line_reader_fill(&event_reader, event_fd, handle_output_line, app);
+        }
+        if (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+            out_open = line_reader_fill(&out_reader, child.out_fd, handle_output_line, app);
+        }
+        if (fds[1].revents & (POLLIN | POLLHUP | POLLERR)) {
+            err_open = line_reader_fill(&err_reader, child.err_fd, handle_error_line, app);
+        }
+        output_cpu_ns += thread_cpu_ns() - cpu_start;
 
-            // Si después del \r solo hay espacios o está vacío, ignorar esta línea
-            if (strlen(clean_line) == 0 || clean_line[0] == ' ') {
-                continue; // Saltar esta línea, es solo una actualización
-            }
+        // La barra avanza también durante etapas largas sin eventos
+        if (g_get_monotonic_time() >= next_estimate) {
+            post_estimate(app);
+            next_estimate = g_get_monotonic_time() + CHILD_POLL_MS * 1000;
         }
 
-        // DEBUG: Mostrar en consola también
-        printf("[INSTALLER:%03d] %s\n", line_count, clean_line);
-        fflush(stdout);  // Forzar salida inmediata
+        // Cancelación: SIGTERM al grupo y, pasado el plazo, SIGKILL. El script
+        // es de root: SIGKILL solo llega a sudo, así que el script ha terminado
+        // cuando se cierra su salida, no cuando se envía la señal
+        pthread_mutex_lock(&app->mutex);
+        cancelled = app->cancel_requested;
+        pthread_mutex_unlock(&app->mutex);
+        if (cancelled && kill_deadline == 0) {
+            kill_deadline = g_get_monotonic_time() + CHILD_KILL_GRACE_MS * 1000;
+        } else if (cancelled && !kill_sent && g_get_monotonic_time() > kill_deadline) {
+            child_signal(&child, SIGKILL);
+            kill_sent = true;
+            kill_deadline = g_get_monotonic_time() + CHILD_KILL_GRACE_MS * 1000;
+        } else if (kill_sent && g_get_monotonic_time() > kill_deadline) {
+            still_running = true;
+            break;
+        }
+    }
 
-        parse_installation_output(clean_line, app);
+    if (still_running) {
+        g_strlcpy(app->last_error,
+                  _("The installer did not stop and may still be running as root. "
+                    "Do not reboot or remove the disks until it finishes."),
+                  sizeof(app->last_error));
+        post_log(app, app->last_error);
     }
 
-    int exit_code = pclose(fp);
+    // Eventos que quedaran en el FIFO tras la salida del proceso, con un tope:
+    // si el script sigue escribiendo (no se le pudo matar) no se lee sin fin
+    if (event_fd >= 0) {
+        struct pollfd pending = { .fd = event_fd, .events = POLLIN };
+        gint64 drain_deadline = g_get_monotonic_time() + EVENT_DRAIN_MAX_MS * 1000;
+        while (g_get_monotonic_time() < drain_deadline &&
+               poll(&pending, 1, 0) > 0 && (pending.revents & POLLIN)) {
+            if (!line_reader_fill(&event_reader, event_fd, handle_output_line, app)) break;
+        }
+        line_reader_flush(&event_reader, handle_output_line, app);
+        close(event_fd);
+    }
+    line_reader_flush(&out_reader, handle_output_line, app);
+    line_reader_flush(&err_reader, handle_error_line, app);
+    line_reader_free(&out_reader);
+    line_reader_free(&err_reader);
+    line_reader_free(&event_reader);
+
+    if (event_fifo) unlink(event_fifo);
+    if (event_dir) rmdir(event_dir);
+    g_free(event_fifo);
+    g_free(event_dir);
+
+    int exit_code = child_wait(&child);
+    child_close(&child);
+    app->exit_code = exit_code;
+
+    pthread_mutex_lock(&app->mutex);
+    app->child_pgid = 0;
+    pthread_mutex_unlock(&app->mutex);
     printf("Command finished with exit code: %d\n", exit_code);
+    printf("Output processing: %ld lines, %.1f ms CPU, %.0f ns/line\n",
+           app->output_lines, output_cpu_ns / 1e6,
+           app->output_lines ? (double) output_cpu_ns / app->output_lines : 0.0);
 
     // Añadir código de salida al log
     char exit_msg[256];
     snprintf(exit_msg, sizeof(exit_msg), "=== Installation process finished with exit code: %d ===", exit_code);
-    LogData *exit_log = create_log_data(app, exit_msg);
-    if (exit_log) g_idle_add(append_to_log_idle, exit_log);
+    post_log(app, exit_msg);
 
     // Marcar instalación como completada
     app->config.installation_complete = true;
@@ -622,7 +775,7 @@ void* run_installation_thread(void *data) {
     printf("Installation marked as complete\n");
 
     // Actualizar navegación (mostrar botón Finish)
-    g_idle_add((GSourceFunc)update_navigation_buttons, app);
+    post_idle(app, (GSourceFunc)update_navigation_buttons, app);
 
     // Si la instalación fue exitosa, mostrar diálogo de éxito
     if (exit_code == 0 || exit_code == 23 || exit_code == 24) {
@@ -631,41 +784,81 @@ void* run_installation_thread(void *data) {
 
         app->config.installation_complete = true;
         app->config.installation_started = false;
-        g_idle_add((GSourceFunc)update_navigation_buttons, app);
+        post_idle(app, (GSourceFunc)update_navigation_buttons, app);
 
         // Mensaje de éxito al log
-        LogData *success_log = create_log_data(app, "=== Installation completed successfully! ===");
-        if (success_log) g_idle_add(append_to_log_idle, success_log);
+        post_log(app, "=== Installation completed successfully! ===");
 
         // Actualizar barra de progreso a 100%
-        ProgressData *final_progress = malloc(sizeof(ProgressData));
-        if (final_progress) {
-            final_progress->app = app;
-            final_progress->percent = 100;
-            final_progress->message = g_strdup("Installation complete!");
-            g_idle_add(update_progress_ui, final_progress);
-        }
+        post_progress(app, 100, "Installation complete!");
     } else {
         printf("Installation FAILED (exit code: %d)\n", exit_code);
-        char *error_msg = g_strdup_printf(_("Installation failed with exit code %d"), exit_code);
-        LogData *error_log = create_log_data(app, error_msg);
-        if (error_log) g_idle_add(append_to_log_idle, error_log);
-
-        // Crear ErrorData y pasar a show_error_dialog
-        ErrorData *edata = malloc(sizeof(ErrorData));
-        if (edata) {
-            edata->app = app;
-            edata->message = error_msg;
-            g_idle_add((GSourceFunc)show_error_dialog, edata);
-        } else {
-            free(error_msg);
-        }
+        char *error_msg = strlen(app->last_error) > 0
+            ? g_strdup_printf(_("Installation failed: %s"), app->last_error)
+            : g_strdup_printf(_("Installation failed with exit code %d"), exit_code);
+        post_log(app, error_msg);
+
+        post_error_dialog(app, error_msg);
     }
 
+    ui_queue_close(app->ui_queue);
+
     printf("=== INSTALLATION THREAD FINISHED ===\n");
     return NULL;
 }
 
+/* ==================== SIMULATION ==================== */
+
+// Con el backend simulado se mide cuánto se retrasa el bucle principal
+// respecto a una sonda periódica y cuánto cuesta cada vaciado de la cola
+#define LOOP_PROBE_MS   10
+
+void loop_stats_drain(InstallerApp *app, gint64 start_us, long messages) {
+    LoopStats *st = &app->loop_stats;
+    gint64 cost = g_get_monotonic_time() - start_us;
+
+    if (cost > st->drain_max_us) st->drain_max_us = cost;
+    st->drain_total_us += cost;
+    st->drains++;
+    st->messages += messages;
+}
+
+static void print_loop_stats(const LoopStats *st) {
+    printf("=== SIMULATION: main loop ===\n");
+    printf("probe every %d ms: %ld samples, late avg %.2f ms, max %.2f ms\n",
+           LOOP_PROBE_MS, st->probes,
+           st->probes ? st->late_total_us / 1000.0 / st->probes : 0.0, st->late_max_us / 1000.0);
+    printf("queue drains: %ld, %ld messages, cost avg %.2f ms, max %.2f ms\n",
+           st->drains, st->messages,
+           st->drains ? st->drain_total_us / 1000.0 / st->drains : 0.0, st->drain_max_us / 1000.0);
+}
+
+static gboolean probe_main_loop(gpointer data) {
+    InstallerApp *app = (InstallerApp*)data;
+    LoopStats *st = &app->loop_stats;
+    gint64 now = g_get_monotonic_time();
+
+    gint64 late = now - st->probe_due_us;
+    if (late < 0) late = 0;
+    if (late > st->late_max_us) st->late_max_us = late;
+    st->late_total_us += late;
+    st->probes++;
+    st->probe_due_us = now + LOOP_PROBE_MS * 1000;
+
+    // La cola ya se vació del todo: la instalación simulada ha terminado
+    if (app->ui_drain_source == 0) {
+        print_loop_stats(st);
+        return G_SOURCE_REMOVE;
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+static void start_loop_probe(InstallerApp *app) {
+    memset(&app->loop_stats, 0, sizeof(app->loop_stats));
+    app->loop_stats.probe_due_us = g_get_monotonic_time() + LOOP_PROBE_MS * 1000;
+    g_timeout_add(LOOP_PROBE_MS, probe_main_loop, app);
+}
+
 void start_installation(InstallerApp *app) {
     if (app->config.installation_started) {
         printf("DEBUG: Installation already started\n");
@@ -676,6 +869,7 @@ void start_installation(InstallerApp *app) {
 
     // Iniciar instalación
     app->config.installation_started = true;
+    app->cancel_requested = false;
 
     // Deshabilitar botones de navegación
     if (app->prev_btn) gtk_widget_set_sensitive(app->prev_btn, FALSE);
@@ -688,8 +882,16 @@ void start_installation(InstallerApp *app) {
     // Actualizar botones de navegación
     update_navigation_buttons(app);
 
+    ensure_tab_built(app, TAB_PROGRESS);
     gtk_label_set_text(GTK_LABEL(app->status_label), _("Starting installation..."));
 
+    // La cola se vacía en el hilo principal a ~30 Hz mientras dure el hilo
+    ui_queue_reset(app->ui_queue);
+    if (app->ui_drain_source == 0) {
+        app->ui_drain_source = g_timeout_add(UI_DRAIN_INTERVAL_MS, drain_ui_queue, app);
+    }
+    if (app->simulator) start_loop_probe(app);
+
     // Crear hilo de instalación
     int thread_result = pthread_create(&app->install_thread, NULL, run_installation_thread, app);
     if (thread_result != 0) {
@@ -702,6 +904,7 @@ void start_installation(InstallerApp *app) {
         gtk_dialog_run(GTK_DIALOG(error_dialog));
         gtk_widget_destroy(error_dialog);
 
+        ui_queue_close(app->ui_queue);
         app->config.installation_started = false;
         // Re-habilitar botones
         if (app->prev_btn) gtk_widget_set_sensitive(app->prev_btn, TRUE);
@@ -714,26 +917,141 @@ void start_installation(InstallerApp *app) {
     }
 }
 
-/* ==================== ENTRY POINT ==================== */
+static int compare_stage_wall(const void *a, const void *b) {
+    const StageMetrics *x = a, *y = b;
+    return (y->wall_ms > x->wall_ms) - (y->wall_ms < x->wall_ms);
+}
 
-int installer_run(int argc, char *argv[]) {
-    InstallerApp *app;
+/* Resumen para el diálogo de éxito: tiempo total y las etapas más lentas */
+char* format_stage_summary(InstallerApp *app) {
+    if (app->stage_metric_count == 0) return NULL;
 
-    setlocale(LC_ALL, "");
-    bindtextdomain("loc-installer", "/usr/share/locale");
-    textdomain("loc-installer");
+    StageMetrics sorted[STAGE_METRICS_MAX];
+    long long total = 0;
+    for (int i = 0; i < app->stage_metric_count; i++) {
+        sorted[i] = app->stage_metrics[i];
+        total += sorted[i].wall_ms;
+    }
+    qsort(sorted, app->stage_metric_count, sizeof(StageMetrics), compare_stage_wall);
 
-    gtk_init(&argc, &argv);
+    char buf[32];
+    format_duration(buf, sizeof(buf), total);
+    GString *summary = g_string_new(NULL);
+    g_string_append_printf(summary, _("Total time: %s"), buf);
+
+    for (int i = 0; i < app->stage_metric_count && i < 3; i++) {
+        format_duration(buf, sizeof(buf), sorted[i].wall_ms);
+        g_string_append_printf(summary, "\n  %s: %s (%lld%%)", sorted[i].stage, buf,
+                               total > 0 ? sorted[i].wall_ms * 100 / total : 0);
+    }
+    g_string_append_printf(summary, _("\nFull report: %s on the installed system"), STAGE_REPORT);
+
+    return g_string_free(summary, FALSE);
+}
+
+/*
+ * Pide al hilo que termine: SIGTERM al grupo del instalador (sudo lo reenvía
+ * al script, que lo propaga a sus hijos y cuyo trap restaura el sistema) y
+ * SIGKILL a sudo si no sale a tiempo.
+ */
+void cancel_installation(InstallerApp *app) {
+    pthread_mutex_lock(&app->mutex);
+    app->cancel_requested = true;
+    if (app->child_pgid > 0) {
+        kill(-app->child_pgid, SIGTERM);
+    }
+    pthread_mutex_unlock(&app->mutex);
+}
+
+/* ==================== STARTUP TIMING ==================== */
+
+// Con LOC_INSTALLER_DEBUG_STARTUP (o en la compilación de depuración) se
+// imprime en stderr el tiempo desde main() hasta cada hito del arranque
+static gint64 startup_start_us;
+static gint64 startup_last_us;
+static bool startup_debug;
+
+void startup_timing_begin(void) {
+    startup_start_us = startup_last_us = g_get_monotonic_time();
+#ifdef DEBUG
+    startup_debug = true;
+#else
+    startup_debug = getenv("LOC_INSTALLER_DEBUG_STARTUP") != NULL;
+#endif
+}
+
+void startup_timing_mark(const char *format, ...) {
+    if (!startup_debug) return;
+
+    gint64 now = g_get_monotonic_time();
+    char what[128];
+    va_list ap;
+    va_start(ap, format);
+    vsnprintf(what, sizeof(what), format, ap);
+    va_end(ap);
+
+    fprintf(stderr, "[startup] %8.1f ms (+%7.1f)  %s\n",
+            (now - startup_start_us) / 1000.0, (now - startup_last_us) / 1000.0, what);
+    startup_last_us = now;
+}
 
-    app = malloc(sizeof(InstallerApp));
+static gboolean on_first_frame(GtkWidget *widget, cairo_t *cr, gpointer data) {
+    (void)cr;
+    startup_timing_mark("first frame drawn");
+    g_signal_handlers_disconnect_by_func(widget, on_first_frame, data);
+    return FALSE;
+}
+
+void startup_timing_watch_first_frame(GtkWidget *window) {
+    if (!startup_debug) return;
+    g_signal_connect_after(window, "draw", G_CALLBACK(on_first_frame), NULL);
+}
+
+/* ==================== ENTRY POINT ==================== */
+
+// --simulate: vale para la interfaz y para el modo desatendido
+static const char *simulator_backend;
+
+/* Estado común a la interfaz y al modo desatendido: cola, log y configuración por defecto */
+InstallerApp* installer_app_new(void) {
+    InstallerApp *app = malloc(sizeof(InstallerApp));
     if (!app) {
         fprintf(stderr, _("Failed to allocate memory\n"));
-        return 1;
+        return NULL;
     }
 
     memset(app, 0, sizeof(InstallerApp));
     pthread_mutex_init(&app->mutex, NULL);
 
+    app->ui_queue = ui_queue_new();
+    if (!app->ui_queue) {
+        fprintf(stderr, _("Failed to allocate memory\n"));
+        free(app);
+        return NULL;
+    }
+
+    // Log completo de la instalación; el visor solo guarda las últimas líneas
+    gchar *log_path = NULL;
+    int log_fd = g_file_open_tmp("loc-installer-XXXXXX.log", &log_path, NULL);
+    if (log_fd >= 0) close(log_fd);
+    app->log_store = log_path ? logstore_new(log_path) : NULL;
+    g_free(log_path);
+    if (!app->log_store) {
+        fprintf(stderr, _("Failed to create installation log file\n"));
+        ui_queue_free(app->ui_queue);
+        free(app);
+        return NULL;
+    }
+    app->log_following = true;
+    app->log_match_line = -1;
+
+    // Copia comprimida para exportar; sin ella el visor funciona igual
+    gchar *sink_path = NULL;
+    int sink_fd = g_file_open_tmp("loc-installer-XXXXXX.log.zst", &sink_path, NULL);
+    if (sink_fd >= 0) close(sink_fd);
+    if (sink_path) logstore_set_sink(app->log_store, logsink_open(sink_path));
+    g_free(sink_path);
+
     /* Default configuration */
     app->config.uefi_mode = is_uefi_boot();
     app->config.auto_partition = true;
@@ -742,22 +1060,61 @@ int installer_run(int argc, char *argv[]) {
     app->config.add_swap = false;
     app->config.create_swapfile = false;
     app->config.swap_size_mb = 2048;
+    app->config.raid = false;
+    app->config.raid_level = 1;
+    g_strlcpy(app->config.root_fs, "ext4", sizeof(app->config.root_fs));
+    app->config.probe_other_os = true;
     app->config.autologin = false;
     app->config.same_root_password = true;
     app->config.installation_started = false;
     app->config.installation_complete = false;
     app->last_page = TAB_REGIONAL;
+    app->simulator = simulator_backend;
 
+    return app;
+}
+
+int installer_run(int argc, char *argv[]) {
+    InstallerApp *app;
+
+    setlocale(LC_ALL, "");
+    bindtextdomain("loc-installer", "/usr/share/locale");
+    textdomain("loc-installer");
+
+    // Con --preseed no hay ventana: ni gtk_init ni asistente
+    const char *preseed = NULL;
+    const char *progress = "text";
+    for (int i = 1; i < argc; i++) {
+        if (g_str_has_prefix(argv[i], "--preseed=")) {
+            preseed = argv[i] + strlen("--preseed=");
+        } else if (strcmp(argv[i], "--preseed") == 0 && i + 1 < argc) {
+            preseed = argv[++i];
+        } else if (g_str_has_prefix(argv[i], "--progress=")) {
+            progress = argv[i] + strlen("--progress=");
+        } else if (g_str_has_prefix(argv[i], "--simulate=")) {
+            simulator_backend = argv[i] + strlen("--simulate=");
+        } else if (strcmp(argv[i], "--simulate") == 0) {
+            simulator_backend = SIM_BACKEND;
+        }
+    }
+    if (preseed) {
+        return headless_run(preseed, progress);
+    }
+
+    gtk_init(&argc, &argv);
+    startup_timing_mark("gtk_init");
+
+    app = installer_app_new();
+    if (!app) return 1;
+    startup_timing_mark("application state");
+
+    // Solo la pestaña regional; el resto se construye al entrar en ella
     create_main_window(app);
+    startup_timing_mark("main window");
 
     gtk_widget_show_all(app->window);  // Mostrar TODO primero
-
-    // Ocultar los contenedores específicos
-    gtk_widget_hide(app->home_combo_container);
-    gtk_widget_hide(app->boot_combo_container);
-    gtk_widget_hide(app->swap_combo_container);
-    gtk_widget_hide(app->swap_options_container);
-    gtk_widget_hide(app->root_password_container);
+    startup_timing_watch_first_frame(app->window);
+    startup_timing_mark("window shown");
 
     // Establecer pestaña inicial usando constante
     gtk_notebook_set_current_page(GTK_NOTEBOOK(app->notebook), TAB_REGIONAL);
@@ -12,20 +12,66 @@
 #include <pthread.h>
 #include <locale.h>
 #include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <limits.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "events.h"
+#include "uiqueue.h"
+#include "logstore.h"
+#include "runner.h"
+#include "progress.h"
+#include "strtable.h"
 
 /* ==================== PATHS ==================== */
 #define SCRIPTS_DIR     "/usr/share/loc-installer/scripts/"
 #define SYSINFO_SCRIPT  SCRIPTS_DIR "get-system-info.sh"
 #define CORE_INSTALLER  SCRIPTS_DIR "core-installer.sh"
+#define SIM_BACKEND     SCRIPTS_DIR "loc-installer-sim"     /* --simulate */
+#define OTHER_OS_LIST   "/tmp/loc-installer-other-os.list"
+#define STAGE_REPORT    "/var/log/loc-installer-stages.json"    /* en el sistema instalado */
+#define STAGE_PROFILE   "/usr/share/loc-installer/stage-profile"    /* tiempos de referencia */
 
 /* ==================== CONSTANTS ==================== */
 #define TAB_REGIONAL     0
 #define TAB_PARTITIONING 1
 #define TAB_USER         2
 #define TAB_PROGRESS     3
+#define TAB_COUNT        4
+
+/* Líneas del log en el visor; el resto queda en el fichero de log */
+#define LOG_VIEW_LINES   500
+
+/* Líneas previas al error que se copian al portapapeles */
+#define COPY_ERROR_CONTEXT  60
+
+/* Proceso del instalador: cada cuánto se revisa una cancelación, cuánto
+ * se espera tras SIGTERM antes de SIGKILL y cuánto se siguen leyendo
+ * eventos del FIFO una vez terminado (el script root puede seguir vivo) */
+#define CHILD_POLL_MS        200
+#define CHILD_KILL_GRACE_MS  5000
+#define EVENT_DRAIN_MAX_MS   500
 
 /* ==================== STRUCTURES ==================== */
 
+#define STAGE_METRICS_MAX   16
+
+/* Métricas de una etapa del instalador (evento stage_end) */
+typedef struct {
+    char stage[16];
+    long long wall_ms;
+    long long cpu_ms;
+    long long read_bytes;
+    long long write_bytes;
+    long long rss_kb;
+} StageMetrics;
+
 typedef struct {
     char language[32];
     char timezone[64];
@@ -40,6 +86,12 @@ typedef struct {
     bool add_swap;
     bool create_swapfile;
     int swap_size_mb;
+    bool probe_other_os;
+    bool raid;                  /* raíz en RAID por software sobre disk_device y raid_disks */
+    int raid_level;             /* 0 (striped) o 1 (mirrored) */
+    char raid_disks[256];       /* discos adicionales, separados por comas */
+    char root_fs[16];           /* ext4, btrfs, xfs o f2fs (raíz y /home en automático) */
+    char fanout_disks[256];     /* misma instalación en estos discos, separados por comas */
 
     char username[32];
     char realname[64];
@@ -60,6 +112,18 @@ typedef struct {
     char efi_partition[64];
 } InstallConfig;
 
+/* Medidas del hilo principal con el backend simulado (--simulate) */
+typedef struct {
+    gint64 probe_due_us;        /* cuándo debería haber saltado la sonda */
+    gint64 late_max_us;
+    gint64 late_total_us;
+    long probes;
+    gint64 drain_max_us;        /* coste de cada vaciado de la cola */
+    gint64 drain_total_us;
+    long drains;
+    long messages;
+} LoopStats;
+
 typedef struct {
     GtkWidget *window;
     GtkWidget *notebook;
@@ -82,6 +146,7 @@ typedef struct {
 
     /* Partitioning */
     GtkWidget *disk_combo;
+    GtkWidget *root_fs_combo;
     GtkWidget *partition_notebook;
     GtkWidget *auto_radio;
     GtkWidget *manual_radio;
@@ -92,6 +157,10 @@ typedef struct {
     GtkWidget *swap_file_radio;
     GtkWidget *disk_info_label;
     GtkWidget *gparted_hbox;
+    GtkWidget *raid_check;
+    GtkWidget *raid_options_container;
+    GtkWidget *raid_level_combo;
+    GtkWidget *raid_disks_box;  /* un check por disco; el dispositivo va en "device" */
 
     /* Manual partition frame */
     GtkWidget *manual_frame;
@@ -108,6 +177,7 @@ typedef struct {
     GtkWidget *swap_combo_container;
     GtkWidget *add_swap_check_manual;
     GtkWidget *efi_combo;
+    GtkWidget *other_os_check;
 
     /* User */
     GtkWidget *username_entry;
@@ -126,18 +196,41 @@ typedef struct {
     GtkTextBuffer *log_buffer;
     GtkWidget *log_scrolled_window;
     GtkWidget *copy_log_btn;
+    GtkWidget *log_search_entry;
     GtkWidget *progress_label;
+    GtkTextTag *log_match_tag;
+    LogStore *log_store;
+    size_t log_view_first;      /* línea del fichero que ocupa la primera del visor */
+    long log_match_line;        /* última coincidencia de búsqueda, -1 si no hay */
+    bool log_following;         /* el visor sigue el final del log */
+    bool log_tail_transient;    /* la última línea del visor es progreso sobreescribible */
+    char last_error[512];
+    StageMetrics stage_metrics[STAGE_METRICS_MAX];
+    int stage_metric_count;
+    ProgressModel progress;     /* solo lo usa el hilo de instalación */
+    char progress_msg[128];     /* mensaje de la etapa en curso */
 
     InstallConfig config;
+    UiQueue *ui_queue;
+    guint ui_drain_source;
     pthread_t install_thread;
+    pid_t child_pgid;           /* grupo del proceso de instalación, 0 si no hay */
+    bool cancel_requested;      /* protegidos por mutex */
+    bool headless;              /* sin ventana: instalación desde un preseed */
+    const char *simulator;      /* backend simulado en lugar de core-installer.sh, o NULL */
+    LoopStats loop_stats;
+    int exit_code;              /* del proceso de instalación, -1 si no llegó a terminar */
+    long output_lines;          /* líneas leídas del proceso (stdout, stderr y eventos) */
     bool updating_partition_combos;
     bool thread_running;
+    bool closing;               /* ventana cerrada: se espera al hilo antes de destruirla */
     pthread_mutex_t mutex;
-    char **region_names;
-    char ***timezone_regions;
+    StrTable *tz_regions;       /* regiones de zona horaria, ordenadas e indexadas */
+    StrTable **tz_cities;       /* ciudades de cada región, en el mismo orden */
     char *current_keyboard_layout;
-    int region_count;
     int last_page;
+    GtkWidget *tab_pages[TAB_COUNT];   /* páginas del notebook; el contenido se crea al entrar */
+    bool tab_built[TAB_COUNT];
 } InstallerApp;
 
 
@@ -163,11 +256,11 @@ typedef struct {
 } ErrorData;
 
 /* ==================== SYSTEM INFO FUNCTIONS ==================== */
-char** get_system_list(const char *command, int *count);
-char** get_timezones(int *count);
-char** get_keyboard_layouts(int *count);
-char** get_languages(int *count);
-char** get_disks(int *count);
+StrTable* get_system_list(const char *command);
+StrTable* get_timezones(void);
+StrTable* get_keyboard_layouts(void);
+StrTable* get_languages(void);
+StrTable* get_disks(void);
 char* get_current_timezone(void);
 char* get_current_keyboard(void);
 char* get_current_language(void);
@@ -178,13 +271,11 @@ bool is_valid_username(const char *username);
 bool is_valid_hostname(const char *hostname);
 bool is_valid_password(const char *password);
 char* run_command(const char *cmd);
-char** list_partitions(int *count);
-void free_string_array(char **array, int count);
+StrTable* list_partitions(void);
 int get_disk_size_gb(const char *device);
 bool extract_device(const char *display_text, char *buffer, size_t buffer_size);
 int populate_partition_combo(GtkComboBoxText *combo, InstallerApp *app);
 void refresh_partition_combos(InstallerApp *app);
-int find_combo_item(GtkComboBoxText *combo, const char *search_text);
 char* extract_code(const char *text);
 
 /* Timezone functions */
@@ -194,6 +285,7 @@ void set_current_timezone(InstallerApp *app);
 char* get_selected_timezone(InstallerApp *app);
 
 void copy_log_to_clipboard(InstallerApp *app);
+void save_log_to_file(InstallerApp *app);
 void append_to_log(InstallerApp *app, const char *text);
 
 LogData* create_log_data(InstallerApp *app, const char *text);
@@ -208,6 +300,9 @@ void on_region_changed(GtkComboBox *combo, InstallerApp *app);
 void on_disk_changed(GtkComboBox *combo, InstallerApp *app);
 void on_partition_mode_toggled(GtkToggleButton *btn, InstallerApp *app);
 void on_add_swap_toggled(GtkToggleButton *btn, InstallerApp *app);
+void on_raid_toggled(GtkToggleButton *btn, InstallerApp *app);
+void update_raid_disk_checks(InstallerApp *app);
+bool collect_raid_disks(InstallerApp *app, char *buffer, size_t size);
 void on_swap_type_toggled(GtkToggleButton *btn, InstallerApp *app);
 void on_add_swap_manual_toggled(GtkToggleButton *btn, InstallerApp *app);
 void on_separate_home_manual_toggled(GtkToggleButton *btn, InstallerApp *app);
@@ -219,11 +314,12 @@ void on_install_clicked(GtkButton *btn, InstallerApp *app);
 void on_finish_clicked(GtkButton *btn, InstallerApp *app);
 void on_previous_clicked(GtkButton *btn, InstallerApp *app);
 void on_next_clicked(GtkButton *btn, InstallerApp *app);
+gboolean on_window_delete(GtkWidget *widget, GdkEvent *event, InstallerApp *app);
 void on_window_destroy(GtkWidget *widget, InstallerApp *app);
 void on_partition_combo_changed(GtkComboBox *combo, InstallerApp *app);
 
 /* ==================== KEYBOARD FUNCTIONS ==================== */
-void setup_current_keyboard_in_ui(InstallerApp *app);
+void setup_current_keyboard_in_ui(InstallerApp *app, StrTable *layouts);
 void on_keyboard_layout_changed(GtkComboBox *combo, InstallerApp *app);
 void on_keyboard_variant_changed(GtkComboBox *combo, InstallerApp *app);
 void update_keyboard_variants(InstallerApp *app, const char *layout_code);
@@ -235,7 +331,9 @@ GtkWidget* create_partition_tab(InstallerApp *app);
 GtkWidget* create_user_tab(InstallerApp *app);
 GtkWidget* create_progress_tab(InstallerApp *app);
 void create_main_window(InstallerApp *app);
+void ensure_tab_built(InstallerApp *app, int page);
 void update_last_log_line(InstallerApp *app, const char *text);
+void log_view_follow(InstallerApp *app);
 
 /* ==================== GTK IDLE FUNCTIONS ==================== */
 /* Actualiza las declaraciones */
@@ -245,13 +343,30 @@ gboolean show_error_dialog(ErrorData *edata);
 gboolean show_success_dialog(InstallerApp *app);
 gboolean enable_close_button(gpointer data);
 gboolean update_last_log_line_idle(gpointer data);
+gboolean drain_ui_queue(gpointer data);
 
 /* ==================== INSTALLATION FUNCTIONS ==================== */
 void start_installation(InstallerApp *app);
 void* run_installation_thread(void *data);
-void parse_installation_output(const char *line, InstallerApp *app);
+void cancel_installation(InstallerApp *app);
+char* format_stage_summary(InstallerApp *app);
+void parse_installation_output(char *line, InstallerApp *app);
+
+/* ==================== HEADLESS FUNCTIONS ==================== */
+bool preseed_load(const char *path, InstallConfig *config, GString *errors);
+bool preseed_validate(InstallConfig *config, GString *errors);
+int headless_run(const char *preseed_path, const char *progress_format);
+
+/* ==================== SIMULATION ==================== */
+void loop_stats_drain(InstallerApp *app, gint64 start_us, long messages);
+
+/* ==================== STARTUP TIMING ==================== */
+void startup_timing_begin(void);
+void startup_timing_mark(const char *format, ...) G_GNUC_PRINTF(1, 2);
+void startup_timing_watch_first_frame(GtkWidget *window);
 
 /* ==================== ENTRY POINT ==================== */
+InstallerApp* installer_app_new(void);
 int installer_run(int argc, char *argv[]);
 
 #endif /* INSTALLER_H */
@@ -0,0 +1,239 @@
+/*
+ * logsink.c - Background zstd log writer for LOC-OS 24 Installer (sin dependencias de GTK)
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <zstd.h>
+#include "logsink.h"
+
+/* ==================== HELPERS ==================== */
+
+static bool write_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        buf += n;
+        len -= (size_t) n;
+    }
+    return true;
+}
+
+static bool buffer_append(SinkBuffer *b, const char *data, size_t len) {
+    if (b->len + len > b->cap) {
+        size_t cap = b->cap ? b->cap : 64 * 1024;
+        while (cap < b->len + len) cap *= 2;
+        char *grown = realloc(b->data, cap);
+        if (!grown) return false;
+        b->data = grown;
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+    return true;
+}
+
+static void deadline_after(struct timespec *ts, long ms) {
+    clock_gettime(CLOCK_MONOTONIC, ts);
+    ts->tv_sec += ms / 1000;
+    ts->tv_nsec += (ms % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+static bool deadline_passed(const struct timespec *ts) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec > ts->tv_sec || (now.tv_sec == ts->tv_sec && now.tv_nsec >= ts->tv_nsec);
+}
+
+/* Comprime src (o cierra el frame con ZSTD_e_end) y escribe la salida */
+static bool sink_compress(LogSink *sink, const char *src, size_t len, ZSTD_EndDirective mode) {
+    char out_buf[64 * 1024];
+    ZSTD_inBuffer in = { src, len, 0 };
+
+    for (;;) {
+        ZSTD_outBuffer out = { out_buf, sizeof(out_buf), 0 };
+        size_t remaining = ZSTD_compressStream2(sink->cctx, &out, &in, mode);
+        if (ZSTD_isError(remaining)) return false;
+        if (!write_all(sink->fd, out_buf, out.pos)) return false;
+
+        bool done = mode == ZSTD_e_end ? remaining == 0 : in.pos == in.size;
+        if (done) return true;
+    }
+}
+
+/* ==================== SINK THREAD ==================== */
+
+static void* sink_thread(void *data) {
+    LogSink *sink = (LogSink*)data;
+    SinkBuffer work = { 0 };
+    struct timespec frame_deadline;
+    bool frame_open = false;
+    size_t frame_bytes = 0;
+
+    pthread_mutex_lock(&sink->lock);
+    for (;;) {
+        while (!sink->stop && !sink->reset_requested && sink->pending.len == 0 &&
+               sink->sync_requested == sink->sync_done &&
+               !(frame_open && deadline_passed(&frame_deadline))) {
+            if (frame_open) {
+                pthread_cond_timedwait(&sink->wake, &sink->lock, &frame_deadline);
+            } else {
+                pthread_cond_wait(&sink->wake, &sink->lock);
+            }
+        }
+
+        // Intercambiar búferes: el productor sigue con uno vacío
+        SinkBuffer taken = sink->pending;
+        sink->pending = work;
+        work = taken;
+
+        bool reset = sink->reset_requested;
+        bool stop = sink->stop;
+        bool failed = sink->failed;
+        unsigned long sync = sink->sync_requested;
+        sink->reset_requested = false;
+        pthread_mutex_unlock(&sink->lock);
+
+        if (reset) {
+            ZSTD_CCtx_reset(sink->cctx, ZSTD_reset_session_only);
+            failed = ftruncate(sink->fd, 0) != 0 || lseek(sink->fd, 0, SEEK_SET) != 0;
+            frame_open = false;
+            frame_bytes = 0;
+        }
+
+        if (!failed && work.len > 0) {
+            failed = !sink_compress(sink, work.data, work.len, ZSTD_e_continue);
+            if (!frame_open) {
+                frame_open = true;
+                deadline_after(&frame_deadline, LOGSINK_FRAME_MS);
+            }
+            frame_bytes += work.len;
+        }
+        work.len = 0;
+
+        if (!failed && frame_open &&
+            (stop || sync != sink->sync_done || frame_bytes >= LOGSINK_FRAME_BYTES ||
+             deadline_passed(&frame_deadline))) {
+            failed = !sink_compress(sink, NULL, 0, ZSTD_e_end);
+            frame_open = false;
+            frame_bytes = 0;
+        }
+
+        pthread_mutex_lock(&sink->lock);
+        sink->failed = failed;
+        if (sync != sink->sync_done) {
+            sink->sync_done = sync;
+            pthread_cond_broadcast(&sink->synced);
+        }
+        if (stop) break;
+    }
+    pthread_mutex_unlock(&sink->lock);
+
+    free(work.data);
+    return NULL;
+}
+
+/* ==================== SINK ==================== */
+
+LogSink* logsink_open(const char *path) {
+    LogSink *sink = calloc(1, sizeof(LogSink));
+    if (!sink) return NULL;
+
+    sink->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    sink->cctx = ZSTD_createCCtx();
+    sink->path = strdup(path);
+    if (sink->fd < 0 || !sink->cctx || !sink->path) goto fail;
+
+    ZSTD_CCtx_setParameter(sink->cctx, ZSTD_c_compressionLevel, LOGSINK_LEVEL);
+    ZSTD_CCtx_setParameter(sink->cctx, ZSTD_c_checksumFlag, 1);
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&sink->lock, NULL);
+    pthread_cond_init(&sink->wake, &attr);
+    pthread_cond_init(&sink->synced, NULL);
+    pthread_condattr_destroy(&attr);
+
+    if (pthread_create(&sink->thread, NULL, sink_thread, sink) != 0) {
+        pthread_mutex_destroy(&sink->lock);
+        pthread_cond_destroy(&sink->wake);
+        pthread_cond_destroy(&sink->synced);
+        goto fail;
+    }
+    return sink;
+
+fail:
+    if (sink->fd >= 0) close(sink->fd);
+    ZSTD_freeCCtx(sink->cctx);
+    free(sink->path);
+    free(sink);
+    return NULL;
+}
+
+void logsink_close(LogSink *sink) {
+    if (!sink) return;
+
+    pthread_mutex_lock(&sink->lock);
+    sink->stop = true;
+    pthread_cond_signal(&sink->wake);
+    pthread_mutex_unlock(&sink->lock);
+    pthread_join(sink->thread, NULL);
+
+    pthread_mutex_destroy(&sink->lock);
+    pthread_cond_destroy(&sink->wake);
+    pthread_cond_destroy(&sink->synced);
+    ZSTD_freeCCtx(sink->cctx);
+    close(sink->fd);
+    free(sink->pending.data);
+    free(sink->path);
+    free(sink);
+}
+
+void logsink_write(LogSink *sink, const char *line) {
+    pthread_mutex_lock(&sink->lock);
+    if (!sink->failed) {
+        bool was_empty = sink->pending.len == 0;
+        if (buffer_append(&sink->pending, line, strlen(line)) &&
+            buffer_append(&sink->pending, "\n", 1) && was_empty) {
+            pthread_cond_signal(&sink->wake);
+        }
+    }
+    pthread_mutex_unlock(&sink->lock);
+}
+
+void logsink_reset(LogSink *sink) {
+    pthread_mutex_lock(&sink->lock);
+    sink->pending.len = 0;
+    sink->reset_requested = true;
+    sink->failed = false;
+    pthread_cond_signal(&sink->wake);
+    pthread_mutex_unlock(&sink->lock);
+}
+
+bool logsink_sync(LogSink *sink) {
+    pthread_mutex_lock(&sink->lock);
+    unsigned long ticket = ++sink->sync_requested;
+    pthread_cond_signal(&sink->wake);
+    while (sink->sync_done < ticket) {
+        pthread_cond_wait(&sink->synced, &sink->lock);
+    }
+    bool ok = !sink->failed;
+    pthread_mutex_unlock(&sink->lock);
+    return ok;
+}
+
+const char* logsink_path(const LogSink *sink) {
+    return sink->path;
+}
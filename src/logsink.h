@@ -0,0 +1,59 @@
+#ifndef LOGSINK_H
+#define LOGSINK_H
+
+/*
+ * logsink.h - Background zstd-compressed copy of the install log (sin dependencias de GTK)
+ *
+ * El hilo que escribe solo añade a un búfer en memoria; un hilo propio
+ * comprime en streaming y escribe el fichero. Cada LOGSINK_FRAME_MS (o al
+ * sincronizar) se cierra el frame zstd, así que el fichero es siempre una
+ * secuencia de frames completos que zstdcat puede leer, también a medias.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#define LOGSINK_LEVEL       3
+#define LOGSINK_FRAME_MS    1000
+#define LOGSINK_FRAME_BYTES (4 * 1024 * 1024)   /* entrada máxima por frame */
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} SinkBuffer;
+
+typedef struct {
+    int fd;
+    char *path;
+    void *cctx;                 /* ZSTD_CCtx */
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;        /* hay trabajo para el hilo */
+    pthread_cond_t synced;      /* el hilo terminó un sync */
+    SinkBuffer pending;         /* protegido por lock */
+    unsigned long sync_requested;
+    unsigned long sync_done;
+    bool reset_requested;
+    bool stop;
+    bool failed;                /* error de escritura o de zstd: se deja de escribir */
+} LogSink;
+
+/* Crea (truncando) path y arranca el hilo. NULL si falla. */
+LogSink* logsink_open(const char *path);
+
+/* Termina el frame actual, espera al hilo y cierra el fichero */
+void logsink_close(LogSink *sink);
+
+void logsink_write(LogSink *sink, const char *line);
+
+/* Vacía el fichero para una instalación nueva */
+void logsink_reset(LogSink *sink);
+
+/* Espera a que todo lo escrito esté comprimido en el fichero. false si falló. */
+bool logsink_sync(LogSink *sink);
+
+const char* logsink_path(const LogSink *sink);
+
+#endif /* LOGSINK_H */
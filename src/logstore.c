@@ -0,0 +1,207 @@
+/*
+ * logstore.c - On-disk install log for LOC-OS 24 Installer (sin dependencias de GTK)
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "logstore.h"
+
+/* ==================== HELPERS ==================== */
+
+static void write_line(LogStore *store, const char *line) {
+    // Sin memoria para el índice la línea se escribe igual; las siguientes se
+    // leen avanzando desde la última entrada (ver seek_line)
+    if (store->lines % LOGSTORE_STRIDE == 0 && !store->index_full) {
+        if (store->index_len == store->index_cap) {
+            size_t cap = store->index_cap ? store->index_cap * 2 : 64;
+            off_t *index = realloc(store->index, cap * sizeof(off_t));
+            if (index) {
+                store->index = index;
+                store->index_cap = cap;
+            } else {
+                store->index_full = true;
+            }
+        }
+        if (!store->index_full) store->index[store->index_len++] = store->size;
+    }
+
+    size_t len = strlen(line);
+    fwrite(line, 1, len, store->fp);
+    fputc('\n', store->fp);
+    store->size += (off_t) len + 1;
+    store->lines++;
+
+    if (store->sink) logsink_write(store->sink, line);
+}
+
+/* Coloca el fichero al principio de la línea n */
+static bool seek_line(LogStore *store, size_t n, char **buf, size_t *cap) {
+    if (n >= store->lines) return false;
+
+    fflush(store->fp);
+    size_t k = n / LOGSTORE_STRIDE;
+    if (k >= store->index_len) k = store->index_len ? store->index_len - 1 : 0;
+    off_t start = store->index_len ? store->index[k] : 0;
+    if (fseeko(store->fp, start, SEEK_SET) != 0) return false;
+
+    for (size_t skip = n - k * LOGSTORE_STRIDE; skip > 0; skip--) {
+        if (getline(buf, cap, store->fp) < 0) return false;
+    }
+    return true;
+}
+
+/* Tras leer, volver al final: las escrituras siguientes añaden */
+static void seek_end(LogStore *store) {
+    fseeko(store->fp, 0, SEEK_END);
+}
+
+/* ==================== STORE ==================== */
+
+LogStore* logstore_new(const char *path) {
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0600);
+    if (fd < 0) return NULL;
+
+    LogStore *store = calloc(1, sizeof(LogStore));
+    FILE *fp = fdopen(fd, "a+");
+    if (!store || !fp) {
+        if (fp) fclose(fp); else close(fd);
+        free(store);
+        return NULL;
+    }
+
+    store->fp = fp;
+    store->path = strdup(path);
+    return store;
+}
+
+void logstore_free(LogStore *store) {
+    if (!store) return;
+    logsink_close(store->sink);
+    fclose(store->fp);
+    free(store->path);
+    free(store->index);
+    free(store->transient);
+    free(store);
+}
+
+void logstore_set_sink(LogStore *store, LogSink *sink) {
+    logsink_close(store->sink);
+    store->sink = sink;
+}
+
+LogSink* logstore_sink(const LogStore *store) {
+    return store->sink;
+}
+
+void logstore_reset(LogStore *store) {
+    if (store->sink) logsink_reset(store->sink);
+    fflush(store->fp);
+    if (ftruncate(fileno(store->fp), 0) != 0) return;
+    seek_end(store);
+
+    store->lines = 0;
+    store->size = 0;
+    store->index_len = 0;
+    store->index_full = false;
+    free(store->transient);
+    store->transient = NULL;
+}
+
+void logstore_append(LogStore *store, const char *line) {
+    // La última línea transitoria queda en el log al llegar otra normal
+    if (store->transient) {
+        write_line(store, store->transient);
+        free(store->transient);
+        store->transient = NULL;
+    }
+    write_line(store, line);
+}
+
+void logstore_set_transient(LogStore *store, const char *line) {
+    free(store->transient);
+    store->transient = strdup(line);
+}
+
+void logstore_flush(LogStore *store) {
+    fflush(store->fp);
+}
+
+size_t logstore_line_count(const LogStore *store) {
+    return store->lines;
+}
+
+const char* logstore_transient(const LogStore *store) {
+    return store->transient;
+}
+
+const char* logstore_path(const LogStore *store) {
+    return store->path;
+}
+
+/* ==================== PAGING AND SEARCH ==================== */
+
+char* logstore_read_lines(LogStore *store, size_t first, size_t count) {
+    char *line = NULL;
+    size_t line_cap = 0;
+    char *out = NULL;
+    size_t out_len = 0;
+
+    if (seek_line(store, first, &line, &line_cap)) {
+        ssize_t n;
+        while (count-- > 0 && (n = getline(&line, &line_cap, store->fp)) > 0) {
+            char *grown = realloc(out, out_len + (size_t) n + 1);
+            if (!grown) break;
+            out = grown;
+            memcpy(out + out_len, line, (size_t) n);
+            out_len += (size_t) n;
+        }
+    }
+    seek_end(store);
+    free(line);
+
+    if (!out) return strdup("");
+
+    // Sin el '\n' final
+    if (out_len > 0 && out[out_len - 1] == '\n') out_len--;
+    out[out_len] = '\0';
+    return out;
+}
+
+long logstore_find(LogStore *store, const char *needle, size_t from, bool forward) {
+    char *line = NULL;
+    size_t line_cap = 0;
+    long found = -1;
+
+    if (!needle || !*needle) return -1;
+
+    if (forward) {
+        size_t n = from + 1;
+        if (seek_line(store, n, &line, &line_cap)) {
+            for (; n < store->lines && getline(&line, &line_cap, store->fp) >= 0; n++) {
+                if (strcasestr(line, needle)) {
+                    found = (long) n;
+                    break;
+                }
+            }
+        }
+    } else {
+        // Hacia atrás por bloques del índice; dentro de cada bloque, la última coincidencia
+        size_t end = from < store->lines ? from : store->lines;
+        while (end > 0 && found < 0) {
+            size_t start = (end - 1) / LOGSTORE_STRIDE * LOGSTORE_STRIDE;
+            if (!seek_line(store, start, &line, &line_cap)) break;
+
+            for (size_t n = start; n < end && getline(&line, &line_cap, store->fp) >= 0; n++) {
+                if (strcasestr(line, needle)) found = (long) n;
+            }
+            end = start;
+        }
+    }
+
+    seek_end(store);
+    free(line);
+    return found;
+}
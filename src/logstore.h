@@ -0,0 +1,63 @@
+#ifndef LOGSTORE_H
+#define LOGSTORE_H
+
+/*
+ * logstore.h - On-disk install log with sparse line index (sin dependencias de GTK)
+ *
+ * El log completo va a un fichero; en memoria solo queda un índice con el
+ * offset de cada LOGSTORE_STRIDE líneas, así que leer una página o buscar
+ * cuesta una lectura del fichero y la memoria no crece con la salida.
+ *
+ * La línea "transitoria" (progreso de rsync que se sobreescribe) no se
+ * escribe hasta que llega la siguiente línea normal.
+ *
+ * Opcionalmente cada línea escrita se copia también a un LogSink (copia
+ * comprimida para exportar), del que el store pasa a ser dueño.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include "logsink.h"
+
+#define LOGSTORE_STRIDE     256
+
+typedef struct {
+    FILE *fp;
+    char *path;
+    size_t lines;               /* líneas escritas */
+    off_t size;                 /* bytes escritos */
+    off_t *index;               /* index[k] = offset de la línea k * LOGSTORE_STRIDE */
+    size_t index_len;
+    size_t index_cap;
+    bool index_full;            /* sin memoria para el índice: no se indexa más */
+    char *transient;
+    LogSink *sink;
+} LogStore;
+
+/* Abre (truncando) path. NULL si no se puede crear. */
+LogStore* logstore_new(const char *path);
+void logstore_free(LogStore *store);
+void logstore_set_sink(LogStore *store, LogSink *sink);
+LogSink* logstore_sink(const LogStore *store);
+
+void logstore_reset(LogStore *store);
+void logstore_append(LogStore *store, const char *line);
+void logstore_set_transient(LogStore *store, const char *line);
+void logstore_flush(LogStore *store);
+
+size_t logstore_line_count(const LogStore *store);
+const char* logstore_transient(const LogStore *store);
+const char* logstore_path(const LogStore *store);
+
+/* Líneas [first, first + count) unidas con '\n'. El llamador libera el resultado. */
+char* logstore_read_lines(LogStore *store, size_t first, size_t count);
+
+/*
+ * Primera línea que contiene needle (sin distinguir mayúsculas) después de
+ * from si forward, o la última antes de from si no. -1 si no hay.
+ */
+long logstore_find(LogStore *store, const char *needle, size_t from, bool forward);
+
+#endif /* LOGSTORE_H */
@@ -5,5 +5,6 @@
 #include "installer.h"
 
 int main(int argc, char *argv[]) {
+    startup_timing_begin();
     return installer_run(argc, argv);
 }
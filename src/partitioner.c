@@ -0,0 +1,317 @@
+/*
+ * partitioner.c - Auto-layout partition table writer for LOC-OS 24 Installer
+ *
+ * Calcula el esquema automático (EFI, swap, raíz, home) a partir del tamaño
+ * exacto del disco y su geometría, y lo escribe con libfdisk en una sola
+ * transacción: una escritura de la tabla y una relectura del kernel.
+ *
+ * Uso:
+ *   loc-partitioner --disk=/dev/sdX --label=gpt|dos [--efi-size=MiB]
+ *                   [--swap-size=MiB] [--sep-home=true|false] [--root-percent=N]
+ *                   [--raid=true|false] [--grain=BYTES] [--discard=true|false]
+ *
+ * Con --raid, swap, raíz y home se crean como miembros de RAID (Linux RAID)
+ * para que core-installer.sh monte con ellos los arrays md; la EFI no cambia.
+ *
+ * --grain fija la alineación de las particiones (core-installer.sh la deduce de
+ * optimal_io_size, discard_granularity y physical_block_size); sin ella, libfdisk
+ * usa 1 MiB o el tamaño óptimo de E/S si es mayor. --discard descarta el
+ * dispositivo entero (BLKDISCARD) antes de escribir la tabla.
+ *
+ * Salida (stdout), una variable por línea para core-installer.sh:
+ *   EFI_PART=/dev/sdX1  SWAP_PART=...  ROOT_PART=...  HOME_PART=...
+ *   DISCARD=ok|failed|skipped  REREAD=ok|failed
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#include <libfdisk/libfdisk.h>
+
+#define MIB (1024ULL * 1024ULL)
+
+/* Tipos de partición por etiqueta */
+#define GPT_TYPE_ESP    "C12A7328-F81F-11D2-BA4B-00A0C93EC93B"
+#define GPT_TYPE_SWAP   "0657FD6D-A4AB-43C4-84E5-0933C84B4F4F"
+#define GPT_TYPE_LINUX  "0FC63DAF-8483-4772-8E79-3D69D8477DE4"
+#define GPT_TYPE_RAID   "A19D880F-05FC-4D3B-A006-743F0F84911E"
+#define DOS_TYPE_ESP    0xef
+#define DOS_TYPE_SWAP   0x82
+#define DOS_TYPE_LINUX  0x83
+#define DOS_TYPE_RAID   0xfd
+
+typedef enum {
+    PART_ESP,
+    PART_SWAP,
+    PART_LINUX,
+    PART_RAID
+} PartKind;
+
+typedef struct {
+    const char *disk;
+    const char *label;
+    unsigned long efi_mib;
+    unsigned long swap_mib;
+    bool sep_home;
+    unsigned int root_percent;
+    bool raid;
+    unsigned long grain;        /* bytes; 0 = la de libfdisk */
+    bool discard;
+} LayoutOptions;
+
+/* ==================== HELPERS ==================== */
+
+static void fail(const char *what, int rc) {
+    fprintf(stderr, "loc-partitioner: %s: %s\n", what, strerror(rc < 0 ? -rc : rc));
+    exit(EXIT_FAILURE);
+}
+
+static bool parse_bool(const char *value) {
+    return strcmp(value, "true") == 0 || strcmp(value, "1") == 0 || strcmp(value, "yes") == 0;
+}
+
+static unsigned long parse_ulong(const char *opt, const char *value) {
+    char *end = NULL;
+    errno = 0;
+    unsigned long v = strtoul(value, &end, 10);
+    if (errno != 0 || !end || *end != '\0') {
+        fprintf(stderr, "loc-partitioner: invalid value for %s: %s\n", opt, value);
+        exit(EXIT_FAILURE);
+    }
+    return v;
+}
+
+static struct fdisk_parttype* get_parttype(struct fdisk_label *lb, bool gpt, PartKind kind) {
+    if (gpt) {
+        const char *guid = kind == PART_ESP  ? GPT_TYPE_ESP :
+                           kind == PART_SWAP ? GPT_TYPE_SWAP :
+                           kind == PART_RAID ? GPT_TYPE_RAID : GPT_TYPE_LINUX;
+        return fdisk_label_get_parttype_from_string(lb, guid);
+    }
+
+    unsigned int code = kind == PART_ESP  ? DOS_TYPE_ESP :
+                        kind == PART_SWAP ? DOS_TYPE_SWAP :
+                        kind == PART_RAID ? DOS_TYPE_RAID : DOS_TYPE_LINUX;
+    return fdisk_label_get_parttype_from_code(lb, code);
+}
+
+/*
+ * Añade una partición en memoria. size == 0 significa "hasta el final del disco".
+ * Devuelve el primer sector libre tras la partición, alineado al grano.
+ */
+static fdisk_sector_t add_partition(struct fdisk_context *cxt, bool gpt, PartKind kind,
+                                    fdisk_sector_t start, fdisk_sector_t size,
+                                    size_t *partno) {
+    struct fdisk_label *lb = fdisk_get_label(cxt, NULL);
+    struct fdisk_partition *pa = fdisk_new_partition();
+    if (!pa) fail("cannot allocate partition", -ENOMEM);
+
+    struct fdisk_parttype *type = get_parttype(lb, gpt, kind);
+    if (!type) fail("unknown partition type", -EINVAL);
+
+    fdisk_partition_set_start(pa, start);
+    if (size > 0) {
+        fdisk_partition_set_size(pa, size);
+    } else {
+        fdisk_partition_end_follow_default(pa, 1);
+    }
+    fdisk_partition_partno_follow_default(pa, 1);
+    fdisk_partition_set_type(pa, type);
+
+    int rc = fdisk_add_partition(cxt, pa, partno);
+    fdisk_unref_parttype(type);
+    fdisk_unref_partition(pa);
+    if (rc < 0) fail("cannot add partition", rc);
+
+    return fdisk_align_lba(cxt, start + size, FDISK_ALIGN_UP);
+}
+
+/* Tamaño en sectores redondeado hacia abajo al grano de alineación */
+static fdisk_sector_t mib_to_sectors(struct fdisk_context *cxt, unsigned long long mib) {
+    unsigned long long ssz = fdisk_get_sector_size(cxt);
+    unsigned long long grain = fdisk_get_grain_size(cxt) / ssz;
+    fdisk_sector_t sectors = mib * MIB / ssz;
+
+    if (grain > 1) sectors -= sectors % grain;
+    return sectors;
+}
+
+/* Descarta el dispositivo entero; el kernel lo trocea según discard_max_bytes */
+static bool discard_device(struct fdisk_context *cxt, const char *disk) {
+    uint64_t range[2] = { 0, (uint64_t) fdisk_get_nsectors(cxt) * fdisk_get_sector_size(cxt) };
+    struct timespec t0, t1;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    if (ioctl(fdisk_get_devfd(cxt), BLKDISCARD, range) != 0) {
+        fprintf(stderr, "loc-partitioner: %s: BLKDISCARD failed: %s\n", disk, strerror(errno));
+        return false;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    fprintf(stderr, "loc-partitioner: %s: discarded %ju bytes in %.1f s\n", disk, (uintmax_t) range[1],
+            (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9);
+    return true;
+}
+
+static void print_partname(const char *key, const char *disk, size_t partno) {
+    char *name = fdisk_partname(disk, partno + 1);
+    if (!name) fail("cannot build partition name", -ENOMEM);
+    printf("%s=%s\n", key, name);
+    free(name);
+}
+
+/* ==================== MAIN ==================== */
+
+int main(int argc, char *argv[]) {
+    LayoutOptions opt = {
+        .disk = NULL,
+        .label = "gpt",
+        .efi_mib = 512,
+        .swap_mib = 0,
+        .sep_home = false,
+        .root_percent = 60,
+        .raid = false,
+        .grain = 0,
+        .discard = false,
+    };
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *eq = strchr(arg, '=');
+        const char *value = eq ? eq + 1 : "";
+
+        if (strncmp(arg, "--disk=", 7) == 0) {
+            opt.disk = value;
+        } else if (strncmp(arg, "--label=", 8) == 0) {
+            opt.label = value;
+        } else if (strncmp(arg, "--efi-size=", 11) == 0) {
+            opt.efi_mib = parse_ulong("--efi-size", value);
+        } else if (strncmp(arg, "--swap-size=", 12) == 0) {
+            opt.swap_mib = parse_ulong("--swap-size", value);
+        } else if (strncmp(arg, "--sep-home=", 11) == 0) {
+            opt.sep_home = parse_bool(value);
+        } else if (strncmp(arg, "--root-percent=", 15) == 0) {
+            opt.root_percent = parse_ulong("--root-percent", value);
+        } else if (strncmp(arg, "--raid=", 7) == 0) {
+            opt.raid = parse_bool(value);
+        } else if (strncmp(arg, "--grain=", 8) == 0) {
+            opt.grain = parse_ulong("--grain", value);
+        } else if (strncmp(arg, "--discard=", 10) == 0) {
+            opt.discard = parse_bool(value);
+        } else {
+            fprintf(stderr, "loc-partitioner: unknown option: %s\n", arg);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!opt.disk) {
+        fprintf(stderr, "loc-partitioner: --disk is required\n");
+        return EXIT_FAILURE;
+    }
+    if (strcmp(opt.label, "gpt") != 0 && strcmp(opt.label, "dos") != 0) {
+        fprintf(stderr, "loc-partitioner: --label must be gpt or dos\n");
+        return EXIT_FAILURE;
+    }
+    if (opt.root_percent == 0 || opt.root_percent > 100) {
+        fprintf(stderr, "loc-partitioner: --root-percent must be 1-100\n");
+        return EXIT_FAILURE;
+    }
+
+    if (opt.grain % 512 != 0) {
+        fprintf(stderr, "loc-partitioner: --grain must be a multiple of 512\n");
+        return EXIT_FAILURE;
+    }
+
+    bool gpt = strcmp(opt.label, "gpt") == 0;
+
+    struct fdisk_context *cxt = fdisk_new_context();
+    if (!cxt) fail("cannot create context", -ENOMEM);
+
+    // La granularidad del usuario solo cuenta si se fija antes de abrir el disco
+    int rc;
+    if (opt.grain > 0) {
+        rc = fdisk_save_user_grain(cxt, opt.grain);
+        if (rc < 0) fail("cannot set alignment grain", rc);
+    }
+
+    rc = fdisk_assign_device(cxt, opt.disk, 0);
+    if (rc < 0) fail(opt.disk, rc);
+
+    // Antes de la tabla: lo que se escriba después no se descarta
+    const char *discarded = "skipped";
+    if (opt.discard) {
+        discarded = discard_device(cxt, opt.disk) ? "ok" : "failed";
+    }
+
+    // Borrar firmas antiguas (sistemas de ficheros, RAID, tablas) al escribir
+    fdisk_enable_wipe(cxt, 1);
+
+    rc = fdisk_create_disklabel(cxt, opt.label);
+    if (rc < 0) fail("cannot create disklabel", rc);
+
+    // Geometría real tras crear la etiqueta (first/last LBA dependen de ella)
+    fdisk_sector_t first = fdisk_get_first_lba(cxt);
+    fdisk_sector_t last = fdisk_get_last_lba(cxt);
+    fdisk_sector_t start = fdisk_align_lba(cxt, first, FDISK_ALIGN_UP);
+
+    fprintf(stderr, "loc-partitioner: %s: %ju sectors of %lu bytes, grain %lu bytes, usable %ju-%ju\n",
+            opt.disk, (uintmax_t) fdisk_get_nsectors(cxt), fdisk_get_sector_size(cxt),
+            fdisk_get_grain_size(cxt), (uintmax_t) first, (uintmax_t) last);
+
+    fdisk_sector_t efi_size = gpt ? mib_to_sectors(cxt, opt.efi_mib) : 0;
+    fdisk_sector_t swap_size = mib_to_sectors(cxt, opt.swap_mib);
+
+    if (start + efi_size + swap_size >= last) {
+        fprintf(stderr, "loc-partitioner: disk %s is too small for the requested layout\n", opt.disk);
+        return EXIT_FAILURE;
+    }
+
+    size_t efi_no = 0, swap_no = 0, root_no = 0, home_no = 0;
+    PartKind swap_kind = opt.raid ? PART_RAID : PART_SWAP;
+    PartKind data_kind = opt.raid ? PART_RAID : PART_LINUX;
+
+    if (efi_size > 0) {
+        start = add_partition(cxt, gpt, PART_ESP, start, efi_size, &efi_no);
+    }
+    if (swap_size > 0) {
+        start = add_partition(cxt, gpt, swap_kind, start, swap_size, &swap_no);
+    }
+
+    if (opt.sep_home) {
+        // Raíz: root_percent del espacio restante; home: el resto
+        fdisk_sector_t remaining = last + 1 - start;
+        unsigned long long remaining_mib = (unsigned long long) remaining * fdisk_get_sector_size(cxt) / MIB;
+        fdisk_sector_t root_size = mib_to_sectors(cxt, remaining_mib * opt.root_percent / 100);
+
+        start = add_partition(cxt, gpt, data_kind, start, root_size, &root_no);
+        add_partition(cxt, gpt, data_kind, start, 0, &home_no);
+    } else {
+        add_partition(cxt, gpt, data_kind, start, 0, &root_no);
+    }
+
+    // Única escritura de la tabla
+    rc = fdisk_write_disklabel(cxt);
+    if (rc < 0) fail("cannot write partition table", rc);
+
+    // Única relectura (BLKRRPART); si falla, el script recurre a partprobe
+    fsync(fdisk_get_devfd(cxt));
+    bool reread = fdisk_reread_partition_table(cxt) == 0;
+
+    if (efi_size > 0) print_partname("EFI_PART", opt.disk, efi_no);
+    if (swap_size > 0) print_partname("SWAP_PART", opt.disk, swap_no);
+    print_partname("ROOT_PART", opt.disk, root_no);
+    if (opt.sep_home) print_partname("HOME_PART", opt.disk, home_no);
+    printf("DISCARD=%s\n", discarded);
+    printf("REREAD=%s\n", reread ? "ok" : "failed");
+
+    fdisk_deassign_device(cxt, 1);
+    fdisk_unref_context(cxt);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,277 @@
+/*
+ * progress.c - Progress/ETA model for LOC-OS 24 Installer (sin dependencias de GTK)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "progress.h"
+
+#define DEFAULT_STAGE_MS        5000.0
+#define DEFAULT_COPY_MS         300000.0
+#define DEFAULT_COPY_RATE_SSD   (150.0 * 1024 * 1024)
+#define DEFAULT_COPY_RATE_HDD   (60.0 * 1024 * 1024)
+#define LIVE_RATE_RAMP_MS       10000.0     /* tiempo hasta fiarse solo del throughput real */
+#define FACTOR_RAMP_MS          30000.0     /* esperado acumulado hasta fiarse del factor real */
+#define PROFILE_WEIGHT          0.5         /* peso de la medida nueva al actualizar el perfil */
+
+/* Coste esperado por defecto de cada etapa, en ms */
+static const struct {
+    const char *stage;
+    double ms;
+} default_costs[] = {
+    { "check",      500 },
+    { "bootmode",   200 },
+    { "partition",  4000 },
+    { "mount",      1500 },
+    { "swapfile",   8000 },
+    { "locales",    12000 },
+    { "fstab",      500 },
+    { "user",       2000 },
+    { "bootloader", 15000 },
+    { "cleanup",    40000 },
+    { "unmount",    2000 },
+};
+
+/* ==================== PROFILE ==================== */
+
+static ProfileEntry* profile_find(ProgressModel *m, const char *cls, const char *stage) {
+    for (int i = 0; i < m->profile_count; i++) {
+        if (strcmp(m->profile[i].disk_class, cls) == 0 && strcmp(m->profile[i].stage, stage) == 0) {
+            return &m->profile[i];
+        }
+    }
+    return NULL;
+}
+
+static void profile_set(ProgressModel *m, const char *cls, const char *stage, double value) {
+    ProfileEntry *e = profile_find(m, cls, stage);
+    if (!e) {
+        if (m->profile_count >= PROGRESS_MAX_PROFILE) return;
+        e = &m->profile[m->profile_count++];
+        snprintf(e->disk_class, sizeof(e->disk_class), "%s", cls);
+        snprintf(e->stage, sizeof(e->stage), "%s", stage);
+    }
+    e->value = value;
+}
+
+/* Media exponencial con lo que ya hubiera */
+static void profile_blend(ProgressModel *m, const char *cls, const char *stage, double value) {
+    ProfileEntry *e = profile_find(m, cls, stage);
+    profile_set(m, cls, stage, e ? e->value + PROFILE_WEIGHT * (value - e->value) : value);
+}
+
+void progress_model_load(ProgressModel *m, const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return;
+
+    char cls[8], stage[PROGRESS_STAGE_ID];
+    double value;
+    while (fscanf(f, "%7s %15s %lf", cls, stage, &value) == 3) {
+        if (value > 0) profile_set(m, cls, stage, value);
+    }
+    fclose(f);
+}
+
+static void profile_save(ProgressModel *m, const char *path) {
+    char tmp[4096];
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int) sizeof(tmp)) return;
+
+    FILE *f = fopen(tmp, "w");
+    if (!f) return;
+    for (int i = 0; i < m->profile_count; i++) {
+        fprintf(f, "%s %s %.0f\n", m->profile[i].disk_class, m->profile[i].stage, m->profile[i].value);
+    }
+    if (fclose(f) == 0) {
+        rename(tmp, path);
+    } else {
+        remove(tmp);
+    }
+}
+
+/* ==================== MODEL ==================== */
+
+static double default_cost(const char *stage) {
+    for (size_t i = 0; i < sizeof(default_costs) / sizeof(default_costs[0]); i++) {
+        if (strcmp(default_costs[i].stage, stage) == 0) return default_costs[i].ms;
+    }
+    return DEFAULT_STAGE_MS;
+}
+
+static double expected_cost(ProgressModel *m, const char *stage) {
+    ProfileEntry *e = profile_find(m, m->disk_class, stage);
+    if (e) return e->value;
+    return strcmp(stage, "copy") == 0 ? DEFAULT_COPY_MS : default_cost(stage);
+}
+
+static bool is_copy(const ProgressStage *s) {
+    return strcmp(s->id, "copy") == 0;
+}
+
+static int add_stage(ProgressModel *m, const char *id) {
+    if (m->count >= PROGRESS_MAX_STAGES) return -1;
+
+    ProgressStage *s = &m->stages[m->count];
+    snprintf(s->id, sizeof(s->id), "%s", id);
+    s->expected_ms = expected_cost(m, id);
+    s->actual_ms = 0;
+    s->done = false;
+    return m->count++;
+}
+
+void progress_model_init(ProgressModel *m) {
+    memset(m, 0, sizeof(*m));
+    m->planned = false;
+    m->current = -1;
+    snprintf(m->disk_class, sizeof(m->disk_class), "ssd");
+}
+
+void progress_model_plan(ProgressModel *m, const char *stages, double copy_bytes,
+                         const char *disk_class) {
+    m->count = 0;
+    m->current = -1;
+    m->planned = true;
+    m->last_pct = 0;
+    m->copy_bytes_done = 0;
+    m->copy_rate_live = 0;
+    m->copy_pct = 0;
+    if (disk_class && *disk_class) {
+        snprintf(m->disk_class, sizeof(m->disk_class), "%s", disk_class);
+    }
+
+    ProfileEntry *rate = profile_find(m, m->disk_class, "copy_rate");
+    m->copy_rate_profile = rate ? rate->value :
+                           strcmp(m->disk_class, "hdd") == 0 ? DEFAULT_COPY_RATE_HDD : DEFAULT_COPY_RATE_SSD;
+    m->copy_bytes_expected = copy_bytes;
+
+    char list[512];
+    snprintf(list, sizeof(list), "%s", stages ? stages : "");
+    char *save = NULL;
+    for (char *id = strtok_r(list, ",", &save); id; id = strtok_r(NULL, ",", &save)) {
+        add_stage(m, id);
+    }
+}
+
+void progress_model_stage(ProgressModel *m, const char *id, double now_ms) {
+    if (m->current >= 0) {
+        m->stages[m->current].actual_ms = now_ms - m->stage_start_ms;
+        m->stages[m->current].done = true;
+    }
+
+    // Buscar la etapa en el plan; las que se salten no cuentan
+    int found = -1;
+    for (int i = m->current + 1; i < m->count; i++) {
+        if (strcmp(m->stages[i].id, id) == 0) {
+            found = i;
+            break;
+        }
+    }
+    if (found < 0) {
+        found = add_stage(m, id);
+        if (found < 0) return;
+    }
+    for (int i = m->current + 1; i < found; i++) {
+        m->stages[i].done = true;
+        m->stages[i].expected_ms = 0;
+    }
+
+    m->current = found;
+    m->stage_start_ms = now_ms;
+}
+
+void progress_model_copy(ProgressModel *m, double bytes, double rate, int pct) {
+    if (bytes > 0) m->copy_bytes_done = bytes;
+    if (rate > 0) m->copy_rate_live = rate;
+    if (pct > 0 && pct <= 100) {
+        m->copy_pct = pct;
+        // rsync conoce el total mejor que la estimación inicial
+        if (bytes > 0) m->copy_bytes_expected = bytes * 100.0 / pct;
+    }
+}
+
+/* Relación real/esperado de las etapas terminadas, con más peso cuanto más se ha medido */
+static double speed_factor(const ProgressModel *m) {
+    double expected = 0, actual = 0;
+    for (int i = 0; i < m->count; i++) {
+        const ProgressStage *s = &m->stages[i];
+        if (!s->done || is_copy(s) || s->expected_ms <= 0) continue;
+        expected += s->expected_ms;
+        actual += s->actual_ms;
+    }
+    if (expected <= 0) return 1.0;
+
+    double weight = expected < FACTOR_RAMP_MS ? expected / FACTOR_RAMP_MS : 1.0;
+    double factor = 1.0 + weight * (actual / expected - 1.0);
+    return factor < 0.3 ? 0.3 : factor > 3.0 ? 3.0 : factor;
+}
+
+static double future_cost(const ProgressModel *m, const ProgressStage *s, double factor) {
+    if (is_copy(s) && m->copy_bytes_expected > 0) {
+        return m->copy_bytes_expected / m->copy_rate_profile * 1000.0;
+    }
+    return s->expected_ms * factor;
+}
+
+int progress_model_estimate(ProgressModel *m, double now_ms, long *eta_s) {
+    if (eta_s) *eta_s = -1;
+    if (m->last_pct >= 100) return 100;
+    if (m->count == 0 || m->current < 0) return m->last_pct;
+
+    double factor = speed_factor(m);
+    double done = 0, future = 0;
+    for (int i = 0; i < m->count; i++) {
+        if (i == m->current) continue;
+        if (m->stages[i].done) done += m->stages[i].actual_ms;
+        else future += future_cost(m, &m->stages[i], factor);
+    }
+
+    const ProgressStage *cur = &m->stages[m->current];
+    double elapsed = now_ms - m->stage_start_ms;
+    double remaining;
+
+    if (is_copy(cur) && m->copy_bytes_done > 0) {
+        // Throughput: del perfil al principio, del rsync real a medida que avanza
+        double w = elapsed < LIVE_RATE_RAMP_MS ? elapsed / LIVE_RATE_RAMP_MS : 1.0;
+        double rate = m->copy_rate_live > 0
+            ? w * m->copy_rate_live + (1.0 - w) * m->copy_rate_profile
+            : m->copy_rate_profile;
+        double left = m->copy_bytes_expected - m->copy_bytes_done;
+        remaining = left > 0 ? left / rate * 1000.0 : 0;
+    } else {
+        remaining = future_cost(m, cur, factor) - elapsed;
+    }
+
+    // Etapa más larga de lo esperado: seguir avanzando, cada vez más despacio
+    double floor = elapsed * 0.1 + 250.0;
+    if (remaining < floor) remaining = floor;
+
+    double total = done + elapsed + remaining + future;
+    int pct = total > 0 ? (int) ((done + elapsed) * 100.0 / total) : 0;
+    if (pct > 99) pct = 99;
+    if (pct < m->last_pct) pct = m->last_pct;
+    m->last_pct = pct;
+
+    if (eta_s) *eta_s = (long) ((remaining + future) / 1000.0);
+    return pct;
+}
+
+void progress_model_finish(ProgressModel *m, double now_ms, const char *path) {
+    if (m->current >= 0 && !m->stages[m->current].done) {
+        m->stages[m->current].actual_ms = now_ms - m->stage_start_ms;
+        m->stages[m->current].done = true;
+    }
+    m->last_pct = 100;
+
+    for (int i = 0; i < m->count; i++) {
+        const ProgressStage *s = &m->stages[i];
+        if (!s->done || s->actual_ms <= 0) continue;
+
+        if (is_copy(s) && m->copy_bytes_done > 0) {
+            profile_blend(m, m->disk_class, "copy_rate", m->copy_bytes_done / (s->actual_ms / 1000.0));
+        } else {
+            profile_blend(m, m->disk_class, s->id, s->actual_ms);
+        }
+    }
+
+    if (path) profile_save(m, path);
+}
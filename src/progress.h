@@ -0,0 +1,76 @@
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+/*
+ * progress.h - Cost-weighted progress and ETA model (sin dependencias de GTK)
+ *
+ * Cada etapa pesa su duración esperada. Las expectativas salen de una tabla
+ * por defecto, corregida con los tiempos guardados de instalaciones
+ * anteriores en hardware de la misma clase (hdd/ssd); la copia se estima
+ * por bytes y throughput. Durante la instalación se mezclan con lo medido:
+ * el throughput real de rsync y la relación real/esperado de las etapas ya
+ * terminadas. El porcentaje nunca retrocede.
+ *
+ * Perfil (texto, una entrada por línea):
+ *   <clase> <etapa> <ms>
+ *   <clase> copy_rate <bytes/s>
+ */
+
+#include <stdbool.h>
+
+#define PROGRESS_MAX_STAGES     24
+#define PROGRESS_MAX_PROFILE    64
+#define PROGRESS_STAGE_ID       16
+
+typedef struct {
+    char disk_class[8];
+    char stage[PROGRESS_STAGE_ID];
+    double value;               /* ms, o bytes/s para copy_rate */
+} ProfileEntry;
+
+typedef struct {
+    char id[PROGRESS_STAGE_ID];
+    double expected_ms;
+    double actual_ms;
+    bool done;
+} ProgressStage;
+
+typedef struct {
+    ProfileEntry profile[PROGRESS_MAX_PROFILE];
+    int profile_count;
+
+    ProgressStage stages[PROGRESS_MAX_STAGES];
+    int count;
+    int current;                /* -1 antes de la primera etapa */
+    bool planned;               /* el script anunció sus etapas */
+    double stage_start_ms;
+    char disk_class[8];
+
+    double copy_bytes_expected;
+    double copy_bytes_done;
+    double copy_rate_profile;   /* bytes/s */
+    double copy_rate_live;      /* bytes/s, 0 si aún no hay */
+    int copy_pct;
+
+    int last_pct;
+} ProgressModel;
+
+void progress_model_init(ProgressModel *m);
+
+/* Carga un perfil; las entradas de ficheros posteriores sustituyen a las anteriores */
+void progress_model_load(ProgressModel *m, const char *path);
+
+/* Plan anunciado por el script: etapas separadas por comas, bytes a copiar y clase de disco */
+void progress_model_plan(ProgressModel *m, const char *stages, double copy_bytes,
+                         const char *disk_class);
+
+void progress_model_stage(ProgressModel *m, const char *id, double now_ms);
+void progress_model_copy(ProgressModel *m, double bytes, double rate, int pct);
+
+/* Porcentaje estimado (0-99 hasta finish) y segundos restantes */
+int progress_model_estimate(ProgressModel *m, double now_ms, long *eta_s);
+
+/* Cierra la última etapa y mezcla lo medido en el perfil. Guarda si path no es NULL. */
+void progress_model_finish(ProgressModel *m, double now_ms, const char *path);
+
+#endif /* PROGRESS_H */
@@ -0,0 +1,177 @@
+/*
+ * runner.c - Child process runner for LOC-OS 24 Installer (sin dependencias de GTK)
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "runner.h"
+
+extern char **environ;
+
+/* ==================== CHILD PROCESS ==================== */
+
+int child_spawn(ChildProcess *child, char *const argv[]) {
+    int out_pipe[2] = { -1, -1 };
+    int err_pipe[2] = { -1, -1 };
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    sigset_t mask, defaults;
+    int rc;
+
+    child->pid = -1;
+    child->out_fd = -1;
+    child->err_fd = -1;
+
+    if (pipe2(out_pipe, O_CLOEXEC) != 0) return errno;
+    if (pipe2(err_pipe, O_CLOEXEC) != 0) {
+        rc = errno;
+        close(out_pipe[0]);
+        close(out_pipe[1]);
+        return rc;
+    }
+
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, out_pipe[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, err_pipe[1], STDERR_FILENO);
+
+    // Grupo propio (para poder matarlo entero), señales por defecto y sin máscara
+    sigemptyset(&mask);
+    sigemptyset(&defaults);
+    sigaddset(&defaults, SIGPIPE);
+    sigaddset(&defaults, SIGINT);
+    sigaddset(&defaults, SIGTERM);
+
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGMASK |
+                                    POSIX_SPAWN_SETSIGDEF);
+    posix_spawnattr_setpgroup(&attr, 0);
+    posix_spawnattr_setsigmask(&attr, &mask);
+    posix_spawnattr_setsigdefault(&attr, &defaults);
+
+    rc = posix_spawnp(&child->pid, argv[0], &actions, &attr, argv, environ);
+
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    close(out_pipe[1]);
+    close(err_pipe[1]);
+
+    if (rc != 0) {
+        close(out_pipe[0]);
+        close(err_pipe[0]);
+        child->pid = -1;
+        return rc;
+    }
+
+    fcntl(out_pipe[0], F_SETFL, fcntl(out_pipe[0], F_GETFL) | O_NONBLOCK);
+    fcntl(err_pipe[0], F_SETFL, fcntl(err_pipe[0], F_GETFL) | O_NONBLOCK);
+    child->out_fd = out_pipe[0];
+    child->err_fd = err_pipe[0];
+    return 0;
+}
+
+void child_signal(const ChildProcess *child, int sig) {
+    if (child->pid > 0) kill(-child->pid, sig);
+}
+
+int child_wait(ChildProcess *child) {
+    int status;
+    pid_t r;
+
+    if (child->pid <= 0) return -1;
+    do {
+        r = waitpid(child->pid, &status, 0);
+    } while (r < 0 && errno == EINTR);
+    child->pid = -1;
+
+    if (r < 0) return -1;
+    if (WIFEXITED(status)) return WEXITSTATUS(status);
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    return -1;
+}
+
+void child_close(ChildProcess *child) {
+    if (child->out_fd >= 0) close(child->out_fd);
+    if (child->err_fd >= 0) close(child->err_fd);
+    child->out_fd = -1;
+    child->err_fd = -1;
+}
+
+/* ==================== LINE READER ==================== */
+
+static bool line_reader_append(LineReader *lr, const char *text, size_t len) {
+    if (lr->len + len + 1 > lr->cap) {
+        size_t cap = lr->cap ? lr->cap : 4096;
+        while (cap < lr->len + len + 1) cap *= 2;
+        char *data = realloc(lr->data, cap);
+        if (!data) return false;
+        lr->data = data;
+        lr->cap = cap;
+    }
+    memcpy(lr->data + lr->len, text, len);
+    lr->len += len;
+    return true;
+}
+
+bool line_reader_fill(LineReader *lr, int fd, LineCallback cb, void *data) {
+    char chunk[8192];
+    ssize_t n = read(fd, chunk, sizeof(chunk));
+    if (n == 0) return false;
+    if (n < 0) return errno == EAGAIN || errno == EINTR;
+
+    char *p = chunk;
+    char *end = chunk + n;
+    while (p < end) {
+        char *nl = memchr(p, '\n', (size_t) (end - p));
+
+        // Línea completa dentro del bloque: se entrega sin copiarla
+        if (nl && lr->len == 0 && (size_t) (nl - p) <= LINE_READER_MAX) {
+            *nl = '\0';
+            if (nl > p) cb(p, data);
+            p = nl + 1;
+            continue;
+        }
+
+        // Resto de una línea a medias o línea demasiado larga: al buffer
+        size_t len = (size_t) ((nl ? nl : end) - p);
+        size_t room = LINE_READER_MAX - lr->len;
+        if (len > room) {
+            len = room;
+            nl = NULL;
+        }
+        if (!line_reader_append(lr, p, len)) {
+            // Sin memoria: entregar lo que hay y seguir
+            line_reader_flush(lr, cb, data);
+        }
+        p += len;
+
+        if (nl) {
+            line_reader_flush(lr, cb, data);
+            p++;
+        } else if (lr->len >= LINE_READER_MAX) {
+            line_reader_flush(lr, cb, data);
+        }
+    }
+    return true;
+}
+
+void line_reader_flush(LineReader *lr, LineCallback cb, void *data) {
+    if (lr->len == 0) return;
+    lr->data[lr->len] = '\0';
+    cb(lr->data, data);
+    lr->len = 0;
+}
+
+void line_reader_free(LineReader *lr) {
+    free(lr->data);
+    lr->data = NULL;
+    lr->len = 0;
+    lr->cap = 0;
+}
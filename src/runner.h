@@ -0,0 +1,53 @@
+#ifndef RUNNER_H
+#define RUNNER_H
+
+/*
+ * runner.h - Child process runner for LOC-OS 24 Installer (sin dependencias de GTK)
+ *
+ * El hijo se lanza con posix_spawn desde un argv (sin shell), en su propio
+ * grupo de procesos, con stdin en /dev/null y stdout/stderr en tuberías
+ * separadas no bloqueantes. Cancelar es señalar al grupo entero.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#define LINE_READER_MAX     (1024 * 1024)   /* líneas más largas se parten */
+
+typedef struct {
+    pid_t pid;                  /* también es el id del grupo de procesos */
+    int out_fd;
+    int err_fd;
+} ChildProcess;
+
+/* Lanza argv[0] (buscado en PATH). 0 o un código errno. */
+int child_spawn(ChildProcess *child, char *const argv[]);
+
+/* Señal a todo el grupo del hijo */
+void child_signal(const ChildProcess *child, int sig);
+
+/* Espera al hijo: código de salida, 128 + señal si murió por una, -1 si falla */
+int child_wait(ChildProcess *child);
+
+void child_close(ChildProcess *child);
+
+/* ==================== LINE READER ==================== */
+
+typedef void (*LineCallback)(char *line, void *data);
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} LineReader;
+
+/* Lee lo disponible en fd y entrega las líneas completas. false en EOF o error. */
+bool line_reader_fill(LineReader *lr, int fd, LineCallback cb, void *data);
+
+/* Entrega lo que quede sin '\n' final */
+void line_reader_flush(LineReader *lr, LineCallback cb, void *data);
+
+void line_reader_free(LineReader *lr);
+
+#endif /* RUNNER_H */
@@ -10,8 +10,56 @@ LOG_FILE="/tmp/loc-installer.log"
 ERROR_LOG="/tmp/loc-installer-error.log"
 RSYNC_EXCLUDES="/tmp/installer-exclude.list"
 CUSTOM_EXCLUDES="/etc/loc-installer/custom-excludes.list"
-INSTALLER_CONFIG="/etc/loc-installer/loc-installer.conf"
+INSTALLER_CONFIG="${LOC_INSTALLER_CONFIG:-/etc/loc-installer/loc-installer.conf}"
 DESKTOP_ENTRY_NAME="loc-installer.desktop"
+SCRIPT_DIR="$(dirname "$(readlink -f "$0")")"
+PARTITIONER="$SCRIPT_DIR/loc-partitioner"
+USERDB="$SCRIPT_DIR/loc-userdb"
+
+# Initramfs: compresión y caché de imágenes ya generadas (clave: kernel + hooks/config).
+# Apuntar INITRAMFS_CACHE_DIR a almacenamiento persistente permite reusarla entre sesiones.
+INITRAMFS_COMPRESS="zstd"
+INITRAMFS_COMPRESSLEVEL="3"
+INITRAMFS_CACHE_DIR="/var/cache/loc-installer/initramfs"
+
+# Propietario de /home/live en el sistema en vivo y UID/GID que tendrá el usuario instalado.
+# La copia de ese directorio reasigna la propiedad al escribir cada fichero
+# (rsync --usermap/--groupmap); el resto del sistema conserva sus UID/GID.
+LIVE_HOME="/home/live"
+USER_UID="1000"
+USER_GID="1000"
+
+# Raíz del sistema que se copia (el propio sistema en vivo)
+SOURCE_ROOT="/"
+
+# Formateo: imagen del sistema en vivo (para estimar inodos) y margen sobre su número de ficheros.
+# Inodos de una raíz ext4: ficheros de la imagen × ROOT_INODE_FACTOR, y nunca menos de
+# ROOT_INODE_MIN ni de uno cada ROOT_BYTES_PER_INODE bytes de la partición. Menos inodos
+# que el valor por defecto (uno cada 16 KiB) acelera mkfs y fsck y deja más espacio, pero
+# ext4 no puede añadirlos después: con muchos ficheros pequeños (contenedores, cachés de
+# compilación) el disco se llenaría con espacio libre. El mínimo por tamaño guarda margen.
+LIVE_SQUASHFS="/run/live/medium/live/filesystem.squashfs"
+ROOT_INODE_FACTOR="8"
+ROOT_INODE_MIN="1048576"
+ROOT_BYTES_PER_INODE="65536"
+
+# Tiempo máximo (s) para que udev cree/retire nodos de dispositivo
+DEVICE_TIMEOUT="10"
+
+# Preparación del disco en automático: descartar el dispositivo entero antes de
+# particionar (SSD, eMMC, SD) y tope de la alineación deducida de sysfs (algunos
+# puentes USB anuncian un optimal_io_size absurdo)
+DISK_DISCARD="true"
+DISK_ALIGN_MAX_MIB="16"
+
+# Sistema de ficheros de raíz y /home en el particionado automático (--root-fs):
+# ext4, btrfs, xfs o f2fs. btrfs y f2fs comprimen con zstd ya durante la copia.
+ROOT_FS="ext4"
+
+# Informe de tiempos y recursos por etapa (ruta dentro del sistema instalado)
+# e intervalo (s) de muestreo de memoria
+STAGE_REPORT="/var/log/loc-installer-stages.json"
+STAGE_RSS_INTERVAL="1"
 
 # Cargar configuración personalizada si existe
 if [ -f "$INSTALLER_CONFIG" ]; then
@@ -25,17 +73,199 @@ fi
 exec 2>"$ERROR_LOG"
 echo "=== LOC-OS Installer Log - $(date) ===" > "$LOG_FILE"
 
+# ========== PROTOCOLO DE EVENTOS ==========
+# Una línea por evento (ver src/events.h):  LOC1 <ts_ms> <evento> clave=valor ... msg=texto
+# Van por un FIFO propio (--event-fifo) para no mezclarse con la salida de los comandos;
+# sin FIFO se escriben en stdout.
+EVENT_PROTO="LOC1"
+EVENT_FD=1
+CURRENT_STAGE=""
+
+emit() {
+    local event="$1"
+    shift
+    local now=${EPOCHREALTIME/[.,]/}
+    local fields="$*"
+    printf '%s %s %s %s\n' "$EVENT_PROTO" "${now:0:-3}" "$event" "${fields//$'\n'/ }" >&"$EVENT_FD" 2>/dev/null || true
+}
+
+open_event_channel() {
+    local fifo="$1"
+    [ -n "$fifo" ] || return 0
+
+    if [ ! -p "$fifo" ]; then
+        error "Event FIFO not found: $fifo"
+    fi
+    exec {EVENT_FD}>"$fifo"
+}
+
+# Comienzo de etapa: id estable, porcentaje global y mensaje para el usuario.
+# Cierra las métricas de la etapa anterior y abre las de esta.
+stage_begin() {
+    stage_end
+    CURRENT_STAGE="$1"
+    emit stage "stage=$1" "pct=$2" "msg=$3"
+    log "$3"
+    stage_metrics_start
+}
+
+# Etapas previstas, antes de la primera: la GUI reparte la barra según el
+# coste esperado de cada una (bytes a copiar y clase del disco de destino).
+emit_plan() {
+    local stages="check,bootmode,partition,mount,copy"
+    if [ "$CREATE_SWAPFILE" = "true" ] && [ "$SWAPFILE_SIZE" -gt 0 ]; then
+        stages+=",swapfile"
+    fi
+    stages+=",locales,fstab,user,bootloader,cleanup,unmount"
+
+    # Bytes a copiar: en el sistema en vivo df mide el overlay, no lo que se copia.
+    # live-build deja el tamaño descomprimido junto a la imagen; si no está, se
+    # suma el origen (unsquashfs -s solo da el tamaño comprimido)
+    local copy_bytes="" size_file="${LIVE_SQUASHFS%/*}/filesystem.size"
+    if [ -r "$size_file" ]; then
+        copy_bytes=$(tr -dc '0-9' < "$size_file")
+    fi
+    if [ -z "$copy_bytes" ]; then
+        copy_bytes=$(du -sbx "$SOURCE_ROOT" 2>/dev/null | cut -f1)
+    fi
+
+    local dev="${DISK:-$ROOT_PART}" disk_class="ssd"
+    if [ -n "$dev" ] && [ "$(lsblk -dno ROTA "$dev" 2>/dev/null | head -n 1 | tr -d ' ')" = "1" ]; then
+        disk_class="hdd"
+    fi
+
+    emit plan "stages=$stages" "copy_bytes=${copy_bytes:-0}" "disk_class=$disk_class"
+}
+
+# ========== MÉTRICAS POR ETAPA ==========
+# Por etapa: tiempo real, CPU (del script y de sus hijos ya recogidos, como
+# RUSAGE_CHILDREN), bytes leídos/escritos en disco (/proc/<pid>/io, que también
+# acumula los hijos recogidos) y pico de memoria del grupo de procesos del
+# script, muestreado cada STAGE_RSS_INTERVAL segundos.
+CLK_TCK=$(getconf CLK_TCK 2>/dev/null || echo 100)
+# Proceso que ejecuta la instalación (main_installation corre en segundo plano)
+INSTALLER_PID=$$
+STAGE_ROWS=()
+STAGE_T0_WALL=""
+STAGE_RSS_FILE=""
+STAGE_RSS_PID=""
+INSTALL_T0_WALL=""
+
+metrics_snapshot() {
+    local now=${EPOCHREALTIME/[.,]/}
+    SNAP_WALL_MS=$(( now / 1000 ))
+
+    local st
+    read -r -a st < "/proc/$INSTALLER_PID/stat"
+    SNAP_CPU_MS=$(( (st[13] + st[14] + st[15] + st[16]) * 1000 / CLK_TCK ))
+
+    SNAP_READ=0
+    SNAP_WRITE=0
+    local key value
+    while read -r key value; do
+        case "$key" in
+            read_bytes:) SNAP_READ=$value ;;
+            write_bytes:) SNAP_WRITE=$value ;;
+        esac
+    done < "/proc/$INSTALLER_PID/io"
+}
+
+start_rss_sampler() {
+    STAGE_RSS_FILE=$(mktemp /tmp/loc-installer-rss.XXXXXX)
+    echo 0 > "$STAGE_RSS_FILE"
+    local pgid
+    pgid=$(ps -o pgid= -p "$INSTALLER_PID" | tr -d ' ')
+
+    # Sin trazas ni stdout: el GUI espera al EOF de stdout para terminar
+    (
+        set +x +e
+        while kill -0 "$INSTALLER_PID" 2>/dev/null; do
+            rss=$(ps -e -o pgid=,rss= | awk -v g="$pgid" '$1 == g { s += $2 } END { print s + 0 }')
+            peak=$(cat "$STAGE_RSS_FILE" 2>/dev/null || echo 0)
+            [ "${rss:-0}" -gt "${peak:-0}" ] && echo "$rss" > "$STAGE_RSS_FILE"
+            sleep "$STAGE_RSS_INTERVAL"
+        done
+    ) >/dev/null 2>&1 &
+    STAGE_RSS_PID=$!
+}
+
+stop_rss_sampler() {
+    [ -n "$STAGE_RSS_PID" ] && kill "$STAGE_RSS_PID" 2>/dev/null || true
+    [ -n "$STAGE_RSS_FILE" ] && rm -f "$STAGE_RSS_FILE"
+    STAGE_RSS_PID=""
+    STAGE_RSS_FILE=""
+}
+
+stage_metrics_start() {
+    [ -n "$STAGE_RSS_PID" ] || start_rss_sampler
+    metrics_snapshot
+    STAGE_T0_WALL=$SNAP_WALL_MS
+    STAGE_T0_CPU=$SNAP_CPU_MS
+    STAGE_T0_READ=$SNAP_READ
+    STAGE_T0_WRITE=$SNAP_WRITE
+    [ -n "$INSTALL_T0_WALL" ] || INSTALL_T0_WALL=$SNAP_WALL_MS
+    echo 0 > "$STAGE_RSS_FILE"
+}
+
+stage_end() {
+    [ -n "$STAGE_T0_WALL" ] || return 0
+    metrics_snapshot
+
+    local wall=$(( SNAP_WALL_MS - STAGE_T0_WALL ))
+    local cpu=$(( SNAP_CPU_MS - STAGE_T0_CPU ))
+    local read=$(( SNAP_READ - STAGE_T0_READ ))
+    local write=$(( SNAP_WRITE - STAGE_T0_WRITE ))
+    local rss
+    rss=$(cat "$STAGE_RSS_FILE" 2>/dev/null || echo 0)
+    STAGE_T0_WALL=""
+
+    emit stage_end "stage=$CURRENT_STAGE" "wall_ms=$wall" "cpu_ms=$cpu" \
+        "read_bytes=$read" "write_bytes=$write" "rss_kb=${rss:-0}"
+    STAGE_ROWS+=("$(printf '{"stage": "%s", "wall_ms": %d, "cpu_ms": %d, "read_bytes": %d, "write_bytes": %d, "peak_rss_kb": %d}' \
+        "$CURRENT_STAGE" "$wall" "$cpu" "$read" "$write" "${rss:-0}")")
+}
+
+# Escribe el informe JSON con las etapas cerradas hasta ahora
+write_stage_report() {
+    local report="$1"
+    stage_end
+
+    mkdir -p "$(dirname "$report")"
+    {
+        printf '{\n  "version": 1,\n'
+        printf '  "date": "%s",\n' "$(date -Iseconds)"
+        printf '  "boot_mode": "%s",\n' "${UEFI_MODE:-unknown}"
+        printf '  "disk": "%s",\n' "${DISK:-}"
+        printf '  "total_wall_ms": %d,\n' $(( SNAP_WALL_MS - INSTALL_T0_WALL ))
+        printf '  "stages": [\n'
+        local i
+        for i in "${!STAGE_ROWS[@]}"; do
+            printf '    %s%s\n' "${STAGE_ROWS[$i]}" "$([ "$i" -lt $(( ${#STAGE_ROWS[@]} - 1 )) ] && echo ,)"
+        done
+        printf '  ]\n}\n'
+    } > "$report" || warn "Could not write stage report to $report"
+
+    log "Stage report written to ${report#$TARGET}"
+}
+
+# LOG_PREFIX distingue cada disco cuando se instalan varios a la vez
+LOG_PREFIX=""
+
 log() {
-    echo "[$(date '+%H:%M:%S')] $1" | tee -a "$LOG_FILE"
+    echo "[$(date '+%H:%M:%S')] $LOG_PREFIX$1" | tee -a "$LOG_FILE"
 }
 
 error() {
-    echo "[$(date '+%H:%M:%S')] ERROR: $1" | tee -a "$LOG_FILE" "$ERROR_LOG"
+    echo "[$(date '+%H:%M:%S')] ${LOG_PREFIX}ERROR: $1" | tee -a "$LOG_FILE" "$ERROR_LOG"
+    emit error "stage=$CURRENT_STAGE" "msg=$1"
+    restore_deferred_tools 2>/dev/null || true
+    stop_rss_sampler 2>/dev/null || true
     exit 1
 }
 
 warn() {
-    echo "[$(date '+%H:%M:%S')] WARNING: $1" | tee -a "$LOG_FILE"
+    echo "[$(date '+%H:%M:%S')] ${LOG_PREFIX}WARNING: $1" | tee -a "$LOG_FILE"
+    emit log sev=warn "stage=$CURRENT_STAGE" "msg=$1"
 }
 
 # ========== FUNCIONES DE VERIFICACIÓN ==========
@@ -46,7 +276,7 @@ check_requirements() {
         error "This script must be run as root"
     fi
 
-    local tools="rsync parted mkfs.ext4 mkfs.fat mount umount chroot grub-install"
+    local tools="rsync mkfs.$ROOT_FS mkfs.fat mount umount chroot grub-install"
     for tool in $tools; do
         if ! command -v "$tool" >/dev/null 2>&1; then
             error "Required tool not found: $tool"
@@ -64,6 +294,135 @@ detect_boot_mode() {
     fi
 }
 
+# ========== FUNCIONES DE DISPOSITIVOS ==========
+# Espera a que udev procese la cola de eventos pendiente
+settle_devices() {
+    if command -v udevadm >/dev/null 2>&1; then
+        udevadm settle --timeout="$DEVICE_TIMEOUT" >> "$LOG_FILE" 2>&1 || \
+            warn "udevadm settle timed out after ${DEVICE_TIMEOUT}s"
+    fi
+}
+
+# Pide al kernel releer la tabla (BLKRRPART) y comprueba el resultado
+reread_partition_table() {
+    local disk="$1"
+
+    # Sin tee: el resultado tiene que ser el de blockdev, no el de la tubería
+    if blockdev --rereadpt "$disk" >> "$LOG_FILE" 2>&1; then
+        log "Kernel re-read partition table of $disk"
+    else
+        # BLKRRPART falla con EBUSY si algo retiene el disco; partprobe usa BLKPG por partición
+        warn "BLKRRPART failed on $disk, falling back to partprobe"
+        partprobe "$disk" >> "$LOG_FILE" 2>&1 || \
+            warn "partprobe reported issues, continuing anyway"
+    fi
+
+    settle_devices
+}
+
+# Espera a que existan los nodos de dispositivo indicados (los vacíos se ignoran)
+wait_for_block_devices() {
+    local deadline=$((SECONDS + DEVICE_TIMEOUT))
+    local dev
+
+    for dev in "$@"; do
+        [ -n "$dev" ] || continue
+        while [ ! -b "$dev" ]; do
+            if [ "$SECONDS" -ge "$deadline" ]; then
+                warn "Timed out waiting for $dev"
+                return 1
+            fi
+            udevadm settle --timeout=1 --exit-if-exists="$dev" 2>/dev/null || true
+            [ -b "$dev" ] || sleep 0.1
+        done
+    done
+}
+
+# Atributo de la cola de bloques (/sys/.../queue) de un disco, partición o array md;
+# una partición usa la cola de su disco
+block_queue_attr() {
+    local dev=$(readlink -f "$1")
+    local sys="/sys/class/block/${dev##*/}"
+
+    [ -e "$sys/partition" ] && sys="$sys/.."
+    cat "$sys/queue/$2" 2>/dev/null || echo "$3"
+}
+
+# Verdadero si el dispositivo es de estado sólido y admite discard
+is_trimmable() {
+    [ "$(block_queue_attr "$1" rotational 1)" = "0" ] && \
+        [ "$(block_queue_attr "$1" discard_max_bytes 0)" != "0" ]
+}
+
+gcd() {
+    local a="$1" b="$2" t
+    while [ "$b" -ne 0 ]; do
+        t=$((a % b)); a=$b; b=$t
+    done
+    echo "$a"
+}
+
+# Prepara el particionado de un disco a partir de sysfs:
+#   DISK_GRAIN     alineación en bytes, mcm de 1 MiB, optimal_io_size,
+#                  discard_granularity y physical_block_size
+#   DISK_TRIM      true si conviene descartar el dispositivo entero
+# Un valor que llevaría la alineación por encima de DISK_ALIGN_MAX_MIB se ignora.
+probe_disk() {
+    local disk="$1"
+    local max=$((DISK_ALIGN_MAX_MIB * 1024 * 1024))
+    local attr value next
+
+    DISK_GRAIN=$((1024 * 1024))
+    for attr in optimal_io_size discard_granularity physical_block_size; do
+        value=$(block_queue_attr "$disk" "$attr" 0)
+        case "$value" in
+            ''|0|*[!0-9]*) continue ;;
+        esac
+        next=$((DISK_GRAIN / $(gcd "$DISK_GRAIN" "$value") * value))
+        if [ "$next" -le "$max" ]; then
+            DISK_GRAIN=$next
+        else
+            warn "$disk: ignoring $attr=$value (alignment would exceed ${DISK_ALIGN_MAX_MIB}MiB)"
+        fi
+    done
+
+    DISK_TRIM="false"
+    if [ "$DISK_DISCARD" = "true" ] && is_trimmable "$disk"; then
+        DISK_TRIM="true"
+    fi
+
+    local info="rotational=$(block_queue_attr "$disk" rotational 1)"
+    for attr in discard_granularity optimal_io_size physical_block_size; do
+        info="$info $attr=$(block_queue_attr "$disk" "$attr" 0)"
+    done
+    log "$disk: $info -> alignment $((DISK_GRAIN / 1024))KiB, whole-device discard: $DISK_TRIM"
+}
+
+# Discos ya descartados enteros por loc-partitioner: mkfs no necesita repetirlo
+declare -A TRIMMED_DISKS=()
+
+# Espera (máx. $1 segundos) a que ningún dispositivo o punto de montaje siga montado
+wait_for_unmount() {
+    local timeout="$1"
+    shift
+    local deadline=$((SECONDS + timeout))
+    local target
+
+    while :; do
+        local busy=""
+        for target in "$@"; do
+            if findmnt -rn "$target" >/dev/null 2>&1; then
+                busy="$target"
+                break
+            fi
+        done
+
+        [ -z "$busy" ] && return 0
+        [ "$SECONDS" -ge "$deadline" ] && return 1
+        sleep 0.1
+    done
+}
+
 # ========== FUNCIONES DE PARTICIONADO ==========
 
 # Función auxiliar para desmontar completamente un disco
@@ -99,11 +458,11 @@ force_unmount_disk() {
                     umount -l "$part" 2>&1 | tee -a "$LOG_FILE" || true
                 fi
             fi
-
-            sleep 1
         fi
     done
 
+    wait_for_unmount 2 $parts || true
+
     # 3. Verificar que nada quedó montado
     if mount | grep -q "^$disk"; then
         log "WARNING: Some partitions may still be mounted:"
@@ -131,13 +490,18 @@ partition_disk() {
     local uefi="$2"
     local add_swap="$3"
     local swap_size="$4"
+    local sep_home="${5:-false}"
+    local raid="${6:-false}"
 
-    log "Partitioning $disk (UEFI: $uefi, Swap: $add_swap)"
+    log "Partitioning $disk (UEFI: $uefi, Swap: $add_swap, RAID member: $raid)"
 
     # Verificar que el disco existe
     if [ ! -b "$disk" ]; then
         error "Disk $disk not found"
     fi
+    if [ ! -x "$PARTITIONER" ]; then
+        error "Partitioning helper not found: $PARTITIONER"
+    fi
 
     log "Unmounting all partitions on $disk..."
 
@@ -177,7 +541,7 @@ partition_disk() {
             break
         fi
 
-        sleep 2
+        wait_for_unmount 2 $mounted_parts || true
         attempt=$((attempt + 1))
     done
 
@@ -192,113 +556,58 @@ partition_disk() {
         dmsetup remove_all 2>&1 | tee -a "$LOG_FILE" || true
     fi
 
-    sleep 1
+    settle_devices
 
-    # Limpiar tabla
-    log "Wiping disk signature..."
-    if ! wipefs -a "$disk" 2>&1 | tee -a "$LOG_FILE"; then
-        warn "wipefs reported issues, continuing anyway"
+    # Calcular y escribir la tabla completa en una sola transacción (libfdisk)
+    local label="dos"
+    if [ "$uefi" = "true" ] || [ "$uefi" = "uefi" ]; then
+        label="gpt"
     fi
-
-    # Crear tabla de particiones
-    log "Creating partition table..."
-    if [ "$uefi" = "true" ]; then
-        if ! parted -s "$disk" mklabel gpt 2>&1 | tee -a "$LOG_FILE"; then
-            error "Failed to create GPT partition table"
-        fi
-    else
-        if ! parted -s "$disk" mklabel msdos 2>&1 | tee -a "$LOG_FILE"; then
-            error "Failed to create MSDOS partition table"
-        fi
+    if [ "$add_swap" != "true" ]; then
+        swap_size=0
     fi
 
-    sleep 2
-
-    local start="1MiB"
-    local part_num=1
+    # Alineación y descarte según lo que el propio disco anuncia en sysfs
+    probe_disk "$disk"
 
-    # Partición EFI para UEFI
-    if [ "$uefi" = "true" ]; then
-        log "Creating EFI partition (512MB)"
-        if ! parted -s "$disk" mkpart primary fat32 "$start" 513MiB 2>&1 | tee -a "$LOG_FILE"; then
-            error "Failed to create EFI partition"
-        fi
-        if ! parted -s "$disk" set "$part_num" esp on 2>&1 | tee -a "$LOG_FILE"; then
-            error "Failed to set ESP flag on EFI partition"
-        fi
-        EFI_PART="${disk}$(if [[ "$disk" =~ [0-9]$ ]]; then echo "p$part_num"; else echo "$part_num"; fi)"
-        log "EFI partition: $EFI_PART"
-        start="513MiB"
-        part_num=$((part_num + 1))
-    fi
-
-    # Partición swap (OPCIONAL)
-    if [ "$add_swap" = "true" ] && [ "$swap_size" -gt 0 ]; then
-        log "Creating swap partition (${swap_size}MB)"
-        local swap_end="$(( ${start%MiB} + swap_size ))MiB"
-        if ! parted -s "$disk" mkpart primary linux-swap "$start" "$swap_end" 2>&1 | tee -a "$LOG_FILE"; then
-            error "Failed to create swap partition"
-        fi
-        SWAP_PART="${disk}$(if [[ "$disk" =~ [0-9]$ ]]; then echo "p$part_num"; else echo "$part_num"; fi)"
-        log "Swap partition: $SWAP_PART"
-        start="$swap_end"
-        part_num=$((part_num + 1))
-    else
-        SWAP_PART=""
+    log "Writing $label partition table (swap: ${swap_size}MB, separate /home: $sep_home)..."
+    local layout
+    if ! layout=$("$PARTITIONER" --disk="$disk" --label="$label" --efi-size=512 \
+            --swap-size="$swap_size" --sep-home="$sep_home" --root-percent=60 \
+            --raid="$raid" --grain="$DISK_GRAIN" --discard="$DISK_TRIM" 2>>"$LOG_FILE"); then
+        error "Failed to write partition table on $disk"
     fi
+    echo "$layout" >> "$LOG_FILE"
+
+    EFI_PART=""
+    SWAP_PART=""
+    ROOT_PART=""
+    HOME_PART=""
+    local reread="" discarded=""
+    while IFS='=' read -r key value; do
+        case "$key" in
+            EFI_PART)  EFI_PART="$value" ;;
+            SWAP_PART) SWAP_PART="$value" ;;
+            ROOT_PART) ROOT_PART="$value" ;;
+            HOME_PART) HOME_PART="$value" ;;
+            DISCARD)   discarded="$value" ;;
+            REREAD)    reread="$value" ;;
+        esac
+    done <<< "$layout"
 
-    # Partición raíz y home
-    if [ "$sep_home" = "true" ]; then
-        # Obtener tamaño total del disco
-        log "Getting disk size..."
-        local disk_size_mb=$(parted -s "$disk" unit MiB print 2>&1 | grep "^Disk /" | awk '{print $3}' | sed 's/MiB//')
-
-        if [ -z "$disk_size_mb" ]; then
-            error "Could not determine disk size"
-        fi
-
-        log "Disk size: ${disk_size_mb}MB"
-
-        # Calcular tamaño raíz (60% del espacio restante)
-        local remaining_mb=$((disk_size_mb - ${start%MiB}))
-        local root_size=$((remaining_mb * 60 / 100))
-        local root_end="$(( ${start%MiB} + root_size ))MiB"
-
-        log "Creating root partition (${root_size}MB, from $start to $root_end)"
-        if ! parted -s "$disk" mkpart primary ext4 "$start" "$root_end" 2>&1 | tee -a "$LOG_FILE"; then
-            error "Failed to create root partition"
-        fi
-        ROOT_PART="${disk}$(if [[ "$disk" =~ [0-9]$ ]]; then echo "p$part_num"; else echo "$part_num"; fi)"
-        log "Root partition: $ROOT_PART"
-        part_num=$((part_num + 1))
-
-        log "Creating home partition (from $root_end to 100%)"
-        if ! parted -s "$disk" mkpart primary ext4 "$root_end" 100% 2>&1 | tee -a "$LOG_FILE"; then
-            error "Failed to create home partition"
-        fi
-        HOME_PART="${disk}$(if [[ "$disk" =~ [0-9]$ ]]; then echo "p$part_num"; else echo "$part_num"; fi)"
-        log "Home partition: $HOME_PART"
-    else
-        # Solo partición raíz
-        log "Creating root partition (from $start to 100%)"
-        if ! parted -s "$disk" mkpart primary ext4 "$start" 100% 2>&1 | tee -a "$LOG_FILE"; then
-            error "Failed to create root partition"
-        fi
-        ROOT_PART="${disk}$(if [[ "$disk" =~ [0-9]$ ]]; then echo "p$part_num"; else echo "$part_num"; fi)"
-        log "Root partition: $ROOT_PART"
-        HOME_PART=""
+    if [ "$discarded" = "ok" ]; then
+        TRIMMED_DISKS[$disk]=1
+    elif [ "$discarded" = "failed" ]; then
+        warn "Could not discard $disk, mkfs will discard each partition instead"
     fi
 
-    # Sincronizar y esperar que el kernel reconozca las particiones
-    log "Syncing and probing partitions..."
-    sync
-    sleep 3
-
-    if ! partprobe "$disk" 2>&1 | tee -a "$LOG_FILE"; then
-        warn "partprobe reported issues, continuing anyway"
+    # El helper ya hizo la relectura (BLKRRPART); solo se repite si falló
+    if [ "$reread" = "ok" ]; then
+        settle_devices
+    else
+        reread_partition_table "$disk"
     fi
-
-    sleep 2
+    wait_for_block_devices "$EFI_PART" "$SWAP_PART" "$ROOT_PART" "$HOME_PART" || true
 
     # Verificar que las particiones existen
     log "Verifying partitions exist..."
@@ -315,40 +624,297 @@ partition_disk() {
         error "EFI partition $EFI_PART was not created"
     fi
 
-    # Formatear particiones
-    log "Formatting partitions..."
+    # Miembros de RAID: partition_raid monta los arrays y formatea
+    if [ "$raid" = "true" ]; then
+        log "RAID member partitions on $disk: root=$ROOT_PART home=$HOME_PART swap=$SWAP_PART efi=$EFI_PART"
+        return 0
+    fi
 
-    if [ -n "$EFI_PART" ]; then
-        log "Formatting EFI: $EFI_PART"
-        if ! mkfs.fat -F 32 "$EFI_PART" 2>&1 | tee -a "$LOG_FILE"; then
-            error "Failed to format EFI partition"
+    # Formatear particiones (en paralelo, con opciones según el dispositivo)
+    format_partitions "$disk"
+
+    log "Partitioning completed successfully"
+    log "ROOT_PART=$ROOT_PART"
+    log "HOME_PART=$HOME_PART"
+    log "SWAP_PART=$SWAP_PART"
+    log "EFI_PART=$EFI_PART"
+}
+
+# ========== FUNCIONES DE RAID ==========
+# Distribución automática sobre varios discos: todos se particionan igual y
+# raíz (y /home y swap si se piden) son arrays md del nivel elegido, RAID0
+# (striping) o RAID1 (espejo). Cada disco lleva su propia EFI; la primera se
+# monta en /boot/efi y las demás reciben su propia copia de GRUB.
+RAID_DISKS=()
+EFI_MIRRORS=()
+
+# Detiene los arrays md que usan particiones del disco (restos de otras instalaciones)
+stop_raid_on_disk() {
+    local disk="$1"
+    local name="${disk##*/}"
+    local slave member md
+
+    for slave in /sys/block/md*/slaves/*; do
+        [ -e "$slave" ] || continue
+        member="${slave##*/}"
+        # El disco entero o una de sus particiones (/sys/block/<disco>/<partición>);
+        # comparar nombres por prefijo confundiría sda con sdaa
+        if [ "$member" = "$name" ] || [ -e "/sys/block/$name/$member" ]; then
+            md="${slave%/slaves/*}"
+            md="/dev/${md##*/}"
+            log "Stopping $md (uses /dev/$member)"
+            mdadm --stop "$md" >> "$LOG_FILE" 2>&1 || warn "Could not stop $md"
         fi
+    done
+}
+
+create_md_array() {
+    local md="$1"
+    local level="$2"
+    shift 2
+
+    log "Creating RAID$level array $md from: $*"
+    mdadm --zero-superblock --force "$@" >> "$LOG_FILE" 2>&1 || true
+
+    # homehost=any: el array se ensambla igual con el hostname del sistema instalado
+    if ! mdadm --create "$md" --run --level="$level" --raid-devices=$# \
+            --metadata=1.2 --homehost=any "$@" >> "$LOG_FILE" 2>&1; then
+        error "Failed to create RAID$level array $md"
     fi
+}
 
-    if [ -n "$SWAP_PART" ]; then
-        log "Formatting swap: $SWAP_PART"
-        if ! mkswap "$SWAP_PART" 2>&1 | tee -a "$LOG_FILE"; then
-            error "Failed to format swap partition"
-        fi
+partition_raid() {
+    local level="$1"
+    local uefi="$2"
+    local add_swap="$3"
+    local swap_size="$4"
+    local sep_home="$5"
+    shift 5
+
+    [ $# -ge 2 ] || error "RAID$level needs at least two disks"
+
+    local root_members=() home_members=() swap_members=() efi_parts=()
+    local disk
+    for disk in "$@"; do
+        stop_raid_on_disk "$disk"
+        partition_disk "$disk" "$uefi" "$add_swap" "$swap_size" "$sep_home" "true"
+
+        root_members+=("$ROOT_PART")
+        [ -n "$HOME_PART" ] && home_members+=("$HOME_PART")
+        [ -n "$SWAP_PART" ] && swap_members+=("$SWAP_PART")
+        [ -n "$EFI_PART" ] && efi_parts+=("$EFI_PART")
+    done
+
+    # udev puede ensamblar arrays antiguos al aparecer las particiones nuevas
+    for disk in "$@"; do
+        stop_raid_on_disk "$disk"
+    done
+
+    create_md_array /dev/md/loc-root "$level" "${root_members[@]}"
+    ROOT_PART="/dev/md/loc-root"
+    HOME_PART=""
+    SWAP_PART=""
+
+    if [ ${#home_members[@]} -gt 0 ]; then
+        create_md_array /dev/md/loc-home "$level" "${home_members[@]}"
+        HOME_PART="/dev/md/loc-home"
     fi
+    if [ ${#swap_members[@]} -gt 0 ]; then
+        create_md_array /dev/md/loc-swap "$level" "${swap_members[@]}"
+        SWAP_PART="/dev/md/loc-swap"
+    fi
+
+    settle_devices
+    wait_for_block_devices "$ROOT_PART" "$HOME_PART" "$SWAP_PART" || \
+        error "RAID arrays did not appear"
 
-    log "Formatting root: $ROOT_PART"
-    if ! mkfs.ext4 -F "$ROOT_PART" 2>&1 | tee -a "$LOG_FILE"; then
-        error "Failed to format root partition"
+    EFI_PART="${efi_parts[0]:-}"
+    EFI_MIRRORS=("${efi_parts[@]:1}")
+
+    # mkfs.ext4 toma stride/stripe-width de la geometría del array
+    format_partitions "$1"
+
+    log "RAID$level layout completed on $*"
+    log "ROOT_PART=$ROOT_PART"
+    log "HOME_PART=$HOME_PART"
+    log "SWAP_PART=$SWAP_PART"
+    log "EFI_PART=$EFI_PART ${EFI_MIRRORS[*]}"
+}
+
+# mdadm.conf del sistema instalado: el initramfs lo usa para ensamblar la raíz
+write_mdadm_config() {
+    local conf="$TARGET/etc/mdadm/mdadm.conf"
+
+    if [ ! -x "$TARGET/sbin/mdadm" ] && [ ! -x "$TARGET/usr/sbin/mdadm" ]; then
+        error "mdadm is not installed in the target system, its initramfs could not assemble the RAID"
     fi
 
+    mkdir -p "$(dirname "$conf")"
+    {
+        echo "# mdadm.conf - Generated by LOC-OS Installer"
+        echo "DEVICE partitions"
+        echo "MAILADDR root"
+        mdadm --detail --scan
+    } > "$conf"
+
+    log "mdadm.conf written with $(grep -c '^ARRAY' "$conf") array(s)"
+}
+
+# ========== SISTEMAS DE FICHEROS ==========
+# Tipo real de una partición ya formateada; en modo manual lo eligió el usuario
+fs_type() {
+    blkid -s TYPE -o value "$1" 2>/dev/null || echo ""
+}
+
+# Opciones de montaje para un sistema de ficheros y su dispositivo, las mismas
+# durante la instalación y en fstab. zstd:1 comprime casi a la velocidad de
+# escritura de un eMMC o una SD. En SSD, btrfs descarta en segundo plano
+# (discard=async); f2fs ya descarta por defecto y ext4/xfs usan el fstrim periódico.
+fs_mount_opts() {
+    local fs="$1" dev="$2"
+    local opts="noatime"
+
+    case "$fs" in
+        btrfs) opts="$opts,compress=zstd:1" ;;
+        f2fs)  opts="$opts,compress_algorithm=zstd" ;;
+    esac
+    if [ "$fs" = "btrfs" ] && [ -n "$dev" ] && is_trimmable "$dev"; then
+        opts="$opts,discard=async"
+    fi
+    echo "$opts"
+}
+
+# Campo <pass> de fstab: el fsck de btrfs y xfs no hace nada al arrancar
+fs_fsck_pass() {
+    case "$1" in
+        btrfs|xfs) echo 0 ;;
+        *)         echo "$2" ;;
+    esac
+}
+
+# ========== FUNCIONES DE FORMATEO ==========
+# Número de inodos para una raíz de ROOT_BYTES bytes: ficheros de la imagen del
+# sistema × ROOT_INODE_FACTOR, con los mínimos de la configuración
+estimate_root_inodes() {
+    local root_bytes="${1:-0}"
+    local files=""
+
+    if [ -f "$LIVE_SQUASHFS" ] && command -v unsquashfs >/dev/null 2>&1; then
+        files=$(unsquashfs -s "$LIVE_SQUASHFS" 2>/dev/null | awk '/^Number of inodes/ {print $4; exit}')
+    fi
+    if [ -z "$files" ]; then
+        files=$(df -i --output=iused / 2>/dev/null | tail -n 1 | tr -d ' ')
+    fi
+
+    case "$files" in
+        ''|*[!0-9]*) return 0 ;;
+    esac
+
+    local inodes=$((files * ROOT_INODE_FACTOR))
+    local floor=$((root_bytes / ROOT_BYTES_PER_INODE))
+    [ "$floor" -lt "$ROOT_INODE_MIN" ] && floor=$ROOT_INODE_MIN
+    [ "$inodes" -lt "$floor" ] && inodes=$floor
+    echo "$inodes"
+}
+
+# Lanza mkfs en segundo plano; la salida va a un log propio por trabajo
+start_format_job() {
+    local name="$1"
+    shift
+
+    log "Formatting $name: $*"
+    "$@" > "$FORMAT_JOB_DIR/$name.log" 2>&1 &
+    FORMAT_JOB_PIDS+=("$!")
+    FORMAT_JOB_NAMES+=("$name")
+}
+
+format_partitions() {
+    local disk="$1"
+    local started=$SECONDS
+
+    log "Formatting partitions..."
+
+    # En SSD con discard, mkfs descarta cada partición y no necesita ponerla a cero;
+    # si loc-partitioner ya descartó el disco entero no hace falta repetirlo
+    local discard="false"
+    if [ -n "${TRIMMED_DISKS[$disk]:-}" ]; then
+        log "$disk: already discarded, mkfs will not discard again"
+    elif is_trimmable "$disk"; then
+        discard="true"
+        log "$disk: non-rotational with discard support"
+    else
+        log "$disk: rotational or without discard support"
+    fi
+
+    # Raíz y /home con ROOT_FS. Sin discard, btrfs y xfs (-K) y f2fs (-t 0) no descartan.
+    local -a mkfs_cmd
+    local root_inode_opt=""
+    case "$ROOT_FS" in
+        ext4)
+            # Tablas de inodos y journal se inicializan en segundo plano tras el montaje
+            local ext4_opts="lazy_itable_init=1,lazy_journal_init=1"
+            [ "$discard" = "true" ] && ext4_opts="$ext4_opts,discard" || ext4_opts="$ext4_opts,nodiscard"
+            mkfs_cmd=(mkfs.ext4 -F -E "$ext4_opts")
+
+            # Ajustar inodos de la raíz solo si quedan por debajo del valor por defecto (1 cada 16 KiB)
+            local root_bytes=$(blockdev --getsize64 "$ROOT_PART" 2>/dev/null || echo 0)
+            local inodes=$(estimate_root_inodes "$root_bytes")
+            if [ -n "$inodes" ] && [ "$inodes" -lt $((root_bytes / 16384)) ]; then
+                root_inode_opt="-N $inodes"
+                log "Root inode count: $inodes"
+            fi
+            ;;
+        btrfs)
+            mkfs_cmd=(mkfs.btrfs -f)
+            [ "$discard" = "true" ] || mkfs_cmd+=(-K)
+            ;;
+        xfs)
+            mkfs_cmd=(mkfs.xfs -f)
+            [ "$discard" = "true" ] || mkfs_cmd+=(-K)
+            ;;
+        f2fs)
+            # La compresión es una característica de formato; mount_partitions elige qué se comprime
+            mkfs_cmd=(mkfs.f2fs -f -O extra_attr,inode_checksum,sb_checksum,compression)
+            [ "$discard" = "true" ] || mkfs_cmd+=(-t 0)
+            ;;
+    esac
+
+    FORMAT_JOB_DIR=$(mktemp -d /tmp/loc-mkfs.XXXXXX)
+    FORMAT_JOB_PIDS=()
+    FORMAT_JOB_NAMES=()
+
+    if [ -n "$EFI_PART" ]; then
+        start_format_job efi mkfs.fat -F 32 "$EFI_PART"
+    fi
+    local n=2 part
+    for part in "${EFI_MIRRORS[@]}"; do
+        start_format_job "efi$n" mkfs.fat -F 32 "$part"
+        n=$((n + 1))
+    done
+    if [ -n "$SWAP_PART" ]; then
+        start_format_job swap mkswap "$SWAP_PART"
+    fi
+    start_format_job root "${mkfs_cmd[@]}" $root_inode_opt "$ROOT_PART"
     if [ -n "$HOME_PART" ]; then
-        log "Formatting home: $HOME_PART"
-        if ! mkfs.ext4 -F "$HOME_PART" 2>&1 | tee -a "$LOG_FILE"; then
-            error "Failed to format home partition"
+        start_format_job home "${mkfs_cmd[@]}" "$HOME_PART"
+    fi
+
+    # Esperar a todos antes de informar, para no dejar mkfs huérfanos
+    local failed=""
+    local i
+    for i in "${!FORMAT_JOB_PIDS[@]}"; do
+        if ! wait "${FORMAT_JOB_PIDS[$i]}"; then
+            failed="$failed ${FORMAT_JOB_NAMES[$i]}"
         fi
+        cat "$FORMAT_JOB_DIR/${FORMAT_JOB_NAMES[$i]}.log" >> "$LOG_FILE"
+    done
+    rm -rf "$FORMAT_JOB_DIR"
+
+    if [ -n "$failed" ]; then
+        error "Failed to format partition(s):$failed"
     fi
 
-    log "Partitioning completed successfully"
-    log "ROOT_PART=$ROOT_PART"
-    log "HOME_PART=$HOME_PART"
-    log "SWAP_PART=$SWAP_PART"
-    log "EFI_PART=$EFI_PART"
+    log "Formatting completed in $((SECONDS - started))s"
 }
 
 # ========== FUNCIONES DE COPIA ==========
@@ -443,13 +1009,21 @@ mount_partitions() {
     # Crear directorio de montaje
     mkdir -p "$TARGET"
 
-    # Montar raíz
-    mount "$root_part" "$TARGET" || error "Failed to mount root"
+    # Montar raíz con las opciones de su sistema de ficheros (btrfs ya comprime la copia)
+    local root_fs=$(fs_type "$root_part")
+    mount -o "$(fs_mount_opts "$root_fs" "$root_part")" "$root_part" "$TARGET" || error "Failed to mount root"
+
+    # f2fs solo comprime los ficheros marcados, que heredan la marca de su directorio.
+    # Se marca /usr (casi toda la copia) y no /boot: GRUB no lee ficheros f2fs comprimidos.
+    if [ "$root_fs" = "f2fs" ]; then
+        mkdir -p "$TARGET/usr"
+        chattr +c "$TARGET/usr" 2>/dev/null || warn "f2fs compression not available, copying uncompressed"
+    fi
 
     # Montar home si existe
     if [ -n "$home_part" ]; then
         mkdir -p "$TARGET/home"
-        mount "$home_part" "$TARGET/home" || error "Failed to mount home"
+        mount -o "$(fs_mount_opts "$(fs_type "$home_part")" "$home_part")" "$home_part" "$TARGET/home" || error "Failed to mount home"
     fi
 
     # Montar boot si existe
@@ -480,16 +1054,143 @@ mount_partitions() {
     log "Partitions mounted"
 }
 
+# Convierte la salida de rsync --info=progress2 en eventos "copy" con cifras exactas
+# (bytes, ficheros, bytes/s, segundos restantes); el resto de líneas pasa tal cual.
+# Con muchos ficheros pequeños rsync escribe miles de líneas por segundo: solo se
+# emite un evento cuando cambia el porcentaje o, como mucho, uno por segundo.
+rsync_progress_filter() {
+    awk -v events="/dev/fd/$EVENT_FD" -v proto="$EVENT_PROTO" '
+        BEGIN { RS = "[\r\n]+" }
+
+        function now_ms(   cmd, ts) {
+            cmd = "date +%s%3N"
+            cmd | getline ts
+            close(cmd)
+            return ts
+        }
+
+        # Segundos actuales sin lanzar procesos: srand() devuelve la semilla anterior
+        function now_s(   t) {
+            srand()
+            t = srand()
+            return t
+        }
+
+        # "  1,234,567  12%  10.50MB/s  0:01:23 (xfr#12, to-chk=34/5678)"
+        $2 ~ /^[0-9]+%$/ && $3 ~ /B\/s$/ {
+            bytes = $1; gsub(/,/, "", bytes)
+            pct = $2; sub(/%/, "", pct)
+
+            sec = now_s()
+            if (pct == last_pct && sec == last_sec) next
+            last_pct = pct; last_sec = sec
+
+            rate = $3 + 0
+            if ($3 ~ /kB\/s$/) rate *= 1024
+            else if ($3 ~ /MB\/s$/) rate *= 1048576
+            else if ($3 ~ /GB\/s$/) rate *= 1073741824
+
+            n = split($4, t, ":")
+            eta = (n == 3) ? t[1] * 3600 + t[2] * 60 + t[3] : -1
+
+            files = -1; files_total = -1
+            if (match($0, /xfr#[0-9]+/)) files = substr($0, RSTART + 4, RLENGTH - 4)
+            if (match($0, /to-chk=[0-9]+\/[0-9]+/)) {
+                split(substr($0, RSTART + 7, RLENGTH - 7), c, "/")
+                files_total = c[2]
+                files = c[2] - c[1]
+            }
+
+            printf "%s %s copy stage=copy pct=%d bytes=%s files=%d files_total=%d rate=%d eta=%d msg=Copying files\n", \
+                proto, now_ms(), pct, bytes, files, files_total, rate, eta >> events
+            fflush(events)
+            next
+        }
+
+        {
+            sub(/^[[:space:]]+/, "")
+            if ($0 != "") { print; fflush() }
+        }
+    '
+}
+
+# Tabla de reasignación usuario en vivo -> usuario instalado, como opciones de rsync
+build_owner_map() {
+    OWNER_MAP_OPTS=()
+
+    if [ ! -d "$LIVE_HOME" ]; then
+        return 0
+    fi
+
+    local src_uid=$(stat -c %u "$LIVE_HOME")
+    local src_gid=$(stat -c %g "$LIVE_HOME")
+
+    if [ "$src_uid" != "$USER_UID" ]; then
+        OWNER_MAP_OPTS+=("--usermap=$src_uid:$USER_UID")
+    fi
+    if [ "$src_gid" != "$USER_GID" ]; then
+        OWNER_MAP_OPTS+=("--groupmap=$src_gid:$USER_GID")
+    fi
+
+    if [ ${#OWNER_MAP_OPTS[@]} -gt 0 ]; then
+        log "Remapping live user ownership $src_uid:$src_gid -> $USER_UID:$USER_GID in $LIVE_HOME"
+    fi
+}
+
+# Home del usuario en vivo, aparte de la copia principal para que la tabla de
+# build_owner_map solo se aplique a este árbol: fuera de él, el mismo UID puede
+# ser de otro usuario o de un servicio del sistema
+copy_live_home() {
+    [ ${#OWNER_MAP_OPTS[@]} -gt 0 ] || return 0
+    [ -d "${SOURCE_ROOT%/}$LIVE_HOME" ] || return 0
+
+    log "Copying $LIVE_HOME with remapped ownership..."
+
+    local excludes="/tmp/live-home-excludes.list"
+    cat > "$excludes" << EOF
+- /.cache/*
+- /Desktop/$DESKTOP_ENTRY_NAME
+- /.thumbnails/*
+- /.local/share/Trash/*
+- /.xsession-errors*
+- /.Xauthority
+- /.gvfs
+EOF
+
+    fanout_copy_begin "$LIVE_HOME"
+    if rsync -aAXH \
+        --numeric-ids \
+        --exclude-from="$excludes" \
+        "${OWNER_MAP_OPTS[@]}" \
+        "${FANOUT_OPTS[@]}" \
+        "${SOURCE_ROOT%/}$LIVE_HOME/" "$TARGET$LIVE_HOME/" >> "$LOG_FILE" 2>&1; then
+
+        log "$LIVE_HOME copy completed"
+    else
+        warn "$LIVE_HOME copy had issues (exit code $?), but continuing..."
+    fi
+    fanout_copy_end "$LIVE_HOME"
+
+    rm -f "$excludes"
+}
+
 copy_system() {
     local username="$1"
     log "Starting system copy..."
 
     create_exclude_list
+    build_owner_map
 
     # Variables de exclusión para particiones separadas
     local sep_home_opt=""
     local sep_boot_opt=""
 
+    # Con reasignación, el home en vivo se copia después con copy_live_home
+    local live_home_opt=""
+    if [ ${#OWNER_MAP_OPTS[@]} -gt 0 ]; then
+        live_home_opt="--exclude=$LIVE_HOME/"
+    fi
+
     if [ -n "$HOME_PART" ]; then
         sep_home_opt="--exclude=/home/*"
         log "Separate /home partition detected, will copy separately"
@@ -504,6 +1205,7 @@ copy_system() {
     log "Running rsync for root filesystem (this may take several minutes)..."
 
     # Usar un buffer para procesar la salida de rsync
+    fanout_copy_begin ""
     rsync -aAXH \
         --numeric-ids \
         --info=progress2 \
@@ -511,41 +1213,30 @@ copy_system() {
         --filter='P lost+found' \
         --filter='H lost+found' \
         --exclude-from="$RSYNC_EXCLUDES" \
+        "${FANOUT_OPTS[@]}" \
+        $live_home_opt \
         $sep_home_opt \
         $sep_boot_opt \
-        / "$TARGET/" 2>&1 | \
-    while IFS= read -r line_raw; do
-        # Eliminar retorno de carro y espacios extra al principio
-        line=$(echo "$line_raw" | sed 's/\r//g' | sed 's/^[[:space:]]*//')
-
-        # Detectar si es línea de progreso (contiene porcentaje y MB/s)
-        if echo "$line" | grep -qE '[0-9]+%.*[0-9]+\.[0-9]+[MKGB]/s'; then
-            # Extraer información clave
-            percent=$(echo "$line" | grep -oE '[0-9]+%' | head -1)
-            speed=$(echo "$line" | grep -oE '[0-9]+\.[0-9]+[MKG]B/s' | head -1 || echo "0.0MB/s")
-            eta=$(echo "$line" | grep -oE '[0-9]+:[0-9]+:[0-9]+' | head -1 || echo "0:00:00")
-
-            # Enviar línea formateada
-            echo "RSYNC_PROGRESS: $percent $speed $eta"
-        else
-            # Otras líneas normales
-            echo "$line"
-        fi
-    done | tee -a "$LOG_FILE"
+        "${SOURCE_ROOT%/}/" "$TARGET/" 2>&1 | \
+    rsync_progress_filter | tee -a "$LOG_FILE"
 
     local rsync_exit=${PIPESTATUS[0]}
+    fanout_copy_end ""
 
     # PASO 2: Copiar /home por separado si existe partición separada
     if [ -n "$HOME_PART" ]; then
         log "Copying /home to separate partition..."
 
         # IMPORTANTE: Crear el directorio home del nuevo usuario si no existe
-        local new_username_home="$TARGET/home/$USERNAME"
-        if [ ! -d "$new_username_home" ] && [ -n "$USERNAME" ]; then
-            log "Creating home directory for $USERNAME in separate partition"
-            mkdir -p "$new_username_home"
-            chmod 755 "$new_username_home"
-        fi
+        local t
+        for t in "$TARGET" "${FANOUT_TARGETS[@]}"; do
+            local new_username_home="$t/home/$USERNAME"
+            if [ ! -d "$new_username_home" ] && [ -n "$USERNAME" ]; then
+                log "Creating home directory for $USERNAME in separate partition"
+                mkdir -p "$new_username_home"
+                chmod 755 "$new_username_home"
+            fi
+        done
 
         # Crear lista de excludes para home (más permisiva)
         local home_excludes="/tmp/home-excludes.list"
@@ -559,43 +1250,58 @@ copy_system() {
 - .gvfs
 EOF
 
+        fanout_copy_begin /home
         if rsync -aAX \
+            --numeric-ids \
             --info=progress2 \
             --filter='P lost+found' \
             --filter='H lost+found' \
             --exclude-from="$home_excludes" \
-            /home/ "$TARGET/home/" 2>&1 | tee -a "$LOG_FILE"; then
+            "${FANOUT_OPTS[@]}" \
+            ${live_home_opt:+"--exclude=${LIVE_HOME#/home}/"} \
+            "${SOURCE_ROOT%/}/home/" "$TARGET/home/" 2>&1 | rsync_progress_filter | tee -a "$LOG_FILE"; then
 
             log "Home directory copy completed"
-
-            # Cambiar propietario del home copiado si el usuario cambió
-            if [ -n "$USERNAME" ] && [ -d "$TARGET/home/live" ]; then
-                log "Setting ownership for copied home directories..."
-                chroot "$TARGET" chown -R "$USERNAME:$USERNAME" "/home/live" 2>/dev/null || true
-            fi
         else
             warn "Home copy had issues (exit code $?), but continuing..."
         fi
+        fanout_copy_end /home
 
         rm -f "$home_excludes"
     fi
 
+    copy_live_home
+
     # PASO 3: Copiar /boot por separado si existe partición separada
     if [ -n "$BOOT_PART" ]; then
         log "Copying /boot to separate partition..."
 
+        fanout_copy_begin /boot
         if rsync -aAX \
             --info=progress2 \
             --filter='P lost+found' \
             --filter='H lost+found' \
-            /boot/ "$TARGET/boot/" 2>&1 | tee -a "$LOG_FILE"; then
+            "${FANOUT_OPTS[@]}" \
+            "${SOURCE_ROOT%/}/boot/" "$TARGET/boot/" 2>&1 | tee -a "$LOG_FILE"; then
 
             log "Boot directory copy completed"
         else
             warn "Boot copy had issues (exit code $?), but continuing..."
         fi
+        fanout_copy_end /boot
     fi
 
+    # PASOS 4-7 en cada destino
+    local t
+    for t in "$TARGET" "${FANOUT_TARGETS[@]}"; do
+        ( TARGET="$t"; prepare_target_tree )
+    done
+
+    log "System copy stage completed"
+}
+
+# Directorios, nodos de dispositivo y ajustes que la copia no trae
+prepare_target_tree() {
     # PASO 4: Crear directorios esenciales
     log "Creating essential directories..."
     mkdir -p "$TARGET"/{proc,sys,dev,tmp,run,mnt,media}
@@ -646,8 +1352,6 @@ EOF
         log "Disabling automount of fixed drives in pmount"
         sed -i 's:^/dev/sd\[a-z\]:#/dev/sd\[a-z\]:' "$TARGET/etc/pmount.allow" 2>/dev/null || true
     fi
-
-    log "System copy stage completed"
 }
 
 create_swapfile() {
@@ -657,6 +1361,12 @@ create_swapfile() {
 
     log "Creating ${swapfile_size}MB swapfile..."
 
+    # btrfs: un swapfile no puede ser CoW ni ir comprimido; la marca se pone con el fichero vacío
+    > "$TARGET/swapfile"
+    if [ "$(fs_type "$ROOT_PART")" = "btrfs" ]; then
+        chattr +C "$TARGET/swapfile" 2>/dev/null || warn "Could not disable CoW on the swapfile"
+    fi
+
     # 1. Verificar espacio
     local free_mb=$(df -m "$TARGET" | tail -1 | awk '{print $4}')
     [ $free_mb -lt $swapfile_size ] && {
@@ -728,6 +1438,102 @@ create_swapfile() {
     return 1
 }
 
+# ========== POLÍTICA DE MANTENIMIENTO DE PAQUETES ==========
+# Mientras se configura el destino, los hooks caros (initramfs, setupcon) solo se
+# registran; al final se ejecutan una única vez. Tampoco se arrancan servicios.
+DEFERRED_DIR="/var/lib/loc-installer/deferred"
+MAINTENANCE_DEFERRED="false"
+
+# Ejecuta un comando de mantenimiento de paquetes dentro del chroot sin diálogos
+chroot_maint() {
+    DEBIAN_FRONTEND=noninteractive \
+    DEBCONF_NONINTERACTIVE_SEEN=true \
+    chroot "$TARGET" "$@"
+}
+
+begin_deferred_maintenance() {
+    [ "$MAINTENANCE_DEFERRED" = "true" ] && return 0
+
+    log "Deferring package hooks and triggers until the end of the installation"
+    mkdir -p "$TARGET$DEFERRED_DIR"
+    : > "$TARGET$DEFERRED_DIR/.diverted"
+
+    # policy-rc.d: invoke-rc.d no arranca ni reinicia servicios en el chroot
+    cat > "$TARGET/usr/sbin/policy-rc.d" << 'EOF'
+#!/bin/sh
+# LOC-OS Installer: no service actions during installation
+exit 101
+EOF
+    chmod 755 "$TARGET/usr/sbin/policy-rc.d"
+
+    # Herramientas a aplazar (setupcon puede estar en /bin o /usr/bin)
+    local tools="/usr/sbin/update-initramfs"
+    for candidate in /usr/bin/setupcon /bin/setupcon; do
+        if [ -f "$TARGET$candidate" ]; then
+            tools="$tools $candidate"
+            break
+        fi
+    done
+
+    for tool in $tools; do
+        [ -f "$TARGET$tool" ] || continue
+        local name=$(basename "$tool")
+
+        if ! chroot "$TARGET" dpkg-divert --local --rename \
+                --divert "$tool.loc-deferred" --add "$tool" >/dev/null 2>&1; then
+            mv "$TARGET$tool" "$TARGET$tool.loc-deferred" || continue
+        fi
+
+        cat > "$TARGET$tool" << EOF
+#!/bin/sh
+# LOC-OS Installer: deferred until the end of the installation
+echo "\$*" >> "$DEFERRED_DIR/$name"
+exit 0
+EOF
+        chmod 755 "$TARGET$tool"
+        echo "$tool" >> "$TARGET$DEFERRED_DIR/.diverted"
+    done
+
+    MAINTENANCE_DEFERRED="true"
+}
+
+# Devuelve las herramientas originales a su sitio (también en errores)
+restore_deferred_tools() {
+    [ "$MAINTENANCE_DEFERRED" = "true" ] || return 0
+    MAINTENANCE_DEFERRED="false"
+
+    if [ -f "$TARGET$DEFERRED_DIR/.diverted" ]; then
+        while read -r tool; do
+            [ -n "$tool" ] || continue
+            rm -f "$TARGET$tool"
+            if ! chroot "$TARGET" dpkg-divert --local --rename --remove "$tool" >/dev/null 2>&1; then
+                mv "$TARGET$tool.loc-deferred" "$TARGET$tool" 2>/dev/null || true
+            fi
+        done < "$TARGET$DEFERRED_DIR/.diverted"
+    fi
+
+    rm -f "$TARGET/usr/sbin/policy-rc.d"
+}
+
+# Restaura las herramientas y ejecuta una sola vez lo que se pidió durante la instalación.
+# El initramfs no se genera aquí: cleanup_post_install lo hace siempre al final.
+run_deferred_maintenance() {
+    [ "$MAINTENANCE_DEFERRED" = "true" ] || return 0
+    restore_deferred_tools
+
+    if [ -s "$TARGET$DEFERRED_DIR/setupcon" ]; then
+        log "Running deferred setupcon ($(wc -l < "$TARGET$DEFERRED_DIR/setupcon") request(s))"
+        chroot_maint setupcon --save-only 2>&1 | tee -a "$LOG_FILE" || \
+            warn "setupcon may have warnings"
+    fi
+
+    if [ -s "$TARGET$DEFERRED_DIR/update-initramfs" ]; then
+        log "Coalesced $(wc -l < "$TARGET$DEFERRED_DIR/update-initramfs") initramfs request(s) into the final build"
+    fi
+
+    rm -rf "$TARGET$DEFERRED_DIR"
+}
+
 # ========== FUNCIONES DE CONFIGURACIÓN REGIONAL ==========
 configure_locales() {
     local timezone="$1"
@@ -824,7 +1630,7 @@ EOF
         log "X11 keyboard set to: layout=$keyboard, variant=$xkb_variant"
 
         # Aplicar configuración
-        chroot "$TARGET" dpkg-reconfigure -f noninteractive keyboard-configuration 2>/dev/null || \
+        chroot_maint dpkg-reconfigure -f noninteractive keyboard-configuration 2>/dev/null || \
             warn "Keyboard configuration may have warnings"
     fi
 
@@ -857,29 +1663,41 @@ EOF
         blkid -s UUID -o value "$1" 2>/dev/null || echo ""
     }
 
+    # Tipo y opciones según lo que hay realmente en la partición (en manual, lo que eligió el usuario)
+    local fs opts
+
     # Raíz
     if [ -n "$ROOT_PART" ]; then
+        fs=$(fs_type "$ROOT_PART")
+        : ${fs:=ext4}
+        opts="defaults,$(fs_mount_opts "$fs" "$ROOT_PART")"
+        [ "$fs" = "ext4" ] && opts="$opts,errors=remount-ro"
+
         uuid=$(get_uuid "$ROOT_PART")
         if [ -n "$uuid" ]; then
-            echo "UUID=$uuid / ext4 defaults,noatime,errors=remount-ro 0 1" >> "$TARGET/etc/fstab"
+            echo "UUID=$uuid / $fs $opts 0 $(fs_fsck_pass "$fs" 1)" >> "$TARGET/etc/fstab"
         else
-            echo "$ROOT_PART / ext4 defaults,noatime,errors=remount-ro 0 1" >> "$TARGET/etc/fstab"
+            echo "$ROOT_PART / $fs $opts 0 $(fs_fsck_pass "$fs" 1)" >> "$TARGET/etc/fstab"
         fi
     fi
 
     # Home
     if [ -n "$HOME_PART" ]; then
+        fs=$(fs_type "$HOME_PART")
+        : ${fs:=ext4}
         uuid=$(get_uuid "$HOME_PART")
         if [ -n "$uuid" ]; then
-            echo "UUID=$uuid /home ext4 defaults,noatime 0 2" >> "$TARGET/etc/fstab"
+            echo "UUID=$uuid /home $fs defaults,$(fs_mount_opts "$fs" "$HOME_PART") 0 $(fs_fsck_pass "$fs" 2)" >> "$TARGET/etc/fstab"
         fi
     fi
 
     # Boot
     if [ -n "$BOOT_PART" ]; then
+        fs=$(fs_type "$BOOT_PART")
+        : ${fs:=ext4}
         uuid=$(get_uuid "$BOOT_PART")
         if [ -n "$uuid" ]; then
-            echo "UUID=$uuid /boot ext4 defaults,noatime 0 1" >> "$TARGET/etc/fstab"
+            echo "UUID=$uuid /boot $fs defaults,$(fs_mount_opts "$fs" "$BOOT_PART") 0 $(fs_fsck_pass "$fs" 1)" >> "$TARGET/etc/fstab"
         fi
     fi
 
@@ -887,7 +1705,12 @@ EOF
     if [ -n "$SWAP_PART" ]; then
         uuid=$(get_uuid "$SWAP_PART")
         if [ -n "$uuid" ]; then
-            echo "UUID=$uuid none swap sw 0 0" >> "$TARGET/etc/fstab"
+            # En SSD, las páginas de swap liberadas se descartan
+            if is_trimmable "$SWAP_PART"; then
+                echo "UUID=$uuid none swap sw,discard 0 0" >> "$TARGET/etc/fstab"
+            else
+                echo "UUID=$uuid none swap sw 0 0" >> "$TARGET/etc/fstab"
+            fi
         fi
     fi
 
@@ -901,7 +1724,14 @@ EOF
     if [ -n "$EFI_PART" ]; then
         uuid=$(get_uuid "$EFI_PART")
         if [ -n "$uuid" ]; then
-            echo "UUID=$uuid /boot/efi vfat umask=0077 0 1" >> "$TARGET/etc/fstab"
+            # Con RAID1 la ESP es la del primer disco: si falta, se arranca desde
+            # la copia de GRUB de otro miembro y /boot/efi no debe parar el arranque.
+            # Con RAID0 el sistema no arranca sin un disco: la ESP sigue siendo obligatoria
+            if [ "$RAID_LEVEL" = "1" ]; then
+                echo "UUID=$uuid /boot/efi vfat umask=0077,nofail 0 0" >> "$TARGET/etc/fstab"
+            else
+                echo "UUID=$uuid /boot/efi vfat umask=0077 0 1" >> "$TARGET/etc/fstab"
+            fi
         fi
     fi
 
@@ -909,6 +1739,33 @@ EOF
     echo "tmpfs /tmp tmpfs defaults,noatime,mode=1777 0 0" >> "$TARGET/etc/fstab"
 
     log "fstab created"
+
+    if is_trimmable "$ROOT_PART" || { [ -n "$HOME_PART" ] && is_trimmable "$HOME_PART"; }; then
+        enable_periodic_trim
+    fi
+}
+
+# fstrim semanal de todo lo montado: systemd (fstrim.timer) o cron, lo que use el sistema
+enable_periodic_trim() {
+    if [ -f "$TARGET/lib/systemd/system/fstrim.timer" ] && \
+            [[ "$(readlink "$TARGET/sbin/init" 2>/dev/null)" == *systemd* ]]; then
+        if chroot "$TARGET" systemctl enable fstrim.timer >> "$LOG_FILE" 2>&1; then
+            log "Enabled weekly fstrim.timer"
+            return 0
+        fi
+    fi
+
+    if [ -d "$TARGET/etc/cron.weekly" ]; then
+        cat > "$TARGET/etc/cron.weekly/fstrim" << 'EOF'
+#!/bin/sh
+# LOC-OS Installer: trim free space on every mounted filesystem that supports it
+exec fstrim --all
+EOF
+        chmod 755 "$TARGET/etc/cron.weekly/fstrim"
+        log "Added weekly fstrim to cron"
+    else
+        warn "Neither systemd nor cron found, periodic TRIM not enabled"
+    fi
 }
 
 configure_autologin() {
@@ -1033,134 +1890,55 @@ ff02::1		ip6-allnodes
 ff02::2		ip6-allrouters
 EOF
 
-    # 2. Buscar usuario existente (UID 1000)
-    local old_username=$(chroot "$TARGET" awk -F: '$3 == 1000 {print $1}' /etc/passwd 2>/dev/null)
+    # 2. Buscar usuario existente (UID del usuario instalado)
+    # La propiedad de los ficheros ya se asignó durante la copia: renombrar no recorre el árbol
+    local old_username=$(awk -F: -v uid="$USER_UID" '$3 == uid {print $1}' "$TARGET/etc/passwd" 2>/dev/null)
+
+    # Cambios en passwd/shadow/group/gshadow: se aplican juntos y cada fichero se escribe una vez
+    local userdb_args=(--root="$TARGET" --add-groups="$new_username:sudo")
 
     if [ -z "$old_username" ]; then
         # Crear usuario nuevo
         log "Creating new user: $new_username"
         chroot "$TARGET" useradd -m \
+            -u "$USER_UID" \
             -G sudo,users,audio,video,disk,cdrom,dip,plugdev \
             -s /bin/bash \
             "$new_username"
     elif [ "$old_username" != "$new_username" ]; then
-        # ===========================================================
-        # CASO ESPECIAL: Home en partición separada vs sistema raíz
-        # ===========================================================
-
-        # Verificar si estamos usando partición de home separada
-        if [ -n "$HOME_PART" ]; then
-            log "Separate /home partition detected - special handling for user rename"
-
-            # Las rutas pueden estar en diferentes particiones
-            local old_home_root="/home/$old_username"    # En partición separada
-            local new_home_root="/home/$new_username"    # En partición separada
-
-            # 1. Cambiar nombre de grupo si existe
-            log "Changing group name from $old_username to $new_username"
-            if chroot "$TARGET" grep -q "^$old_username:" /etc/group 2>/dev/null; then
-                chroot "$TARGET" groupmod -n "$new_username" "$old_username" 2>&1 | tee -a "$LOG_FILE" || {
-                    warn "Could not rename group $old_username"
-                    # Crear grupo nuevo si falla
-                    chroot "$TARGET" groupadd "$new_username" 2>/dev/null || true
-                }
-            else
-                chroot "$TARGET" groupadd "$new_username" 2>/dev/null || true
-            fi
-
-            # 2. Cambiar nombre de usuario
-            log "Changing username from $old_username to $new_username"
-            chroot "$TARGET" usermod -l "$new_username" "$old_username" 2>&1 | tee -a "$LOG_FILE" || {
-                error "Failed to change username from $old_username to $new_username"
-            }
-
-            # 3. Configurar directorio home en /etc/passwd
-            log "Updating home directory in /etc/passwd to $new_home_root"
-            chroot "$TARGET" usermod -d "$new_home_root" "$new_username" 2>&1 | tee -a "$LOG_FILE" || {
-                warn "Could not update home directory in /etc/passwd"
-                # Manual update
-                sed -i "s|^$new_username:[^:]*:[^:]*:[^:]*:[^:]*:\K.*|$new_home_root|" "$TARGET/etc/passwd" 2>/dev/null || true
-            }
-
-            # 4. Manejar directorios de home físicos
-            if [ -d "$TARGET/home/live" ] && [ ! -d "$TARGET/home/$new_username" ]; then
-                log "Renaming home directory from /home/live to /home/$new_username"
-                mv "$TARGET/home/live" "$TARGET/home/$new_username" 2>&1 | tee -a "$LOG_FILE" || {
-                    warn "Could not rename directory, copying instead"
-                    cp -a "$TARGET/home/live/." "$TARGET/home/$new_username/" 2>/dev/null || true
-                    rm -rf "$TARGET/home/live" 2>/dev/null || true
-                }
-            elif [ -d "$TARGET/home/live" ] && [ -d "$TARGET/home/$new_username" ]; then
-                log "Both /home/live and /home/$new_username exist, merging..."
-                cp -a "$TARGET/home/live/." "$TARGET/home/$new_username/" 2>/dev/null || true
-                rm -rf "$TARGET/home/live" 2>/dev/null || true
-            fi
-
-            # 5. Establecer permisos correctos
-            if [ -d "$TARGET/home/$new_username" ]; then
-                log "Setting ownership for /home/$new_username"
-                chroot "$TARGET" chown -R "$new_username:$new_username" "/home/$new_username" 2>/dev/null || true
-            fi
-
-            # 6. Actualizar registros de usuario en /etc/shadow, /etc/gshadow, etc.
-            log "Updating user references in system files..."
-            sed -i "s/^$old_username:/$new_username:/" "$TARGET/etc/shadow" 2>/dev/null || true
-            sed -i "s/^$old_username:/$new_username:/" "$TARGET/etc/gshadow" 2>/dev/null || true
-            sed -i "s/:[^:]*:$old_username:/:$new_username:/" "$TARGET/etc/group" 2>/dev/null || true
-            sed -i "s/,$old_username,/,$new_username,/" "$TARGET/etc/group" 2>/dev/null || true
-            sed -i "s/,$old_username$/,$new_username/" "$TARGET/etc/group" 2>/dev/null || true
-
-        else
-            # Home NO separado - usar método normal
-            log "Renaming user $old_username to $new_username (home in root partition)"
-
-            # Cambiar nombre de grupo
-            chroot "$TARGET" groupmod -n "$new_username" "$old_username" 2>/dev/null || true
-
-            # Cambiar nombre de usuario
-            chroot "$TARGET" usermod -l "$new_username" "$old_username" 2>/dev/null || true
-
-            # Cambiar directorio home (con -m para mover archivos)
-            chroot "$TARGET" usermod -d /home/"$new_username" -m "$new_username" 2>&1 | tee -a "$LOG_FILE" || {
-                warn "Could not move home directory, creating new one"
-                chroot "$TARGET" mkdir -p "/home/$new_username"
-                chroot "$TARGET" chown "$new_username:$new_username" "/home/$new_username"
-                if chroot "$TARGET" [ -d "/home/$old_username" ]; then
-                    chroot "$TARGET" cp -a "/home/$old_username/." "/home/$new_username/" 2>/dev/null || true
-                fi
-            }
-
-            # Limpiar directorio antiguo si quedó vacío
-            if chroot "$TARGET" [ -d "/home/$old_username" ]; then
-                if [ -z "$(chroot "$TARGET" ls -A "/home/$old_username" 2>/dev/null)" ]; then
-                    chroot "$TARGET" rmdir "/home/$old_username" 2>/dev/null || true
-                else
-                    log "Old home directory not empty, keeping: /home/$old_username"
-                    chroot "$TARGET" chown -R "$new_username:$new_username" "/home/$old_username" 2>/dev/null || true
-                fi
-            fi
+        log "Renaming user $old_username to $new_username"
+        userdb_args+=(--rename="$old_username:$new_username" --home="$new_username:/home/$new_username")
+
+        # Directorio home físico (mismo sistema de ficheros: mv es un rename)
+        local old_home=$(awk -F: -v u="$old_username" '$1 == u {print $6}' "$TARGET/etc/passwd")
+        [ -n "$old_home" ] || old_home="/home/$old_username"
+
+        if [ -d "$TARGET$old_home" ] && [ ! -e "$TARGET/home/$new_username" ]; then
+            log "Renaming home directory from $old_home to /home/$new_username"
+            mv "$TARGET$old_home" "$TARGET/home/$new_username" 2>&1 | tee -a "$LOG_FILE" || \
+                warn "Could not rename home directory $old_home"
+        elif [ -d "$TARGET$old_home" ]; then
+            log "Both $old_home and /home/$new_username exist, merging..."
+            cp -a "$TARGET$old_home/." "$TARGET/home/$new_username/" 2>/dev/null || true
+            rm -rf "$TARGET$old_home" 2>/dev/null || true
         fi
     else
         log "Username unchanged: $new_username"
     fi
 
-    # 3. Configurar contraseñas
-    log "Setting user password"
-    echo "$new_username:$password" | chroot "$TARGET" chpasswd 2>/dev/null
-
-    # Configurar contraseña de root (puede ser diferente o igual)
+    # 3. Renombrado, home, grupo sudo y contraseñas en una sola pasada
     if [ "$root_password" != "$password" ]; then
-        log "Setting custom root password"
+        log "Setting user password and custom root password"
     else
-        log "Setting root password (same as user)"
+        log "Setting user and root password (same as user)"
     fi
-    echo "root:$root_password" | chroot "$TARGET" chpasswd 2>/dev/null
 
-    # 4. Configurar sudo
-    log "Configuring sudo..."
-    chroot "$TARGET" usermod -a -G sudo "$new_username" 2>/dev/null
+    if ! printf '%s:%s\n%s:%s\n' "$new_username" "$password" root "$root_password" | \
+            "$USERDB" "${userdb_args[@]}" --passwords-from-stdin >> "$LOG_FILE" 2>&1; then
+        error "Failed to update user database for $new_username"
+    fi
 
-    # Asegurar configuración de sudo
+    # 4. Asegurar configuración de sudo
     if ! grep -q "^%sudo" "$TARGET/etc/sudoers" 2>/dev/null; then
         echo "%sudo ALL=(ALL:ALL) ALL" >> "$TARGET/etc/sudoers"
     fi
@@ -1172,6 +1950,208 @@ EOF
 }
 
 # ========== FUNCIONES DE BOOTLOADER ==========
+# Fija una variable en /etc/default/grub del destino (descomentándola si hace falta)
+set_grub_default() {
+    local key="$1"
+    local value="$2"
+    local file="$TARGET/etc/default/grub"
+
+    if grep -qE "^#?[[:space:]]*$key=" "$file" 2>/dev/null; then
+        sed -i -E "s|^#?[[:space:]]*$key=.*|$key=$value|" "$file"
+    else
+        echo "$key=$value" >> "$file"
+    fi
+}
+
+# Ejecuta "$@" con la partición montada en solo lectura (o donde ya lo esté);
+# la función llamada encuentra el punto de montaje en PART_MNT. El journal no se
+# reproduce: la partición de otro sistema queda tal cual.
+with_partition_ro() {
+    local dev="$1"
+    shift
+
+    local PART_MNT owned="" rc=0
+    PART_MNT=$(findmnt -rno TARGET "$dev" 2>/dev/null | head -n 1)
+    if [ -z "$PART_MNT" ]; then
+        local opts="ro"
+        case "$(fs_type "$dev")" in
+            ext3|ext4) opts="ro,noload" ;;
+            xfs)       opts="ro,norecovery" ;;
+            ufs)       opts="ro,ufstype=ufs2" ;;
+        esac
+        PART_MNT=$(mktemp -d /tmp/loc-probe.XXXXXX)
+        if ! mount -o "$opts" "$dev" "$PART_MNT" 2>/dev/null; then
+            rmdir "$PART_MNT" 2>/dev/null || true
+            return 1
+        fi
+        owned="true"
+    fi
+
+    "$@" || rc=$?
+
+    if [ -n "$owned" ]; then
+        umount "$PART_MNT" 2>/dev/null || umount -l "$PART_MNT" 2>/dev/null || true
+        rmdir "$PART_MNT" 2>/dev/null || true
+    fi
+    return $rc
+}
+
+partition_has_file() {
+    [ -f "$PART_MNT$1" ]
+}
+
+# Qué sistema hay en la partición montada: "linux|grub.cfg|nombre" o
+# "bsd|loader|nombre". Solo se leen ficheros, nunca se ejecuta nada de ella.
+describe_os_partition() {
+    local prefix release name
+
+    # btrfs: la raíz suele estar en el subvolumen @
+    for prefix in "" "/@"; do
+        release="$PART_MNT$prefix/etc/os-release"
+        # Un enlace absoluto apuntaría al sistema en vivo
+        if [ ! -f "$release" ] || [[ "$(readlink "$release")" == /* ]]; then
+            release="$PART_MNT$prefix/usr/lib/os-release"
+        fi
+        [ -f "$release" ] || continue
+
+        name=$(sed -n 's/^PRETTY_NAME=//p' "$release" | head -n 1 | tr -d "\"'")
+        if [ -f "$PART_MNT$prefix/boot/grub/grub.cfg" ]; then
+            echo "linux|$prefix/boot/grub/grub.cfg|${name:-Linux}"
+            return 0
+        fi
+        # Sin grub.cfg en la partición (/boot aparte, otro cargador): no se sabe arrancar
+        return 1
+    done
+
+    if [ -f "$PART_MNT/boot/loader" ]; then
+        echo "bsd|/boot/loader|BSD"
+        return 0
+    fi
+    return 1
+}
+
+# Módulo de GRUB que lee cada sistema de ficheros
+grub_fs_module() {
+    case "$1" in
+        ext2|ext3|ext4) echo "ext2" ;;
+        ufs)            echo "ufs2" ;;
+        *)              echo "$1" ;;
+    esac
+}
+
+# Genera las entradas de otros sistemas a partir de la lista del instalador
+# (--other-os) o las omite (--os-prober=false). En ambos casos update-grub no
+# ejecuta os-prober, que monta y examina todas las particiones de todos los discos:
+# de la lista solo se montan las particiones candidatas a Linux/BSD.
+configure_other_os_entries() {
+    local script="$TARGET/etc/grub.d/35_loc_other_os"
+    rm -f "$script"
+
+    if [ -z "$OTHER_OS_LIST" ] && [ "$OS_PROBER" != "false" ]; then
+        log "No precomputed OS list, update-grub will run os-prober"
+        return 0
+    fi
+
+    set_grub_default GRUB_DISABLE_OS_PROBER true
+
+    if [ -z "$OTHER_OS_LIST" ] || [ ! -s "$OTHER_OS_LIST" ]; then
+        log "os-prober disabled, no other operating systems added"
+        return 0
+    fi
+
+    {
+        echo "#!/bin/sh"
+        echo "# Generated by LOC-OS Installer from its own disk probe"
+        echo "exec tail -n +4 \$0"
+    } > "$script"
+
+    local count=0
+    while IFS='|' read -r kind dev name loader; do
+        [ -b "$dev" ] || continue
+        # Las particiones de esta instalación nunca son "otro sistema"
+        case "$dev" in
+            "$ROOT_PART"|"$HOME_PART"|"$BOOT_PART"|"$EFI_PART") continue ;;
+        esac
+        local uuid=$(blkid -s UUID -o value "$dev" 2>/dev/null)
+        [ -n "$uuid" ] || continue
+        name=$(echo "$name" | tr -d "'")
+
+        case "$kind" in
+            efi)
+                if ! with_partition_ro "$dev" partition_has_file "$loader" < /dev/null; then
+                    log "No $loader on $dev, skipping $name"
+                    continue
+                fi
+                cat >> "$script" << EOF
+menuentry '$name (on $dev)' --class windows --class os {
+	insmod part_gpt
+	insmod fat
+	search --no-floppy --fs-uuid --set=root $uuid
+	chainloader $loader
+}
+EOF
+                ;;
+            chain)
+                cat >> "$script" << EOF
+menuentry '$name (on $dev)' --class windows --class os {
+	insmod part_msdos
+	insmod ntfs
+	search --no-floppy --fs-uuid --set=root $uuid
+	chainloader +1
+}
+EOF
+                ;;
+            probe)
+                # name es el sistema de ficheros; la partición dice qué sistema lleva
+                local found os_kind os_file
+                local module=$(grub_fs_module "$name")
+                if ! found=$(with_partition_ro "$dev" describe_os_partition < /dev/null); then
+                    log "No bootable system found on $dev ($name)"
+                    continue
+                fi
+                IFS='|' read -r os_kind os_file name <<< "$found"
+                name=$(echo "$name" | tr -d "'")
+
+                if [ "$os_kind" = "linux" ]; then
+                    # Se carga el menú del propio sistema: sus núcleos y opciones al día
+                    cat >> "$script" << EOF
+menuentry '$name (on $dev)' --class gnu-linux --class os {
+	insmod part_gpt
+	insmod part_msdos
+	insmod $module
+	search --no-floppy --fs-uuid --set=root $uuid
+	configfile $os_file
+}
+EOF
+                else
+                    cat >> "$script" << EOF
+menuentry '$name (on $dev)' --class freebsd --class os {
+	insmod part_gpt
+	insmod part_msdos
+	insmod $module
+	search --no-floppy --fs-uuid --set=root $uuid
+	kfreebsd $os_file
+}
+EOF
+                fi
+                ;;
+            *)
+                continue
+                ;;
+        esac
+
+        log "Boot entry for other OS: $name on $dev"
+        count=$((count + 1))
+    done < "$OTHER_OS_LIST"
+
+    chmod 755 "$script"
+
+    # Con otros sistemas presentes, mostrar el menú aunque la imagen lo oculte
+    if [ $count -gt 0 ]; then
+        set_grub_default GRUB_TIMEOUT_STYLE menu
+    fi
+}
+
 install_bootloader() {
     local disk="$1"
     local efi_part="$2"
@@ -1198,16 +2178,48 @@ install_bootloader() {
             --target=x86_64-efi \
             --efi-directory=/boot/efi \
             --bootloader-id=LOC-OS \
+            "${GRUB_EFI_OPTS[@]}" \
             --recheck 2>&1 | tee -a "$LOG_FILE" || warn "GRUB install may have warnings"
+
+        # RAID: la EFI de cada disco restante, con su propia entrada de firmware
+        local n=2 esp
+        for esp in "${EFI_MIRRORS[@]}"; do
+            local dir="/boot/efi$n"
+            mkdir -p "$TARGET$dir"
+            if mount "$esp" "$TARGET$dir"; then
+                log "Installing GRUB for UEFI on $esp"
+                chroot "$TARGET" grub-install \
+                    --target=x86_64-efi \
+                    --efi-directory="$dir" \
+                    --bootloader-id="LOC-OS-$n" \
+                    --recheck 2>&1 | tee -a "$LOG_FILE" || warn "GRUB install on $esp may have warnings"
+                umount "$TARGET$dir" || warn "Could not unmount $esp"
+            else
+                warn "Could not mount $esp, that disk will not boot on its own"
+            fi
+            rmdir "$TARGET$dir" 2>/dev/null || true
+            n=$((n + 1))
+        done
     else
-        # BIOS
-        log "Installing GRUB for BIOS"
-        chroot "$TARGET" grub-install \
-            --target=i386-pc \
-            --recheck \
-            "$disk" 2>&1 | tee -a "$LOG_FILE" || warn "GRUB install may have warnings"
+        # BIOS: en RAID, en el MBR de cada disco para que arranque cualquiera
+        local members=("$disk")
+        if [ ${#RAID_DISKS[@]} -gt 0 ]; then
+            members=("${RAID_DISKS[@]}")
+        fi
+
+        local member
+        for member in "${members[@]}"; do
+            log "Installing GRUB for BIOS on $member"
+            chroot "$TARGET" grub-install \
+                --target=i386-pc \
+                --recheck \
+                "$member" 2>&1 | tee -a "$LOG_FILE" || warn "GRUB install may have warnings"
+        done
     fi
 
+    # Entradas de otros sistemas sin barrido de os-prober
+    configure_other_os_entries
+
     # Actualizar configuración GRUB
     log "Updating GRUB configuration"
     chroot "$TARGET" update-grub 2>&1 | tee -a "$LOG_FILE" || warn "GRUB update may have warnings"
@@ -1215,6 +2227,115 @@ install_bootloader() {
     log "Bootloader installed"
 }
 
+# ========== FUNCIONES DE INITRAMFS ==========
+
+# Kernels que realmente van a arrancar: los que tienen imagen en /boot del destino
+get_boot_kernels() {
+    local kernel
+    for kernel in "$TARGET"/boot/vmlinuz-*; do
+        [ -f "$kernel" ] || continue
+        local version="${kernel##*/vmlinuz-}"
+        # Sin módulos no se puede generar initramfs para ese kernel
+        if [ -d "$TARGET/lib/modules/$version" ]; then
+            echo "$version"
+        fi
+    done
+}
+
+configure_initramfs_compression() {
+    [ -d "$TARGET/etc/initramfs-tools" ] || return 0
+
+    if [ "$INITRAMFS_COMPRESS" = "zstd" ] && \
+       [ ! -x "$TARGET/usr/bin/zstd" ] && [ ! -x "$TARGET/bin/zstd" ]; then
+        warn "zstd not found in target, keeping default initramfs compression"
+        return 0
+    fi
+
+    mkdir -p "$TARGET/etc/initramfs-tools/conf.d"
+    cat > "$TARGET/etc/initramfs-tools/conf.d/loc-installer-compress" << EOF
+# Generated by LOC-OS Installer
+COMPRESS=$INITRAMFS_COMPRESS
+COMPRESSLEVEL=$INITRAMFS_COMPRESSLEVEL
+EOF
+}
+
+# Hash de todo lo que influye en el contenido del initramfs de un kernel
+initramfs_config_hash() {
+    local version="$1"
+
+    {
+        echo "$version"
+        echo "$INITRAMFS_COMPRESS $INITRAMFS_COMPRESSLEVEL"
+
+        # Solo punto de montaje y tipo: los UUID cambian en cada instalación
+        awk '$1 !~ /^#/ && NF >= 3 {print $2, $3}' "$TARGET/etc/fstab" 2>/dev/null
+
+        (
+            cd "$TARGET" || exit 0
+            find etc/initramfs-tools usr/share/initramfs-tools etc/modprobe.d \
+                 etc/mdadm etc/crypttab etc/default/keyboard etc/default/console-setup \
+                 var/lib/dpkg/status "lib/modules/$version/modules.dep" \
+                 -type f 2>/dev/null | sort | xargs -r -d '\n' sha256sum 2>/dev/null
+        )
+    } | sha256sum | cut -d' ' -f1
+}
+
+# Regenera el initramfs solo para los kernels que arrancan, reutilizando la caché
+update_initramfs_cached() {
+    local versions=$(get_boot_kernels)
+
+    if [ -z "$versions" ]; then
+        warn "No bootable kernels found in $TARGET/boot, skipping initramfs"
+        return 0
+    fi
+
+    configure_initramfs_compression
+
+    if ! mkdir -p "$INITRAMFS_CACHE_DIR" 2>/dev/null; then
+        warn "Initramfs cache $INITRAMFS_CACHE_DIR not available, building without cache"
+    fi
+
+    # zstd usa todos los núcleos aunque mkinitramfs no le pase -T0
+    local threads=$(nproc 2>/dev/null || echo 1)
+
+    for version in $versions; do
+        local image="$TARGET/boot/initrd.img-$version"
+        local key=$(initramfs_config_hash "$version")
+        local cached="$INITRAMFS_CACHE_DIR/initrd.img-$version-$key"
+
+        if [ -f "$cached" ]; then
+            log "Reusing cached initramfs for kernel $version"
+            if cp --reflink=auto "$cached" "$image.new" && mv -f "$image.new" "$image"; then
+                continue
+            fi
+            warn "Could not reuse cached initramfs, rebuilding"
+            rm -f "$image.new" 2>/dev/null || true
+        fi
+
+        # -u solo funciona si ya existe una imagen para ese kernel
+        local mode="-u"
+        [ -f "$image" ] || mode="-c"
+
+        log "Building initramfs for kernel $version"
+        # Sin pipefail el estado de la tubería es el de tee: se mira el de update-initramfs
+        ZSTD_NBTHREADS="$threads" chroot "$TARGET" update-initramfs $mode -k "$version" 2>&1 | tee -a "$LOG_FILE"
+        if [ "${PIPESTATUS[0]}" -ne 0 ]; then
+            # Una imagen fallida o a medias no debe acabar en la caché
+            warn "Initramfs update for $version failed, not caching it"
+            continue
+        fi
+
+        # Guardar en caché (reemplaza las entradas viejas de este kernel)
+        if [ -d "$INITRAMFS_CACHE_DIR" ] && [ -f "$image" ]; then
+            rm -f "$INITRAMFS_CACHE_DIR/initrd.img-$version-"* 2>/dev/null || true
+            # Temporal propio: en fan-out varios destinos guardan la misma entrada a la vez
+            if ! { cp "$image" "$cached.tmp.$BASHPID" && mv -f "$cached.tmp.$BASHPID" "$cached"; } 2>/dev/null; then
+                warn "Could not store initramfs for $version in cache"
+            fi
+        fi
+    done
+}
+
 # ========== FUNCIONES DE LIMPIEZA ==========
 cleanup_post_install() {
     log "Running post-install cleanup..."
@@ -1247,9 +2368,10 @@ cleanup_post_install() {
     # 4. Limpiar logs
     find "$TARGET/var/log" -name "*.log" -type f -exec truncate -s 0 {} \; 2>/dev/null || true
 
-    # 5. Regenerar initramfs (importante para arranque)
+    # 5. Ejecutar hooks aplazados y regenerar initramfs una sola vez
+    run_deferred_maintenance
     log "Updating initramfs..."
-    chroot "$TARGET" update-initramfs -u -k all 2>/dev/null || warn "Initramfs update may have warnings"
+    update_initramfs_cached
 
     # 6. Sincronizar
     sync
@@ -1281,7 +2403,7 @@ unmount_all() {
         fi
     done
 
-    sleep 1  # Pequeña pausa
+    wait_for_unmount 1 "${mount_points[@]}" || true
 
     # SEGUNDA RONDA: Intento forzado/lazy para lo que quedó
     for mp in "${mount_points[@]}"; do
@@ -1296,10 +2418,10 @@ unmount_all() {
     done
 
     # Reporte final
-    local still_mounted=$(mount | grep -c "$TARGET" 2>/dev/null || echo 0)
+    local still_mounted=$(mount | grep -cE " on $TARGET(/| )" 2>/dev/null || echo 0)
     if [ "$still_mounted" -gt 0 ]; then
         warn "$still_mounted mount(s) still active under $TARGET"
-        mount | grep "$TARGET" 2>&1 | tee -a "$LOG_FILE" || true
+        mount | grep -E " on $TARGET(/| )" 2>&1 | tee -a "$LOG_FILE" || true
     else
         log "All mounts cleaned up"
     fi
@@ -1307,7 +2429,260 @@ unmount_all() {
     log "Unmount completed (installation can continue regardless)"
 }
 
+# ========== INSTALACIÓN EN VARIOS DISCOS (FAN-OUT) ==========
+# La misma configuración en varios discos a la vez (--fanout-disks). Las etapas
+# por disco corren en paralelo, una por subshell, y cada etapa espera a todos
+# antes de pasar a la siguiente. El disco N se monta en $TARGET-N (el primero
+# en $TARGET). La copia la hace un único rsync, que lee el origen una sola vez:
+# su lote (--write-batch) pasa por un FIFO y tee lo reparte a un
+# rsync --read-batch por cada destino extra.
+FANOUT_DISKS=()
+FANOUT_TARGETS=()
+FANOUT_STATE_DIR=""
+FANOUT_INDEX=""
+FANOUT_HOSTNAME=""
+FANOUT_OPTS=()
+FANOUT_BATCH_DIR=""
+FANOUT_PIDS=()
+FANOUT_TEE_PID=""
+
+# Opciones extra del grub-install UEFI (fan-out: --removable, ver main_installation)
+GRUB_EFI_OPTS=()
+
+# Hostname del destino N: %n en el nombre se sustituye por N; si no hay %n se añade -N
+fanout_hostname() {
+    local base="$1" n="$2"
+    if [[ "$base" == *%n* ]]; then
+        echo "${base//%n/$n}"
+    else
+        echo "$base-$n"
+    fi
+}
+
+# Particiones del destino actual, para las etapas siguientes (cada una en su subshell)
+save_target_state() {
+    local var
+    for var in ROOT_PART HOME_PART BOOT_PART SWAP_PART EFI_PART; do
+        printf '%s=%q\n' "$var" "${!var}"
+    done > "$FANOUT_STATE_DIR/$FANOUT_INDEX"
+}
+
+# Disco, punto de montaje, hostname y particiones del destino N
+load_target_state() {
+    local n="$1"
+
+    FANOUT_INDEX="$n"
+    DISK="${FANOUT_DISKS[$((n - 1))]}"
+    if [ "$n" -gt 1 ]; then
+        TARGET="$TARGET-$n"
+    fi
+    HOSTNAME=$(fanout_hostname "$FANOUT_HOSTNAME" "$n")
+
+    if [ -f "$FANOUT_STATE_DIR/$n" ]; then
+        source "$FANOUT_STATE_DIR/$n"
+    fi
+}
+
+# Ejecuta una función en los destinos FIRST..LAST a la vez y espera a todos
+fanout_run() {
+    local first="$1" last="$2" func="$3"
+    shift 3
+
+    local n pids=() failed=""
+    for (( n = first; n <= last; n++ )); do
+        ( load_target_state "$n"; LOG_PREFIX="[$DISK] "; "$func" "$@" ) &
+        pids[$n]=$!
+    done
+
+    for n in "${!pids[@]}"; do
+        wait "${pids[$n]}" || failed="$failed ${FANOUT_DISKS[$((n - 1))]}"
+    done
+
+    [ -z "$failed" ] || error "$func failed on:$failed"
+}
+
+fanout_each() {
+    fanout_run 1 ${#FANOUT_DISKS[@]} "$@"
+}
+
+fanout_stage_partition() {
+    partition_disk "$DISK" "$UEFI_MODE" "$ADD_SWAP" "$SWAP_SIZE" "$SEP_HOME"
+    save_target_state
+}
+
+fanout_stage_mount() {
+    mount_partitions "$ROOT_PART" "$HOME_PART" "$BOOT_PART" "$EFI_PART"
+}
+
+fanout_stage_user() {
+    configure_user "$HOSTNAME" "$USERNAME" "$PASSWORD" "$AUTOLOGIN" "${ROOT_PASSWORD:-$PASSWORD}"
+}
+
+fanout_stage_bootloader() {
+    install_bootloader "$DISK" "$EFI_PART"
+}
+
+fanout_stage_report() {
+    write_stage_report "$TARGET$STAGE_REPORT"
+}
+
+# Antes de cada rsync de copy_system: lectores del lote para DIR en cada destino extra
+fanout_copy_begin() {
+    local dir="$1"
+
+    FANOUT_OPTS=()
+    [ ${#FANOUT_TARGETS[@]} -gt 0 ] || return 0
+
+    FANOUT_BATCH_DIR=$(mktemp -d /tmp/loc-fanout.XXXXXX)
+    mkfifo "$FANOUT_BATCH_DIR/batch"
+
+    # La reasignación de propietarios solo se aplica al home en vivo
+    local map=()
+    if [ "$dir" = "$LIVE_HOME" ]; then
+        map=("${OWNER_MAP_OPTS[@]}")
+    fi
+
+    local i fifos=()
+    FANOUT_PIDS=()
+    for i in "${!FANOUT_TARGETS[@]}"; do
+        mkfifo "$FANOUT_BATCH_DIR/in$i"
+        fifos+=("$FANOUT_BATCH_DIR/in$i")
+        rsync -a --read-batch=- --numeric-ids "${map[@]}" \
+            "${FANOUT_TARGETS[$i]}$dir/" < "$FANOUT_BATCH_DIR/in$i" \
+            > "$FANOUT_BATCH_DIR/read$i.log" 2>&1 &
+        FANOUT_PIDS+=("$!")
+    done
+
+    # tee -p: si un destino falla, los demás siguen recibiendo el lote
+    tee -p "${fifos[@]}" < "$FANOUT_BATCH_DIR/batch" > /dev/null &
+    FANOUT_TEE_PID=$!
+
+    FANOUT_OPTS=(--write-batch="$FANOUT_BATCH_DIR/batch")
+}
+
+# Después de cada rsync: espera a los lectores y copia desde el primer destino
+# a los que no pudieron aplicar el lote
+fanout_copy_end() {
+    local dir="$1"
+
+    [ -n "$FANOUT_BATCH_DIR" ] || return 0
+
+    # Si rsync no llegó a abrir el lote, tee sigue esperando un escritor: abrir y
+    # cerrar el FIFO le da fin de fichero (se repite por si tee aún no lo había abierto)
+    local fd
+    while kill -0 "$FANOUT_TEE_PID" 2>/dev/null; do
+        exec {fd}<>"$FANOUT_BATCH_DIR/batch"
+        exec {fd}>&-
+        sleep 0.2
+    done
+    wait "$FANOUT_TEE_PID" || true
+
+    local i
+    for i in "${!FANOUT_TARGETS[@]}"; do
+        local t="${FANOUT_TARGETS[$i]}"
+        local ok="true"
+        wait "${FANOUT_PIDS[$i]}" || ok="false"
+        cat "$FANOUT_BATCH_DIR/read$i.log" >> "$LOG_FILE" 2>/dev/null || true
+
+        if [ "$ok" = "false" ]; then
+            warn "Batch replay to $t$dir failed, copying from $TARGET$dir instead"
+            if ! rsync -aAXHx --numeric-ids \
+                    --filter='P lost+found' \
+                    --filter='H lost+found' \
+                    "$TARGET$dir/" "$t$dir/" >> "$LOG_FILE" 2>&1; then
+                error "Could not copy ${dir:-/} to $t"
+            fi
+        fi
+    done
+
+    rm -rf "$FANOUT_BATCH_DIR"
+    FANOUT_BATCH_DIR=""
+    FANOUT_OPTS=()
+}
+
+# Pasos 3 a 12 de main_installation para todos los discos de FANOUT_DISKS
+fanout_installation() {
+    local count=${#FANOUT_DISKS[@]}
+    local disk n
+
+    FANOUT_STATE_DIR=$(mktemp -d /tmp/loc-fanout-state.XXXXXX)
+
+    stage_begin partition 15 "Auto-partitioning $count disks..."
+    for disk in "${FANOUT_DISKS[@]}"; do
+        if ! force_unmount_disk "$disk"; then
+            error "Cannot proceed: disk $disk has partitions that could not be unmounted"
+        fi
+    done
+    settle_devices
+    fanout_each fanout_stage_partition
+
+    stage_begin mount 25 "Mounting partitions..."
+    fanout_each fanout_stage_mount
+
+    # La copia se hace desde aquí, con el primer disco como destino principal
+    load_target_state 1
+    FANOUT_TARGETS=()
+    for (( n = 2; n <= count; n++ )); do
+        FANOUT_TARGETS+=("$TARGET-$n")
+    done
+
+    stage_begin copy 30 "Copying system files to $count disks..."
+    copy_system "$USERNAME"
+    FANOUT_TARGETS=()
+
+    fanout_each begin_deferred_maintenance
+    MAINTENANCE_DEFERRED="true"
+
+    if [ "$CREATE_SWAPFILE" = "true" ] && [ "$SWAPFILE_SIZE" -gt 0 ]; then
+        stage_begin swapfile 45 "Creating swapfile..."
+        fanout_each create_swapfile "$SWAPFILE_SIZE"
+    fi
+
+    stage_begin locales 55 "Configuring locales..."
+    fanout_each configure_locales "$TIMEZONE" "$LANGUAGE" "$KEYBOARD" "${KEYBOARD_VARIANT:-}"
+
+    stage_begin fstab 65 "Creating fstab..."
+    fanout_each create_fstab
+
+    stage_begin user 75 "Configuring user..."
+    fanout_each fanout_stage_user
+
+    stage_begin bootloader 85 "Installing bootloader..."
+    fanout_each fanout_stage_bootloader
+
+    # El primer disco llena la caché de initramfs; los demás, con la misma
+    # configuración, la reutilizan en lugar de generar cada uno la suya
+    stage_begin cleanup 90 "Performing post-installation cleanup..."
+    fanout_run 1 1 cleanup_post_install
+    fanout_run 2 "$count" cleanup_post_install
+    MAINTENANCE_DEFERRED="false"
+
+    # El informe de cada disco lleva las mismas etapas, cerradas aquí una sola vez
+    stage_end
+    fanout_each fanout_stage_report
+
+    stage_begin unmount 95 "Unmounting partitions..."
+    fanout_each unmount_all
+
+    rm -rf "$FANOUT_STATE_DIR"
+}
+
 # ========== FUNCIÓN PRINCIPAL ==========
+# SIGTERM/SIGINT (cancelación): deja el sistema en vivo como estaba y suelta los discos
+installation_interrupted() {
+    trap '' INT TERM
+    log "Installation interrupted"
+    restore_deferred_tools
+    stop_rss_sampler
+
+    local n
+    for (( n = 2; n <= ${#FANOUT_DISKS[@]}; n++ )); do
+        ( TARGET="$TARGET-$n"; unmount_all ) || true
+    done
+    unmount_all || true
+    exit 1
+}
+
 main_installation() {
     # Variables
     local DISK="" USERNAME="" HOSTNAME="" PASSWORD=""
@@ -1316,6 +2691,10 @@ main_installation() {
     local AUTO_PARTITION="true" UEFI_MODE="auto"
     local ADD_SWAP="false" SWAP_SIZE="2048"
     local CREATE_SWAPFILE="false" SWAPFILE_SIZE="2048"
+    local OS_PROBER="auto" OTHER_OS_LIST=""
+    local RAID_LEVEL="" RAID_EXTRA_DISKS=""
+    local FANOUT_EXTRA_DISKS=""
+    local EVENT_FIFO=""
 
     # Parsear argumentos
     while [[ $# -gt 0 ]]; do
@@ -1366,6 +2745,30 @@ main_installation() {
             --swapfile-size=*) SWAPFILE_SIZE="${1#*=}"; shift ;;
             --swapfile-size) SWAPFILE_SIZE="$2"; shift 2 ;;
 
+            # Bootloader: otros sistemas ya detectados por el instalador, o desactivar os-prober
+            --os-prober=*) OS_PROBER="${1#*=}"; shift ;;
+            --os-prober) OS_PROBER="$2"; shift 2 ;;
+            --other-os=*) OTHER_OS_LIST="${1#*=}"; shift ;;
+            --other-os) OTHER_OS_LIST="$2"; shift 2 ;;
+
+            # Sistema de ficheros de raíz y /home (solo particionado automático)
+            --root-fs=*) ROOT_FS="${1#*=}"; shift ;;
+            --root-fs) ROOT_FS="$2"; shift 2 ;;
+
+            # RAID por software: --disk es el primer miembro, el resto separados por comas
+            --raid-level=*) RAID_LEVEL="${1#*=}"; shift ;;
+            --raid-level) RAID_LEVEL="$2"; shift 2 ;;
+            --raid-disks=*) RAID_EXTRA_DISKS="${1#*=}"; shift ;;
+            --raid-disks) RAID_EXTRA_DISKS="$2"; shift 2 ;;
+
+            # Misma instalación en otros discos a la vez, separados por comas
+            --fanout-disks=*) FANOUT_EXTRA_DISKS="${1#*=}"; shift ;;
+            --fanout-disks) FANOUT_EXTRA_DISKS="$2"; shift 2 ;;
+
+            # Canal de eventos para la GUI
+            --event-fifo=*) EVENT_FIFO="${1#*=}"; shift ;;
+            --event-fifo) EVENT_FIFO="$2"; shift 2 ;;
+
             # Manual partitions
             --root-part=*) ROOT_PART="${1#*=}"; shift ;;
             --root-part) ROOT_PART="$2"; shift 2 ;;
@@ -1382,6 +2785,9 @@ main_installation() {
         esac
     done
 
+    # Abrir el canal de eventos antes de cualquier validación (los errores también son eventos)
+    open_event_channel "$EVENT_FIFO"
+
     # Validar parámetros requeridos SIEMPRE necesarios
     [ -z "$USERNAME" ] && error "Username not specified (--username)"
     [ -z "$HOSTNAME" ] && error "Hostname not specified (--hostname)"
@@ -1399,6 +2805,53 @@ main_installation() {
         [ -z "$ROOT_PART" ] && error "Root partition not specified (--root-part) - required for manual partitioning"
     fi
 
+    case "$ROOT_FS" in
+        ext4|btrfs|xfs|f2fs) ;;
+        *) error "Unsupported root filesystem: $ROOT_FS (use ext4, btrfs, xfs or f2fs)" ;;
+    esac
+
+    if [ -n "$RAID_LEVEL" ]; then
+        [ "$AUTO_PARTITION" = "true" ] || error "RAID layouts require automatic partitioning"
+        case "$RAID_LEVEL" in
+            0|1) ;;
+            *) error "Unsupported RAID level: $RAID_LEVEL (use 0 or 1)" ;;
+        esac
+        command -v mdadm >/dev/null 2>&1 || error "Required tool not found: mdadm"
+        # El sistema instalado es una copia de SOURCE_ROOT: sin mdadm en él, su
+        # initramfs no podría montar la raíz en md. Se comprueba antes de borrar nada.
+        if [ ! -x "${SOURCE_ROOT%/}/sbin/mdadm" ] && [ ! -x "${SOURCE_ROOT%/}/usr/sbin/mdadm" ]; then
+            error "mdadm is not part of the system being installed, it could not boot from RAID"
+        fi
+
+        local extra
+        RAID_DISKS=("$DISK")
+        IFS=',' read -ra extra <<< "$RAID_EXTRA_DISKS"
+        for disk in "${extra[@]}"; do
+            [ -n "$disk" ] && [ "$disk" != "$DISK" ] && RAID_DISKS+=("$disk")
+        done
+        [ ${#RAID_DISKS[@]} -ge 2 ] || error "RAID$RAID_LEVEL needs at least two disks (--raid-disks)"
+    fi
+
+    if [ -n "$FANOUT_EXTRA_DISKS" ]; then
+        [ "$AUTO_PARTITION" = "true" ] || error "Installing to several disks requires automatic partitioning"
+        [ -z "$RAID_LEVEL" ] || error "--fanout-disks cannot be combined with a RAID layout"
+
+        local extra
+        FANOUT_DISKS=("$DISK")
+        IFS=',' read -ra extra <<< "$FANOUT_EXTRA_DISKS"
+        for disk in "${extra[@]}"; do
+            [ -n "$disk" ] && [ "$disk" != "$DISK" ] && FANOUT_DISKS+=("$disk")
+        done
+        [ ${#FANOUT_DISKS[@]} -ge 2 ] || error "--fanout-disks needs at least one disk besides --disk"
+
+        # Cada disco acabará en otra máquina: sin entradas de los sistemas de esta,
+        # GRUB en la ruta EFI por defecto y sin tocar la NVRAM de esta placa
+        FANOUT_HOSTNAME="$HOSTNAME"
+        OS_PROBER="false"
+        OTHER_OS_LIST=""
+        GRUB_EFI_OPTS=(--removable --no-nvram)
+    fi
+
     # Valores por defecto
     : ${AUTOLOGIN:=true}
     : ${SEP_HOME:=false}
@@ -1413,6 +2866,8 @@ main_installation() {
     log "=== Starting LOC-OS Installation ==="
     log "Installation mode: $([ "$AUTO_PARTITION" = "true" ] && echo "Automatic" || echo "Manual")"
     [ -n "$DISK" ] && log "Disk: $DISK"
+    [ ${#RAID_DISKS[@]} -gt 0 ] && log "RAID$RAID_LEVEL across: ${RAID_DISKS[*]}"
+    [ ${#FANOUT_DISKS[@]} -gt 0 ] && log "Same installation on: ${FANOUT_DISKS[*]}"
     [ "$AUTO_PARTITION" = "false" ] && log "Root partition: $ROOT_PART"
     log "Username: $USERNAME"
     log "Hostname: $HOSTNAME"
@@ -1420,31 +2875,54 @@ main_installation() {
     log "Language: $LANGUAGE"
     log "Keyboard: $KEYBOARD"
     log "Autologin: $AUTOLOGIN"
+    [ "$AUTO_PARTITION" = "true" ] && log "Root filesystem: $ROOT_FS"
     log "Separate /home: $SEP_HOME"
     log "Separate /boot: $SEP_BOOT"
     log "Add swap partition: $ADD_SWAP (${SWAP_SIZE}MB)"
     log "Create swapfile: $CREATE_SWAPFILE (${SWAPFILE_SIZE}MB)"
 
     # Registrar cleanup para ejecutar al final
-    trap 'log "Installation interrupted"; exit 1' INT TERM
+    INSTALLER_PID=$BASHPID
+    trap installation_interrupted INT TERM
 
     # Total de pasos (puedes ajustar según tu instalador real)
     TOTAL_STEPS=13
 
+    emit_plan
+
     # Paso 1: Verificar requisitos
-    echo "PROGRESS:5:Checking system requirements..."
+    stage_begin check 5 "Checking system requirements..."
     check_requirements
 
     # Paso 2: Detectar modo boot
-    echo "PROGRESS:10:Detecting boot mode..."
+    stage_begin bootmode 10 "Detecting boot mode..."
     if [ "$UEFI_MODE" = "auto" ]; then
         UEFI_MODE=$(detect_boot_mode)
         log "Detected boot mode: $UEFI_MODE"
     fi
 
+    # Pasos 3 a 12 en todos los discos a la vez
+    if [ ${#FANOUT_DISKS[@]} -gt 0 ]; then
+        fanout_installation
+        finish_installation
+        return 0
+    fi
+
     # Paso 3: Particionado
-    if [ "$AUTO_PARTITION" = "true" ]; then
-        echo "PROGRESS:15:Auto-partitioning disk $DISK..."
+    if [ ${#RAID_DISKS[@]} -gt 0 ]; then
+        stage_begin partition 15 "Building RAID$RAID_LEVEL across ${RAID_DISKS[*]}..."
+
+        for disk in "${RAID_DISKS[@]}"; do
+            if ! force_unmount_disk "$disk"; then
+                error "Cannot proceed: disk $disk has partitions that could not be unmounted"
+            fi
+        done
+
+        settle_devices
+
+        partition_raid "$RAID_LEVEL" "$UEFI_MODE" "$ADD_SWAP" "$SWAP_SIZE" "$SEP_HOME" "${RAID_DISKS[@]}"
+    elif [ "$AUTO_PARTITION" = "true" ]; then
+        stage_begin partition 15 "Auto-partitioning disk $DISK..."
         log "Auto-partitioning disk $DISK"
 
         # Forzar desmontaje antes de particionar
@@ -1452,12 +2930,12 @@ main_installation() {
             error "Cannot proceed: disk $DISK has partitions that could not be unmounted"
         fi
 
-        sleep 2
+        settle_devices
 
         # Particionar (actualizar función para soportar /boot separado)
-        partition_disk "$DISK" "$UEFI_MODE" "$ADD_SWAP" "$SWAP_SIZE"
+        partition_disk "$DISK" "$UEFI_MODE" "$ADD_SWAP" "$SWAP_SIZE" "$SEP_HOME"
     else
-        echo "PROGRESS:15:Using manual partitions..."
+        stage_begin partition 15 "Using manual partitions..."
         log "Using manual partitions"
 
         # Verificar particiones manuales existen
@@ -1475,57 +2953,91 @@ main_installation() {
     fi
 
     # Paso 4: Montar particiones
-    echo "PROGRESS:25:Mounting partitions..."
+    stage_begin mount 25 "Mounting partitions..."
     mount_partitions "$ROOT_PART" "$HOME_PART" "$BOOT_PART" "$EFI_PART"
 
     # Paso 5: Copiar sistema
-    echo "PROGRESS:30:Copying system files..."
+    stage_begin copy 30 "Copying system files..."
     copy_system "$USERNAME"
 
+    # Aplazar hooks de paquetes (initramfs, setupcon, servicios) hasta la limpieza final
+    begin_deferred_maintenance
+
     # Paso 6: Crear swapfile si se solicitó
     if [ "$CREATE_SWAPFILE" = "true" ] && [ "$SWAPFILE_SIZE" -gt 0 ]; then
-        echo "PROGRESS:45:Creating swapfile..."
+        stage_begin swapfile 45 "Creating swapfile..."
         create_swapfile "$SWAPFILE_SIZE"
     fi
 
     # Paso 7: Configurar locales
-    echo "PROGRESS:55:Configuring locales..."
+    stage_begin locales 55 "Configuring locales..."
     configure_locales "$TIMEZONE" "$LANGUAGE" "$KEYBOARD" "${KEYBOARD_VARIANT:-}"
 
     # Paso 8: Crear fstab
-    echo "PROGRESS:65:Creating fstab..."
+    stage_begin fstab 65 "Creating fstab..."
     create_fstab
+    if [ ${#RAID_DISKS[@]} -gt 0 ]; then
+        write_mdadm_config
+    fi
 
     # Paso 9: Configurar usuario
-    echo "PROGRESS:75:Configuring user..."
+    stage_begin user 75 "Configuring user..."
     configure_user "$HOSTNAME" "$USERNAME" "$PASSWORD" "$AUTOLOGIN" "${ROOT_PASSWORD:-$PASSWORD}"
 
     # Paso 10: Instalar bootloader
-    echo "PROGRESS:85:Installing bootloader..."
+    stage_begin bootloader 85 "Installing bootloader..."
     install_bootloader "$DISK" "$EFI_PART"
 
     # Paso 11: Limpieza post-instalación
-    echo "PROGRESS:90:Performing post-installation cleanup..."
+    stage_begin cleanup 90 "Performing post-installation cleanup..."
     cleanup_post_install
 
+    # Informe por etapas en el sistema instalado, antes de desmontarlo
+    write_stage_report "$TARGET$STAGE_REPORT"
+
     # Paso 12: Desmontar todo
-    echo "PROGRESS:95:Unmounting partitions..."
+    stage_begin unmount 95 "Unmounting partitions..."
     unmount_all
 
+    finish_installation
+}
+
+# Cierre común a la instalación en un disco y en varios
+finish_installation() {
     # Paso 13: Limpiar archivos temporales
     rm -f "$RSYNC_EXCLUDES" 2>/dev/null || true
 
-    echo "PROGRESS:100:Installation complete!"
+    stage_begin done 100 "Installation complete!"
+    stop_rss_sampler
     log "=== Installation completed successfully ==="
-    echo "SUCCESS: LOC-OS has been installed"
+    emit done "msg=LOC-OS has been installed"
     echo "You can now reboot and remove the installation media."
 }
 
 # ========== PUNTO DE ENTRADA ==========
+# Cargado con source (bench/run-bench.sh): solo se definen las funciones
+if [ "${BASH_SOURCE[0]}" != "$0" ]; then
+    return 0
+fi
+
+# La instalación corre en segundo plano y aquí solo se espera: bash no atiende un
+# trap hasta que acaba la orden en primer plano (un rsync o un mkfs duran minutos),
+# pero wait sí se interrumpe. El GUI solo puede señalar a sudo, que reenvía
+# SIGTERM a este proceso; desde aquí llega a todo el grupo, hijos incluidos.
+forward_interrupt() {
+    trap '' INT TERM
+    kill -TERM 0 2>/dev/null || true
+    wait "$MAIN_PID" 2>/dev/null || true
+    exit 1
+}
+
 case "${1:-install}" in
     "install")
         shift
-        main_installation "$@"
+        trap forward_interrupt INT TERM
+        main_installation "$@" &
+        MAIN_PID=$!
+        wait "$MAIN_PID"
         ;;
     "help"|"--help"|"-h")
         cat << EOF
@@ -1548,6 +3060,15 @@ Optional options:
   --auto-partition=BOOL  Auto partition disk (true/false, default: true)
   --add-swap=BOOL        Add swap partition (true/false, default: false)
   --swap-size=MB         Swap size in MB when add-swap=true (default: 2048)
+  --root-fs=FS           Filesystem for / and /home in auto mode: ext4, btrfs, xfs, f2fs
+                         (btrfs and f2fs compress with zstd; default: ext4)
+  --raid-level=0|1       Software RAID across --disk and --raid-disks (0: striped, 1: mirrored)
+  --raid-disks=LIST      Additional RAID member disks, comma-separated
+  --fanout-disks=LIST    Install the same system to these disks too, comma-separated
+                         (%n in --hostname becomes the disk number, otherwise -N is appended)
+  --os-prober=BOOL       Run os-prober in update-grub (default: auto)
+  --other-os=FILE        Precomputed list of other systems for the boot menu
+  --event-fifo=PATH      Write protocol events (LOC1) to this FIFO instead of stdout
 
 Manual partition options (when auto-partition=false):
   --root-part=DEV        Root partition (required)
@@ -1567,6 +3088,21 @@ Examples:
     --language=es_ES --keyboard=es \
     --add-swap=true --sep-home=true
 
+  # Compressed btrfs root on an eMMC
+  $0 install --disk=/dev/mmcblk0 --root-fs=btrfs --username=john --hostname=mypc \
+    --password=secret --timezone=Europe/Madrid \
+    --language=es_ES --keyboard=es
+
+  # Mirrored root across two NVMe drives
+  $0 install --disk=/dev/nvme0n1 --raid-level=1 --raid-disks=/dev/nvme1n1 \
+    --username=john --hostname=mypc --password=secret \
+    --timezone=UTC --language=en_US --keyboard=us
+
+  # Image three drives at once (hosts lab-1, lab-2, lab-3)
+  $0 install --disk=/dev/sdb --fanout-disks=/dev/sdc,/dev/sdd \
+    --username=john --hostname=lab-%n --password=secret \
+    --timezone=UTC --language=en_US --keyboard=us
+
   # Manual partitions
   $0 install --disk=/dev/sda --auto-partition=false \
     --root-part=/dev/sda1 --swap-part=/dev/sda2 --home-part=/dev/sda3 \
@@ -188,6 +188,60 @@ get_partitions() {
     fi
 }
 
+# Otros sistemas arrancables, sin montar nada (solo metadatos de lsblk).
+# Formato: tipo|dispositivo|nombre[|cargador]
+#   efi   - cargador EFI en la ESP indicada (el instalador comprueba que exista)
+#   chain - sector de arranque de la partición (BIOS)
+#   probe - posible Linux/BSD (nombre: sistema de ficheros); sin montar no se sabe
+#           si lleva un sistema: el instalador lo comprueba antes de añadirlo
+# $1: discos o particiones que se van a usar (no se listan), separados por comas
+get_other_os() {
+    local exclude="$1"
+    local uefi=0
+    [ -d /sys/firmware/efi ] && uefi=1
+
+    command -v lsblk &> /dev/null || return 0
+
+    lsblk -Pnpo NAME,PKNAME,TYPE,FSTYPE,PARTTYPE,PARTFLAGS 2>/dev/null | \
+    awk -v exclude="$exclude" -v uefi="$uefi" '
+        BEGIN {
+            n = split(exclude, ex, ",")
+            for (i = 1; i <= n; i++) excluded[ex[i]] = 1
+        }
+        {
+            for (i = 1; i <= NF; i++) {
+                split($i, kv, "=")
+                v = substr($i, length(kv[1]) + 2)
+                gsub(/"/, "", v)
+                f[kv[1]] = v
+            }
+            if (f["TYPE"] != "part" || (f["PKNAME"] in excluded) || (f["NAME"] in excluded)) next
+
+            disk = f["PKNAME"]
+            ptype = tolower(f["PARTTYPE"])
+            if (ptype == "c12a7328-f81f-11d2-ba4b-00a0c93ec93b" || ptype == "0xef") {
+                if (!(disk in esp)) esp[disk] = f["NAME"]
+            }
+            if (f["FSTYPE"] == "ntfs") {
+                ntfs[disk] = 1
+                if (f["PARTFLAGS"] == "0x80" && !(disk in bootable)) bootable[disk] = f["NAME"]
+            }
+            if (f["FSTYPE"] ~ /^(ext[234]|btrfs|xfs|f2fs|jfs|reiserfs|ufs|zfs_member)$/) {
+                print "probe|" f["NAME"] "|" f["FSTYPE"]
+            }
+        }
+        END {
+            for (disk in ntfs) {
+                if (uefi == 1 && (disk in esp)) {
+                    print "efi|" esp[disk] "|Windows Boot Manager|/EFI/Microsoft/Boot/bootmgfw.efi"
+                } else if (uefi == 0 && (disk in bootable)) {
+                    print "chain|" bootable[disk] "|Windows"
+                }
+            }
+        }
+    '
+}
+
 get_current_timezone() {
     if [ -f "/etc/timezone" ]; then
         cat /etc/timezone
@@ -251,6 +305,9 @@ case "$MODE" in
     "partitions")
         get_partitions
         ;;
+    "other-os")
+        get_other_os "$2"
+        ;;
     "list")
         echo "=== Timezones ==="
         get_timezones
@@ -278,7 +335,7 @@ case "$MODE" in
         echo "Partitions: $(get_partitions | wc -l)"
         ;;
     *)
-        echo "Usage: $0 {env|list|test|timezones|keyboards|variants|languages|disks|partitions}"
+        echo "Usage: $0 {env|list|test|timezones|keyboards|variants|languages|disks|partitions|other-os}"
         echo "  env        - Output as environment variables"
         echo "  list       - Output lists for installer (default)"
         echo "  test       - Test and show counts"
@@ -288,6 +345,7 @@ case "$MODE" in
         echo "  languages  - Output only languages"
         echo "  disks      - Output only disks"
         echo "  partitions      - Output only partitions"
+        echo "  other-os   - Output other bootable systems (optional disks to exclude, comma-separated)"
         exit 1
         ;;
 esac
@@ -0,0 +1,312 @@
+/*
+ * simulator.c - Simulated backend for LOC-OS 24 Installer
+ *
+ * Sustituye a core-installer.sh (loc-installer --simulate) sin tocar ningún
+ * dispositivo de bloques: reproduce una salida grabada o genera eventos LOC1
+ * y líneas de log al ritmo pedido, por los mismos canales (stdout y el FIFO
+ * de --event-fifo) que lee run_installation_thread(). Sirve para medir el
+ * coste de pintar el log, el de las actualizaciones de progreso y la latencia
+ * del bucle principal con cargas que una instalación real no produce.
+ *
+ * Uso:
+ *   loc-installer-sim [install] [--event-fifo=PATH] [opciones del instalador]
+ *
+ * Las opciones del instalador se aceptan y se ignoran. El comportamiento se
+ * elige con variables de entorno, que se heredan a través de loc-installer:
+ *   LOC_SIM_REPLAY=FICHERO      reproducir una salida grabada: la de
+ *                               "core-installer.sh install ... > FICHERO" (sin
+ *                               --event-fifo los eventos van mezclados con el
+ *                               log) o un events.log del benchmark
+ *   LOC_SIM_SPEED=N             multiplicador del ritmo original al
+ *                               reproducir; 0 = sin esperas (1)
+ *   LOC_SIM_DURATION_MS=N       duración de la instalación sintética (20000)
+ *   LOC_SIM_LINES_PER_SEC=N     líneas de log por segundo (1000)
+ *   LOC_SIM_COPY_INTERVAL_US=N  intervalo entre eventos de progreso de la
+ *                               copia, como el --info=progress2 de rsync (100000)
+ *   LOC_SIM_COPY_BYTES=N        bytes que "copia" la etapa copy (8 GiB)
+ *   LOC_SIM_FAIL=ETAPA          terminar con error al empezar esa etapa
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#define TICK_US         1000        /* como mucho, una tanda de líneas por milisegundo */
+#define STREAM_BUFFER   (64 * 1024)
+
+/* Etapas de core-installer.sh y su peso en la duración total */
+static const struct {
+    const char *id;
+    const char *msg;
+    int weight;
+} sim_stages[] = {
+    { "check",      "Checking system requirements...",  1 },
+    { "bootmode",   "Detecting boot mode...",           1 },
+    { "partition",  "Partitioning disk...",             4 },
+    { "mount",      "Mounting partitions...",           2 },
+    { "copy",       "Copying system files...",          60 },
+    { "locales",    "Configuring locales...",           6 },
+    { "fstab",      "Generating fstab...",              1 },
+    { "user",       "Configuring user...",              2 },
+    { "bootloader", "Installing bootloader...",         8 },
+    { "cleanup",    "Cleaning up live system...",       12 },
+    { "unmount",    "Unmounting partitions...",         3 },
+};
+
+#define SIM_STAGE_COUNT ((int) (sizeof(sim_stages) / sizeof(sim_stages[0])))
+
+static FILE *event_out;
+
+/* ==================== HELPERS ==================== */
+
+static void die(const char *fmt, const char *arg) {
+    fprintf(stderr, "loc-installer-sim: ");
+    fprintf(stderr, fmt, arg);
+    fprintf(stderr, "\n");
+    exit(EXIT_FAILURE);
+}
+
+static long long env_number(const char *name, long long fallback) {
+    const char *value = getenv(name);
+    if (!value || !*value) return fallback;
+
+    char *end;
+    errno = 0;
+    long long n = strtoll(value, &end, 10);
+    if (errno != 0 || *end != '\0' || n < 0) die("invalid %s", name);
+    return n;
+}
+
+static long long monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static long long realtime_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (long long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void sleep_until_us(long long deadline) {
+    struct timespec ts = {
+        .tv_sec = deadline / 1000000,
+        .tv_nsec = (deadline % 1000000) * 1000,
+    };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+    }
+}
+
+static long long cpu_ms(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000LL +
+           (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1000;
+}
+
+static long rss_kb(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss;
+}
+
+/* Lo escrito tiene que llegar a la GUI antes de cada espera */
+static void flush_streams(void) {
+    fflush(stdout);
+    if (event_out != stdout) fflush(event_out);
+}
+
+static void open_event_channel(const char *fifo) {
+    event_out = stdout;
+    if (!fifo) return;
+
+    // La GUI ya tiene el FIFO abierto en lectura/escritura: esto no bloquea
+    int fd = open(fifo, O_WRONLY | O_CLOEXEC);
+    if (fd < 0) die("cannot open event FIFO %s", fifo);
+    event_out = fdopen(fd, "w");
+    if (!event_out) die("cannot open event FIFO %s", fifo);
+    setvbuf(event_out, NULL, _IOFBF, STREAM_BUFFER);
+}
+
+/* ==================== REPLAY ==================== */
+
+/* Reproduce la salida grabada respetando el intervalo entre eventos (dividido
+ * por speed). Las líneas LOC1 van al canal de eventos; el resto, a stdout. */
+static int replay(const char *path, long long speed) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) die("cannot open %s", path);
+
+    char *line = NULL;
+    size_t cap = 0;
+    long long first_ts = -1;
+    long long start_us = monotonic_us();
+    bool failed = false;
+
+    while (getline(&line, &cap, fp) > 0) {
+        if (strncmp(line, "LOC1 ", 5) != 0) {
+            fputs(line, stdout);
+            continue;
+        }
+
+        long long ts = strtoll(line + 5, NULL, 10);
+        if (speed > 0 && ts > 0) {
+            if (first_ts < 0) first_ts = ts;
+            long long due = start_us + (ts - first_ts) * 1000 / speed;
+            if (due > monotonic_us()) {
+                flush_streams();
+                sleep_until_us(due);
+            }
+        }
+
+        if (strstr(line, " error ") != NULL) failed = true;
+        fputs(line, event_out);
+    }
+
+    free(line);
+    fclose(fp);
+    flush_streams();
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* ==================== SYNTHETIC INSTALL ==================== */
+
+typedef struct {
+    long long duration_ms;
+    long long lines_per_sec;
+    long long copy_interval_us;
+    long long copy_bytes;
+    const char *fail_stage;
+    long long line_no;
+} SimConfig;
+
+static void emit_plan(const SimConfig *cfg) {
+    fprintf(event_out, "LOC1 %lld plan stages=", realtime_ms());
+    for (int i = 0; i < SIM_STAGE_COUNT; i++) {
+        fprintf(event_out, "%s%s", i > 0 ? "," : "", sim_stages[i].id);
+    }
+    fprintf(event_out, " copy_bytes=%lld disk_class=ssd\n", cfg->copy_bytes);
+}
+
+/* Una línea de log como las que produce cada etapa: nombres de fichero en la
+ * copia (rsync -v) y trazas de comandos en el resto */
+static void emit_log_line(SimConfig *cfg, const char *stage) {
+    long long n = cfg->line_no++;
+    if (strcmp(stage, "copy") == 0) {
+        printf("usr/share/doc/pkg%lld/file%lld\n", n % 200, n);
+    } else {
+        printf("[%s] simulated output line %lld\n", stage, n);
+    }
+}
+
+static void emit_copy_progress(const SimConfig *cfg, long long elapsed_us, long long stage_us) {
+    int pct = stage_us > 0 ? (int) (elapsed_us * 100 / stage_us) : 100;
+    if (pct > 100) pct = 100;
+
+    long long bytes = cfg->copy_bytes * pct / 100;
+    long long rate = elapsed_us > 0 ? bytes * 1000000 / elapsed_us : 0;
+    long long files_total = cfg->copy_bytes / (64 * 1024);
+    long eta = (long) ((stage_us - elapsed_us) / 1000000);
+
+    fprintf(event_out, "LOC1 %lld copy stage=copy pct=%d bytes=%lld files=%lld files_total=%lld rate=%lld eta=%ld\n",
+            realtime_ms(), pct, bytes, files_total * pct / 100, files_total, rate, eta < 0 ? 0 : eta);
+}
+
+static void run_stage(SimConfig *cfg, int index) {
+    const char *id = sim_stages[index].id;
+    long long stage_us = cfg->duration_ms * 1000 * sim_stages[index].weight / 100;
+    bool is_copy = strcmp(id, "copy") == 0;
+
+    long long start = monotonic_us();
+    long long cpu_start = cpu_ms();
+    long long lines_done = 0;
+    long long next_copy = start;
+
+    for (;;) {
+        long long now = monotonic_us();
+        long long elapsed = now - start;
+        if (elapsed > stage_us) elapsed = stage_us;
+
+        // Las líneas que tocan hasta ahora, de una vez
+        long long lines_due = elapsed * cfg->lines_per_sec / 1000000;
+        for (; lines_done < lines_due; lines_done++) emit_log_line(cfg, id);
+
+        if (is_copy && (now >= next_copy || elapsed >= stage_us)) {
+            emit_copy_progress(cfg, elapsed, stage_us);
+            next_copy += cfg->copy_interval_us;
+            if (next_copy < now) next_copy = now + cfg->copy_interval_us;
+        }
+
+        flush_streams();
+        if (elapsed >= stage_us) break;
+
+        long long wake = now + TICK_US;
+        if (is_copy && next_copy < wake) wake = next_copy;
+        if (start + stage_us < wake) wake = start + stage_us;
+        sleep_until_us(wake);
+    }
+
+    fprintf(event_out, "LOC1 %lld stage_end stage=%s wall_ms=%lld cpu_ms=%lld read_bytes=0 write_bytes=%lld rss_kb=%ld\n",
+            realtime_ms(), id, (monotonic_us() - start) / 1000, cpu_ms() - cpu_start,
+            is_copy ? cfg->copy_bytes : 0LL, rss_kb());
+}
+
+static int synthesize(SimConfig *cfg) {
+    emit_plan(cfg);
+
+    int pct = 0;
+    for (int i = 0; i < SIM_STAGE_COUNT; i++) {
+        const char *id = sim_stages[i].id;
+        fprintf(event_out, "LOC1 %lld stage stage=%s pct=%d msg=%s\n",
+                realtime_ms(), id, pct, sim_stages[i].msg);
+
+        if (cfg->fail_stage && strcmp(cfg->fail_stage, id) == 0) {
+            fprintf(event_out, "LOC1 %lld error stage=%s msg=Simulated failure in stage %s\n",
+                    realtime_ms(), id, id);
+            flush_streams();
+            return EXIT_FAILURE;
+        }
+
+        run_stage(cfg, i);
+        pct += sim_stages[i].weight;
+    }
+
+    fprintf(event_out, "LOC1 %lld done msg=LOC-OS has been installed (simulation)\n", realtime_ms());
+    flush_streams();
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+    const char *fifo = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--event-fifo=", 13) == 0) {
+            fifo = argv[i] + 13;
+        }
+    }
+
+    setvbuf(stdout, NULL, _IOFBF, STREAM_BUFFER);
+    open_event_channel(fifo);
+
+    const char *replay_path = getenv("LOC_SIM_REPLAY");
+    if (replay_path && *replay_path) {
+        return replay(replay_path, env_number("LOC_SIM_SPEED", 1));
+    }
+
+    SimConfig cfg = {
+        .duration_ms = env_number("LOC_SIM_DURATION_MS", 20000),
+        .lines_per_sec = env_number("LOC_SIM_LINES_PER_SEC", 1000),
+        .copy_interval_us = env_number("LOC_SIM_COPY_INTERVAL_US", 100000),
+        .copy_bytes = env_number("LOC_SIM_COPY_BYTES", 8LL * 1024 * 1024 * 1024),
+        .fail_stage = getenv("LOC_SIM_FAIL"),
+    };
+    if (cfg.copy_interval_us == 0) cfg.copy_interval_us = 1;
+
+    return synthesize(&cfg);
+}
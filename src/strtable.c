@@ -0,0 +1,233 @@
+/*
+ * strtable.c - Arena-backed string table for LOC-OS 24 Installer (sin dependencias de GTK)
+ */
+
+#define _GNU_SOURCE
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "strtable.h"
+
+#define INITIAL_ARENA       4096
+#define INITIAL_ENTRIES     64
+#define INITIAL_INDEX       128
+
+/* ==================== ARENA ==================== */
+
+static bool reserve_arena(StrTable *t, size_t extra) {
+    if (t->arena_len + extra <= t->arena_cap) return true;
+
+    size_t cap = t->arena_cap ? t->arena_cap : INITIAL_ARENA;
+    while (cap < t->arena_len + extra) cap *= 2;
+
+    char *arena = realloc(t->arena, cap);
+    if (!arena) return false;
+    t->arena = arena;
+    t->arena_cap = cap;
+    return true;
+}
+
+static bool reserve_entry(StrTable *t) {
+    if (t->count < t->capacity) return true;
+
+    int cap = t->capacity ? t->capacity * 2 : INITIAL_ENTRIES;
+    size_t *offsets = realloc(t->offsets, cap * sizeof(size_t));
+    if (!offsets) return false;
+    t->offsets = offsets;
+    t->capacity = cap;
+    return true;
+}
+
+StrTable* strtable_new(void) {
+    return calloc(1, sizeof(StrTable));
+}
+
+void strtable_free(StrTable *t) {
+    if (!t) return;
+    free(t->arena);
+    free(t->offsets);
+    free(t->index);
+    free(t);
+}
+
+/* ==================== ÍNDICE ==================== */
+
+static size_t key_len(const StrTable *t, const char *s) {
+    return strcspn(s, t->key_delims);
+}
+
+/* FNV-1a */
+static uint32_t hash_key(const char *key, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)key[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* Hueco del código: el que lo contiene, o el libre donde iría */
+static size_t index_slot(const StrTable *t, const char *key, size_t len) {
+    size_t mask = t->index_cap - 1;
+    size_t slot = hash_key(key, len) & mask;
+
+    while (t->index[slot] >= 0) {
+        const char *s = t->arena + t->offsets[t->index[slot]];
+        if (key_len(t, s) == len && memcmp(s, key, len) == 0) break;
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+static void index_insert(StrTable *t, int pos) {
+    const char *s = t->arena + t->offsets[pos];
+    size_t slot = index_slot(t, s, key_len(t, s));
+    if (t->index[slot] < 0) t->index[slot] = pos;
+}
+
+static bool index_rebuild(StrTable *t, size_t cap) {
+    int *index = malloc(cap * sizeof(int));
+    if (!index) return false;
+    memset(index, 0xff, cap * sizeof(int));
+
+    free(t->index);
+    t->index = index;
+    t->index_cap = cap;
+    for (int i = 0; i < t->count; i++) index_insert(t, i);
+    return true;
+}
+
+bool strtable_index(StrTable *t, const char *delims) {
+    if (!t) return false;
+
+    snprintf(t->key_delims, sizeof(t->key_delims), "%s", delims ? delims : "");
+
+    size_t cap = INITIAL_INDEX;
+    while (cap < (size_t)t->count * 2) cap *= 2;
+    return index_rebuild(t, cap);
+}
+
+int strtable_find_len(const StrTable *t, const char *key, size_t len) {
+    if (!t || !key) return -1;
+
+    if (t->index) {
+        return t->index[index_slot(t, key, len)];
+    }
+
+    for (int i = 0; i < t->count; i++) {
+        const char *s = t->arena + t->offsets[i];
+        if (key_len(t, s) == len && memcmp(s, key, len) == 0) return i;
+    }
+    return -1;
+}
+
+int strtable_find(const StrTable *t, const char *key) {
+    return key ? strtable_find_len(t, key, strlen(key)) : -1;
+}
+
+/* ==================== ALTAS ==================== */
+
+/* Registra la cadena que ya está escrita al final del arena */
+static int commit_entry(StrTable *t, size_t offset, size_t len) {
+    t->arena[offset + len] = '\0';
+    t->arena_len = offset + len + 1;
+
+    int pos = t->count++;
+    t->offsets[pos] = offset;
+
+    if (t->index) {
+        if ((size_t)t->count * 2 > t->index_cap) {
+            if (!index_rebuild(t, t->index_cap * 2)) {
+                free(t->index);         /* sin índice sigue funcionando, con búsqueda lineal */
+                t->index = NULL;
+            }
+        } else {
+            index_insert(t, pos);
+        }
+    }
+    return pos;
+}
+
+int strtable_add_len(StrTable *t, const char *s, size_t len) {
+    if (!t || !s) return -1;
+    if (!reserve_entry(t) || !reserve_arena(t, len + 1)) return -1;
+
+    size_t offset = t->arena_len;
+    memcpy(t->arena + offset, s, len);
+    return commit_entry(t, offset, len);
+}
+
+int strtable_add(StrTable *t, const char *s) {
+    return s ? strtable_add_len(t, s, strlen(s)) : -1;
+}
+
+int strtable_addf(StrTable *t, const char *fmt, ...) {
+    if (!t || !fmt) return -1;
+    if (!reserve_entry(t) || !reserve_arena(t, 1)) return -1;
+
+    /* Directamente en el arena; si no cabe, se agranda y se repite */
+    va_list ap;
+    va_start(ap, fmt);
+    size_t room = t->arena_cap - t->arena_len;
+    int n = vsnprintf(t->arena + t->arena_len, room, fmt, ap);
+    va_end(ap);
+    if (n < 0) return -1;
+
+    if ((size_t)n >= room) {
+        if (!reserve_arena(t, (size_t)n + 1)) return -1;
+        va_start(ap, fmt);
+        vsnprintf(t->arena + t->arena_len, (size_t)n + 1, fmt, ap);
+        va_end(ap);
+    }
+    return commit_entry(t, t->arena_len, (size_t)n);
+}
+
+int strtable_read(StrTable *t, FILE *fp) {
+    if (!t || !fp) return 0;
+
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+    int added = 0;
+
+    while ((len = getline(&line, &cap, fp)) >= 0) {
+        len = strcspn(line, "\n");
+        if (len > 0 && strtable_add_len(t, line, len) >= 0) added++;
+    }
+
+    free(line);
+    return added;
+}
+
+/* ==================== CONSULTA ==================== */
+
+int strtable_count(const StrTable *t) {
+    return t ? t->count : 0;
+}
+
+const char* strtable_get(const StrTable *t, int i) {
+    if (!t || i < 0 || i >= t->count) return NULL;
+    return t->arena + t->offsets[i];
+}
+
+static int compare_strings(const void *a, const void *b) {
+    return strcmp(*(const char * const *)a, *(const char * const *)b);
+}
+
+void strtable_sort(StrTable *t) {
+    if (!t || t->count < 2) return;
+
+    const char **strings = malloc(t->count * sizeof(char*));
+    if (!strings) return;
+
+    for (int i = 0; i < t->count; i++) strings[i] = t->arena + t->offsets[i];
+    qsort(strings, t->count, sizeof(char*), compare_strings);
+    for (int i = 0; i < t->count; i++) t->offsets[i] = strings[i] - t->arena;
+    free(strings);
+
+    if (t->index && !index_rebuild(t, t->index_cap)) {
+        free(t->index);
+        t->index = NULL;
+    }
+}
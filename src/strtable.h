@@ -0,0 +1,65 @@
+#ifndef STRTABLE_H
+#define STRTABLE_H
+
+/*
+ * strtable.h - Growable string table over a single arena (sin dependencias de GTK)
+ *
+ * Todas las cadenas van seguidas en un único bloque, cada una terminada en
+ * '\0'; la tabla solo guarda su offset. Crece sin límite y se libera con una
+ * sola llamada. Sirve para las enumeraciones del sistema (idiomas, teclados,
+ * zonas horarias, discos, particiones), que antes eran arrays de tamaño fijo
+ * con un strdup por entrada.
+ *
+ * Opcionalmente lleva un índice hash de código a posición. El código de una
+ * entrada es su prefijo hasta el primero de los delimitadores dados al crear
+ * el índice ("es_ES - Spanish" con " " -> "es_ES"); sin delimitadores es la
+ * cadena entera. Con códigos repetidos gana la primera entrada.
+ *
+ * Los punteros de strtable_get() dejan de valer al añadir más cadenas.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define STRTABLE_DELIMS     8
+
+typedef struct {
+    char *arena;
+    size_t arena_len;
+    size_t arena_cap;
+    size_t *offsets;            /* offsets[i] = inicio de la cadena i en el arena */
+    int count;
+    int capacity;
+
+    int *index;                 /* hash abierto de posiciones, -1 = libre; NULL sin índice */
+    size_t index_cap;           /* potencia de 2 */
+    char key_delims[STRTABLE_DELIMS];
+} StrTable;
+
+StrTable* strtable_new(void);
+void strtable_free(StrTable *t);
+
+/* Añaden una cadena y devuelven su posición, o -1 si no hay memoria */
+int strtable_add(StrTable *t, const char *s);
+int strtable_add_len(StrTable *t, const char *s, size_t len);
+int strtable_addf(StrTable *t, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+/* Añade cada línea no vacía de fp, sin el '\n'. Devuelve las líneas añadidas. */
+int strtable_read(StrTable *t, FILE *fp);
+
+/* 0 / NULL para una tabla NULL o una posición fuera de rango */
+int strtable_count(const StrTable *t);
+const char* strtable_get(const StrTable *t, int i);
+
+/* Crea (o rehace) el índice; se mantiene al añadir y al ordenar */
+bool strtable_index(StrTable *t, const char *delims);
+
+/* Posición de la entrada con ese código, o -1. Sin índice recorre la tabla. */
+int strtable_find(const StrTable *t, const char *key);
+int strtable_find_len(const StrTable *t, const char *key, size_t len);
+
+/* Orden alfabético (strcmp) */
+void strtable_sort(StrTable *t);
+
+#endif /* STRTABLE_H */
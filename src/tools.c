@@ -78,252 +78,121 @@ void set_current_timezone(InstallerApp *app) {
         char *city = slash + 1;
 
         // Buscar región
-        for (int i = 0; i < app->region_count; i++) {
-            if (app->region_names[i] && strcmp(app->region_names[i], region) == 0) {
-                gtk_combo_box_set_active(GTK_COMBO_BOX(app->region_combo), i);
-
-                // Llenar ciudades para esta región
-                on_region_changed(GTK_COMBO_BOX(app->region_combo), app);
-
-                // Buscar ciudad
-                char **cities = app->timezone_regions[i];
-                if (cities) {
-                    for (int j = 0; cities[j] != NULL; j++) {
-                        if (strstr(city, cities[j]) == city) {
-                            gtk_combo_box_set_active(GTK_COMBO_BOX(app->city_combo), j);
-                            break;
-                        }
-                    }
-                }
-                break;
+        int i = strtable_find(app->tz_regions, region);
+        if (i >= 0) {
+            gtk_combo_box_set_active(GTK_COMBO_BOX(app->region_combo), i);
+
+            // Llenar ciudades para esta región
+            on_region_changed(GTK_COMBO_BOX(app->region_combo), app);
+
+            // Buscar ciudad: exacta por el índice, si no la primera que sea prefijo
+            const StrTable *cities = app->tz_cities[i];
+            int j = strtable_find(cities, city);
+            for (int k = 0; j < 0 && k < strtable_count(cities); k++) {
+                const char *name = strtable_get(cities, k);
+                if (name[0] && strstr(city, name) == city) j = k;
+            }
+            if (j >= 0) {
+                gtk_combo_box_set_active(GTK_COMBO_BOX(app->city_combo), j);
             }
         }
     } else {
         // Zona sin barra (UTC, GMT, etc.)
-        for (int i = 0; i < app->region_count; i++) {
-            if (app->region_names[i] && strcmp(app->region_names[i], valid_tz) == 0) {
-                gtk_combo_box_set_active(GTK_COMBO_BOX(app->region_combo), i);
-                on_region_changed(GTK_COMBO_BOX(app->region_combo), app);
-                break;
-            }
+        int i = strtable_find(app->tz_regions, valid_tz);
+        if (i >= 0) {
+            gtk_combo_box_set_active(GTK_COMBO_BOX(app->region_combo), i);
+            on_region_changed(GTK_COMBO_BOX(app->region_combo), app);
         }
     }
 
     g_free(valid_tz);
 }
 
+static bool is_special_timezone(const char *tz) {
+    return strcmp(tz, "leapseconds") == 0 ||
+           strcmp(tz, "tzdata.zi") == 0 ||
+           strcmp(tz, "Factory") == 0;
+}
+
 void load_timezones_hierarchical(InstallerApp *app) {
     // Cargar todas las zonas horarias
-    int tz_count;
-    char **timezones = get_timezones(&tz_count);
+    StrTable *timezones = get_timezones();
+
+    app->tz_regions = strtable_new();
+    strtable_index(app->tz_regions, NULL);
 
-    if (!timezones || tz_count == 0) {
+    if (strtable_count(timezones) == 0) {
         // Fallback básico
-        app->region_count = 1;
-        app->region_names = malloc(sizeof(char*));
-        app->region_names[0] = strdup("America");
-
-        app->timezone_regions = malloc(sizeof(char**));
-        app->timezone_regions[0] = malloc(6 * sizeof(char*));
-        app->timezone_regions[0][0] = strdup("New_York");
-        app->timezone_regions[0][1] = strdup("Los_Angeles");
-        app->timezone_regions[0][2] = strdup("Chicago");
-        app->timezone_regions[0][3] = strdup("Denver");
-        app->timezone_regions[0][4] = strdup("Mexico_City");
-        app->timezone_regions[0][5] = NULL;
+        strtable_free(timezones);
+        strtable_add(app->tz_regions, "America");
+
+        StrTable *cities = strtable_new();
+        strtable_add(cities, "New_York");
+        strtable_add(cities, "Los_Angeles");
+        strtable_add(cities, "Chicago");
+        strtable_add(cities, "Denver");
+        strtable_add(cities, "Mexico_City");
+        strtable_index(cities, NULL);
+
+        app->tz_cities = malloc(sizeof(StrTable*));
+        app->tz_cities[0] = cities;
         return;
     }
 
-    // Estructura temporal para regiones
-    typedef struct {
-        char *name;
-        char **cities;
-        int city_count;
-        int city_capacity;
-    } TimezoneRegion;
-
-    TimezoneRegion *temp_regions = malloc(tz_count * sizeof(TimezoneRegion));
-    int region_count = 0;
-
+    // Regiones: la parte antes de la primera barra, o la zona entera (UTC, GMT, etc.)
+    int tz_count = strtable_count(timezones);
     for (int i = 0; i < tz_count; i++) {
-        char *tz = timezones[i];
-
-        // Saltar especiales
-        if (strcmp(tz, "leapseconds") == 0 ||
-            strcmp(tz, "tzdata.zi") == 0 ||
-            strcmp(tz, "Factory") == 0) {
-            continue;
-            }
-
-            char *slash = strchr(tz, '/');
-        char *region_name;
-
-        if (slash) {
-            // Extraer nombre de región (primera parte)
-            int region_len = slash - tz;
-            region_name = malloc(region_len + 1);
-            strncpy(region_name, tz, region_len);
-            region_name[region_len] = '\0';
-        } else {
-            // Zonas sin barra (UTC, GMT, etc.)
-            region_name = strdup(tz);
-        }
+        const char *tz = strtable_get(timezones, i);
+        if (is_special_timezone(tz)) continue;
 
-        // Buscar si ya existe esta región
-        int region_idx = -1;
-        for (int j = 0; j < region_count; j++) {
-            if (strcmp(temp_regions[j].name, region_name) == 0) {
-                region_idx = j;
-                free(region_name);
-                break;
-            }
-        }
-
-        if (region_idx == -1) {
-            // Nueva región
-            region_idx = region_count;
-            temp_regions[region_idx].name = region_name;
-            temp_regions[region_idx].cities = malloc(20 * sizeof(char*));
-            temp_regions[region_idx].city_count = 0;
-            temp_regions[region_idx].city_capacity = 20;
-            region_count++;
-        }
-
-        // Procesar ciudad/subregión
-        if (slash) {
-            char *city_part = slash + 1;
-            char *second_slash = strchr(city_part, '/');
-
-            if (second_slash) {
-                // Formato: Region/Subregion/City
-                char *city_name = strdup(city_part);
-
-                // Verificar si ya existe
-                int city_found = 0;
-                for (int k = 0; k < temp_regions[region_idx].city_count; k++) {
-                    if (strcmp(temp_regions[region_idx].cities[k], city_name) == 0) {
-                        city_found = 1;
-                        free(city_name);
-                        break;
-                    }
-                }
-
-                if (!city_found) {
-                    // Añadir ciudad si necesitamos más capacidad
-                    if (temp_regions[region_idx].city_count >= temp_regions[region_idx].city_capacity) {
-                        temp_regions[region_idx].city_capacity *= 2;
-                        temp_regions[region_idx].cities = realloc(temp_regions[region_idx].cities,
-                                                                  temp_regions[region_idx].city_capacity * sizeof(char*));
-                    }
-
-                    temp_regions[region_idx].cities[temp_regions[region_idx].city_count] = city_name;
-                    temp_regions[region_idx].city_count++;
-                }
-            } else {
-                // Formato simple: Region/City
-                char *city_name = strdup(city_part);
-
-                // Verificar si ya existe
-                int city_found = 0;
-                for (int k = 0; k < temp_regions[region_idx].city_count; k++) {
-                    if (strcmp(temp_regions[region_idx].cities[k], city_name) == 0) {
-                        city_found = 1;
-                        free(city_name);
-                        break;
-                    }
-                }
-
-                if (!city_found) {
-                    // Añadir ciudad si necesitamos más capacidad
-                    if (temp_regions[region_idx].city_count >= temp_regions[region_idx].city_capacity) {
-                        temp_regions[region_idx].city_capacity *= 2;
-                        temp_regions[region_idx].cities = realloc(temp_regions[region_idx].cities,
-                                                                  temp_regions[region_idx].city_capacity * sizeof(char*));
-                    }
-
-                    temp_regions[region_idx].cities[temp_regions[region_idx].city_count] = city_name;
-                    temp_regions[region_idx].city_count++;
-                }
-            }
-        } else {
-            // Para UTC/GMT, etc.
-            if (temp_regions[region_idx].city_count == 0) {
-                temp_regions[region_idx].cities[0] = strdup("");
-                temp_regions[region_idx].city_count = 1;
-            }
-        }
-    }
-
-    // Ordenar regiones alfabéticamente
-    for (int i = 0; i < region_count - 1; i++) {
-        for (int j = i + 1; j < region_count; j++) {
-            if (strcmp(temp_regions[i].name, temp_regions[j].name) > 0) {
-                TimezoneRegion temp = temp_regions[i];
-                temp_regions[i] = temp_regions[j];
-                temp_regions[j] = temp;
-            }
+        size_t region_len = strcspn(tz, "/");
+        if (strtable_find_len(app->tz_regions, tz, region_len) < 0) {
+            strtable_add_len(app->tz_regions, tz, region_len);
         }
     }
+    strtable_sort(app->tz_regions);
 
-    // Ordenar ciudades dentro de cada región
+    int region_count = strtable_count(app->tz_regions);
+    app->tz_cities = malloc(region_count * sizeof(StrTable*));
     for (int i = 0; i < region_count; i++) {
-        if (temp_regions[i].city_count > 1) {
-            for (int j = 0; j < temp_regions[i].city_count - 1; j++) {
-                for (int k = j + 1; k < temp_regions[i].city_count; k++) {
-                    if (strcmp(temp_regions[i].cities[j], temp_regions[i].cities[k]) > 0) {
-                        char *temp_city = temp_regions[i].cities[j];
-                        temp_regions[i].cities[j] = temp_regions[i].cities[k];
-                        temp_regions[i].cities[k] = temp_city;
-                    }
-                }
-            }
-        }
+        app->tz_cities[i] = strtable_new();
+        strtable_index(app->tz_cities[i], NULL);
     }
 
-    // Convertir a la estructura final
-    app->region_count = region_count;
-    app->region_names = malloc(region_count * sizeof(char*));
-    app->timezone_regions = malloc(region_count * sizeof(char**));
-
-    for (int i = 0; i < region_count; i++) {
-        app->region_names[i] = strdup(temp_regions[i].name);
-
-        // Añadir terminador NULL al array de ciudades
-        temp_regions[i].city_count++;
-        temp_regions[i].cities = realloc(temp_regions[i].cities,
-                                         temp_regions[i].city_count * sizeof(char*));
-        temp_regions[i].cities[temp_regions[i].city_count - 1] = NULL;
-
-        app->timezone_regions[i] = temp_regions[i].cities;
-    }
-
-    // Liberar memoria temporal
+    // Ciudades: el resto de la zona (Region/City o Region/Subregion/City)
     for (int i = 0; i < tz_count; i++) {
-        free(timezones[i]);
+        const char *tz = strtable_get(timezones, i);
+        if (is_special_timezone(tz)) continue;
+
+        size_t region_len = strcspn(tz, "/");
+        int region_idx = strtable_find_len(app->tz_regions, tz, region_len);
+        if (region_idx < 0) continue;
+
+        // Para UTC/GMT, etc. la única "ciudad" es la cadena vacía
+        const char *city = tz[region_len] ? tz + region_len + 1 : "";
+        StrTable *cities = app->tz_cities[region_idx];
+        if (strtable_find(cities, city) < 0) {
+            strtable_add(cities, city);
+        }
     }
-    free(timezones);
 
-    // Liberar estructura temporal (pero no las ciudades, que fueron transferidas)
     for (int i = 0; i < region_count; i++) {
-        free(temp_regions[i].name);
+        strtable_sort(app->tz_cities[i]);
     }
-    free(temp_regions);
+
+    strtable_free(timezones);
 }
 
 void free_timezones_hierarchical(InstallerApp *app) {
-    if (!app->timezone_regions) return;
+    if (!app->tz_regions) return;
 
-    for (int i = 0; i < app->region_count; i++) {
-        if (app->timezone_regions[i]) {
-            for (int j = 0; app->timezone_regions[i][j] != NULL; j++) {
-                free(app->timezone_regions[i][j]);
-            }
-            free(app->timezone_regions[i]);
-        }
+    for (int i = 0; i < strtable_count(app->tz_regions); i++) {
+        strtable_free(app->tz_cities[i]);
     }
-    free(app->timezone_regions);
-    app->timezone_regions = NULL;
-    app->region_count = 0;
+    free(app->tz_cities);
+    strtable_free(app->tz_regions);
+    app->tz_cities = NULL;
+    app->tz_regions = NULL;
 }
 
 char* extract_code(const char *text) {
@@ -422,96 +291,58 @@ char* run_command(const char *cmd) {
     return result;
 }
 
-char** list_partitions(int *count) {
+StrTable* list_partitions(void) {
     FILE *fp = popen(SYSINFO_SCRIPT " partitions", "r");
     if (!fp) return NULL;
 
-    char **partitions = malloc(50 * sizeof(char*));
-    char line[256];
-    *count = 0;
+    StrTable *partitions = strtable_new();
+    char *line = NULL;
+    size_t line_cap = 0;
 
-    while (fgets(line, sizeof(line), fp) && *count < 50) {
+    while (partitions && getline(&line, &line_cap, fp) >= 0) {
         line[strcspn(line, "\n")] = 0;
-        if (strlen(line) > 0) {
-            // Parsear: /dev/├─sda1|6.2G|ext4|
-            // O: /dev/└─sda2|3.8G|ext4|
-            char device[64], size[32], fstype[32];
-            char *pipe1 = strchr(line, '|');
-            char *pipe2 = pipe1 ? strchr(pipe1 + 1, '|') : NULL;
-            char *pipe3 = pipe2 ? strchr(pipe2 + 1, '|') : NULL;
-
-            if (pipe1 && pipe2) {
-                // Marcar los fin de campos
-                *pipe1 = '\0';
-                *pipe2 = '\0';
-                if (pipe3) {
-                    *pipe3 = '\0';
-                }
-
-                // Copiar los campos con límites seguros
-                strncpy(device, line, sizeof(device)-1);
-                device[sizeof(device)-1] = '\0';  // Asegurar terminación
-
-                strncpy(size, pipe1 + 1, sizeof(size)-1);
-                size[sizeof(size)-1] = '\0';
-
-                strncpy(fstype, pipe2 + 1, sizeof(fstype)-1);
-                fstype[sizeof(fstype)-1] = '\0';
-
-                // Construir string para mostrar (manteniendo el formato del árbol si está presente)
-                char *display = malloc(256);
-
-                // Verificar si la línea contiene caracteres de árbol
-                char *tree_chars = strstr(device, "├─");
-                if (!tree_chars) {
-                    tree_chars = strstr(device, "└─");
-                }
+        if (line[0] == '\0') continue;
 
-                if (tree_chars) {
-                    // Separar el prefijo (/dev/) de la partición (├─sda1)
-                    char prefix[32];
-                    char part_name[32];
+        // Parsear: /dev/├─sda1|6.2G|ext4|
+        // O: /dev/└─sda2|3.8G|ext4|
+        char *pipe1 = strchr(line, '|');
+        char *pipe2 = pipe1 ? strchr(pipe1 + 1, '|') : NULL;
 
-                    // Copiar hasta el caracter de árbol
-                    size_t prefix_len = tree_chars - device;
-                    strncpy(prefix, device, prefix_len);
-                    prefix[prefix_len] = '\0';
+        if (!pipe2) {
+            // Formato simple si no hay pipes
+            strtable_add(partitions, line);
+            continue;
+        }
 
-                    // Copiar la parte después del árbol
-                    snprintf(part_name, sizeof(part_name), "%s", tree_chars);
+        // Marcar los fin de campos
+        *pipe1 = '\0';
+        *pipe2 = '\0';
+        char *pipe3 = strchr(pipe2 + 1, '|');
+        if (pipe3) {
+            *pipe3 = '\0';
+        }
 
-                    // Mostrar sin los caracteres especiales del árbol
-                    char clean_part[32];
-                    // Saltar los caracteres UTF-8 del árbol (3 bytes cada uno: ├─ o └─)
-                    snprintf(clean_part, sizeof(clean_part), "%s", part_name + 6); // 6 bytes para "├─" o "└─"
+        const char *device = line;
+        const char *size = pipe1 + 1;
+        const char *fstype = pipe2 + 1;
 
-                    snprintf(display, 256, "%s%s - %s %s",
-                             prefix, clean_part, size, fstype);
-                } else {
-                    // Formato normal
-                    snprintf(display, 256, "%s - %s %s", device, size, fstype);
-                }
-
-                partitions[*count] = display;
-                (*count)++;
+        // Verificar si la línea contiene caracteres de árbol
+        const char *tree_chars = strstr(device, "├─");
+        if (!tree_chars) {
+            tree_chars = strstr(device, "└─");
+        }
 
-                // Restaurar los pipes para mantener el buffer consistente
-                // (aunque no es estrictamente necesario)
-                *pipe1 = '|';
-                *pipe2 = '|';
-                if (pipe3) {
-                    *pipe3 = '|';
-                }
-            } else {
-                // Formato simple si no hay pipes
-                char *display = malloc(256);
-                snprintf(display, 256, "%s", line);
-                partitions[*count] = display;
-                (*count)++;
-            }
+        if (tree_chars) {
+            // Prefijo (/dev/) + partición sin el árbol: 6 bytes UTF-8 para "├─" o "└─"
+            strtable_addf(partitions, "%.*s%s - %s %s",
+                          (int)(tree_chars - device), device, tree_chars + 6, size, fstype);
+        } else {
+            // Formato normal
+            strtable_addf(partitions, "%s - %s %s", device, size, fstype);
         }
     }
 
+    free(line);
     pclose(fp);
     return partitions;
 }
@@ -552,12 +383,6 @@ bool extract_device(const char *display_text, char *buffer, size_t buffer_size)
     return true;
 }
 
-void free_string_array(char **array, int count) {
-    if (!array) return;
-    for (int i = 0; i < count; i++) free(array[i]);
-    free(array);
-}
-
 int get_disk_size_gb(const char *device) {
     char cmd[256];
     snprintf(cmd, sizeof(cmd),
@@ -666,8 +491,7 @@ int populate_partition_combo(GtkComboBoxText *combo, InstallerApp *app) {
     const char *none_text = _("(None)");
     gtk_combo_box_text_append_text(combo, none_text);
 
-    int count;
-    char **partitions = list_partitions(&count);
+    StrTable *partitions = list_partitions();
 
     if (!partitions) {
         return 0;
@@ -706,9 +530,10 @@ int populate_partition_combo(GtkComboBoxText *combo, InstallerApp *app) {
 
     // Agregar particiones que no estén en la lista de excluidas
     int added_count = 0;
-    for (int i = 0; i < count; i++) {
+    for (int i = 0; i < strtable_count(partitions); i++) {
+        const char *partition = strtable_get(partitions, i);
         char device[64];
-        if (extract_device(partitions[i], device, sizeof(device))) {
+        if (extract_device(partition, device, sizeof(device))) {
             bool excluded = false;
 
             // Verificar si este dispositivo ya está seleccionado
@@ -720,12 +545,12 @@ int populate_partition_combo(GtkComboBoxText *combo, InstallerApp *app) {
             }
 
             if (!excluded) {
-                gtk_combo_box_text_append_text(combo, partitions[i]);
+                gtk_combo_box_text_append_text(combo, partition);
                 added_count++;
             }
         } else {
             // Si no podemos extraer dispositivo, agregar de todos modos
-            gtk_combo_box_text_append_text(combo, partitions[i]);
+            gtk_combo_box_text_append_text(combo, partition);
             added_count++;
         }
     }
@@ -735,7 +560,7 @@ int populate_partition_combo(GtkComboBoxText *combo, InstallerApp *app) {
         free(excluded_devices[i]);
     }
 
-    free_string_array(partitions, count);
+    strtable_free(partitions);
 
     return added_count;
 }
@@ -747,29 +572,6 @@ void refresh_partition_combos(InstallerApp *app) {
     if (app->efi_combo) populate_partition_combo(GTK_COMBO_BOX_TEXT(app->efi_combo), app);
 }
 
-int find_combo_item(GtkComboBoxText *combo, const char *search_text) {
-    GtkTreeModel *model = gtk_combo_box_get_model(GTK_COMBO_BOX(combo));
-    GtkTreeIter iter;
-    int index = 0;
-
-    if (gtk_tree_model_get_iter_first(model, &iter)) {
-        do {
-            gchar *item_text;
-            gtk_tree_model_get(model, &iter, 0, &item_text, -1);
-
-            if (item_text && strcmp(item_text, search_text) == 0) {
-                g_free(item_text);
-                return index;
-            }
-
-            g_free(item_text);
-            index++;
-        } while (gtk_tree_model_iter_next(model, &iter));
-    }
-
-    return 0; // Default to first item if not found
-}
-
 LogData* create_log_data(InstallerApp *app, const char *text) {
     LogData *data = malloc(sizeof(LogData));
     if (data) {
@@ -975,6 +777,9 @@ void on_page_switched(GtkNotebook *notebook, GtkWidget *page_widget, guint page_
 
     int current_page = page_num;
 
+    // Se emite antes del cambio: la página se llena antes de mostrarse
+    ensure_tab_built(app, current_page);
+
     app->last_page = current_page;
 
     update_navigation_buttons(app);
@@ -1525,8 +1330,37 @@ void on_install_clicked(GtkButton *btn, InstallerApp *app) {
         app->config.create_swapfile = gtk_toggle_button_get_active(
             GTK_TOGGLE_BUTTON(app->swap_file_radio));
         app->config.swap_size_mb = gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(app->swap_spin));
+
+        const char *root_fs = gtk_combo_box_get_active_id(GTK_COMBO_BOX(app->root_fs_combo));
+        g_strlcpy(app->config.root_fs, root_fs ? root_fs : "ext4", sizeof(app->config.root_fs));
+
+        // RAID: el disco principal más los discos marcados
+        app->config.raid = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(app->raid_check));
+        if (app->config.raid) {
+            const char *level = gtk_combo_box_get_active_id(GTK_COMBO_BOX(app->raid_level_combo));
+            app->config.raid_level = level ? atoi(level) : 1;
+
+            update_raid_disk_checks(app);
+            if (!collect_raid_disks(app, app->config.raid_disks, sizeof(app->config.raid_disks))) {
+                GtkWidget *dialog = gtk_message_dialog_new(GTK_WINDOW(app->window),
+                                                           GTK_DIALOG_MODAL,
+                                                           GTK_MESSAGE_ERROR,
+                                                           GTK_BUTTONS_OK,
+                                                           _("Select at least one more disk for the RAID array."));
+                gtk_dialog_run(GTK_DIALOG(dialog));
+                gtk_widget_destroy(dialog);
+                g_free(username); g_free(realname); g_free(hostname);
+                g_free(password); g_free(confirm);
+                return;
+            }
+        } else {
+            app->config.raid_disks[0] = '\0';
+        }
     }
 
+    app->config.probe_other_os = gtk_toggle_button_get_active(
+        GTK_TOGGLE_BUTTON(app->other_os_check));
+
     printf("DEBUG: Final configuration:\n");
     printf("  Mode: %s\n", app->config.auto_partition ? "Auto" : "Manual");
     printf("  Username: %s\n", app->config.username);
@@ -1545,6 +1379,12 @@ void on_install_clicked(GtkButton *btn, InstallerApp *app) {
             printf("  Swap type: %s\n", app->config.create_swapfile ? "File" : "Partition");
             printf("  Swap size: %dMB\n", app->config.swap_size_mb);
         }
+        printf("  Filesystem: %s\n", app->config.root_fs);
+        printf("  RAID: %s\n", app->config.raid ? "Yes" : "No");
+        if (app->config.raid) {
+            printf("  RAID level: %d\n", app->config.raid_level);
+            printf("  RAID disks: %s\n", app->config.raid_disks);
+        }
     } else {
         printf("  Root partition: %s\n", app->config.root_partition);
         printf("  Separate /home: %s\n", app->config.separate_home ? "Yes" : "No");
@@ -1573,7 +1413,16 @@ void on_install_clicked(GtkButton *btn, InstallerApp *app) {
 
     // DIÁLOGO DE CONFIRMACIÓN
     GtkWidget *dialog;
-    if (app->config.auto_partition) {
+    if (app->config.auto_partition && app->config.raid) {
+        dialog = gtk_message_dialog_new(GTK_WINDOW(app->window),
+                                        GTK_DIALOG_MODAL,
+                                        GTK_MESSAGE_QUESTION,
+                                        GTK_BUTTONS_YES_NO,
+                                        _("This will erase all data on %s and %s (RAID %d) and install LOC-OS 24.\n\n"
+                                        "Do you want to continue?"),
+                                        app->config.disk_device, app->config.raid_disks,
+                                        app->config.raid_level);
+    } else if (app->config.auto_partition) {
         dialog = gtk_message_dialog_new(GTK_WINDOW(app->window),
                                         GTK_DIALOG_MODAL,
                                         GTK_MESSAGE_QUESTION,
@@ -1626,13 +1475,19 @@ void on_finish_clicked(GtkButton *btn, InstallerApp *app) {
                                                     GTK_WINDOW(app->window),
                                                     GTK_DIALOG_MODAL,
                                                     _("Close"), GTK_RESPONSE_CLOSE,
-                                                    _("Reboot"), GTK_RESPONSE_ACCEPT,
                                                     NULL
     );
 
+    // Tras una simulación no se ha instalado nada: no se ofrece reiniciar
+    if (!app->simulator) {
+        gtk_dialog_add_button(GTK_DIALOG(dialog), _("Reboot"), GTK_RESPONSE_ACCEPT);
+    }
+
     GtkWidget *content = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
 
-    GtkWidget *message = gtk_label_new(_("Installation completed successfully!"));
+    GtkWidget *message = gtk_label_new(app->simulator
+                                       ? _("Simulated installation completed.")
+                                       : _("Installation completed successfully!"));
     gtk_widget_set_margin_start(message, 20);
     gtk_widget_set_margin_end(message, 20);
     gtk_widget_set_margin_top(message, 20);
@@ -1656,17 +1511,18 @@ void on_finish_clicked(GtkButton *btn, InstallerApp *app) {
 void on_region_changed(GtkComboBox *combo, InstallerApp *app) {
     int region_index = gtk_combo_box_get_active(combo);
 
-    if (region_index < 0 || region_index >= app->region_count) return;
+    if (region_index < 0 || region_index >= strtable_count(app->tz_regions)) return;
 
     // Limpiar combo de ciudades
     gtk_combo_box_text_remove_all(GTK_COMBO_BOX_TEXT(app->city_combo));
 
     // Llenar ciudades para la región seleccionada
-    char **cities = app->timezone_regions[region_index];
+    const StrTable *cities = app->tz_cities[region_index];
 
-    if (cities[0]) {
-        for (int i = 0; cities[i] != NULL; i++) {
-            gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(app->city_combo), cities[i]);
+    if (strtable_count(cities) > 0) {
+        for (int i = 0; i < strtable_count(cities); i++) {
+            gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(app->city_combo),
+                                           strtable_get(cities, i));
         }
         gtk_combo_box_set_active(GTK_COMBO_BOX(app->city_combo), 0);
     }
@@ -1728,22 +1584,21 @@ void update_keyboard_variants(InstallerApp *app, const char *layout_code) {
     char command[256];
     snprintf(command, sizeof(command), "%s variants %s", SYSINFO_SCRIPT, layout_code);
 
-    int variant_count;
-    char **variants = get_system_list(command, &variant_count);
+    StrTable *variants = get_system_list(command);
+    int variant_count = strtable_count(variants);
 
-    if (variants && variant_count > 0) {
+    if (variant_count > 0) {
         printf("DEBUG: Found %d variants for layout %s\n", variant_count, layout_code);
 
         // Añadir todas las variantes obtenidas
         for (int i = 0; i < variant_count; i++) {
             gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(app->keyboard_variant_combo),
-                                           variants[i]);
+                                           strtable_get(variants, i));
         }
-
-        free_string_array(variants, variant_count);
     } else {
         printf("DEBUG: No variants found for layout %s (only default available)\n", layout_code);
     }
+    strtable_free(variants);
 
     // Seleccionar "default" por defecto
     gtk_combo_box_set_active(GTK_COMBO_BOX(app->keyboard_variant_combo), 0);
@@ -1762,6 +1617,8 @@ void on_disk_changed(GtkComboBox *combo, InstallerApp *app) {
         app->config.disk_device[0] = '\0';
         printf("DEBUG: No disk selected or no ID found\n");
     }
+
+    update_raid_disk_checks(app);
 }
 
 void on_partition_mode_toggled(GtkToggleButton *btn, InstallerApp *app) {
@@ -1801,6 +1658,57 @@ void on_add_swap_toggled(GtkToggleButton *btn, InstallerApp *app) {
     printf("DEBUG: Swap enabled: %s\n", active ? "Yes" : "No");
 }
 
+void on_raid_toggled(GtkToggleButton *btn, InstallerApp *app) {
+    bool active = gtk_toggle_button_get_active(btn);
+
+    if (active) {
+        gtk_widget_show_all(app->raid_options_container);
+        update_raid_disk_checks(app);
+    } else {
+        gtk_widget_hide(app->raid_options_container);
+    }
+
+    app->config.raid = active;
+    printf("DEBUG: RAID enabled: %s\n", active ? "Yes" : "No");
+}
+
+// El disco principal ya es miembro: su check queda desactivado
+void update_raid_disk_checks(InstallerApp *app) {
+    if (!app->raid_disks_box) return;
+
+    GList *children = gtk_container_get_children(GTK_CONTAINER(app->raid_disks_box));
+    for (GList *l = children; l; l = l->next) {
+        const char *device = g_object_get_data(G_OBJECT(l->data), "device");
+        bool primary = device && strcmp(device, app->config.disk_device) == 0;
+
+        if (primary) {
+            gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(l->data), FALSE);
+        }
+        gtk_widget_set_sensitive(GTK_WIDGET(l->data), !primary);
+    }
+    g_list_free(children);
+}
+
+// Discos adicionales marcados, separados por comas. false si no hay ninguno.
+bool collect_raid_disks(InstallerApp *app, char *buffer, size_t size) {
+    buffer[0] = '\0';
+    if (!app->raid_disks_box) return false;
+
+    GList *children = gtk_container_get_children(GTK_CONTAINER(app->raid_disks_box));
+    for (GList *l = children; l; l = l->next) {
+        const char *device = g_object_get_data(G_OBJECT(l->data), "device");
+        if (!device || !gtk_widget_get_sensitive(GTK_WIDGET(l->data)) ||
+            !gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(l->data))) {
+            continue;
+        }
+        if (buffer[0]) g_strlcat(buffer, ",", size);
+        g_strlcat(buffer, device, size);
+    }
+    g_list_free(children);
+
+    return buffer[0] != '\0';
+}
+
 void on_separate_home_manual_toggled(GtkToggleButton *btn, InstallerApp *app) {
     bool active = gtk_toggle_button_get_active(btn);
     printf("DEBUG: Separate /home toggled: %s\n", active ? "Yes" : "No");
@@ -1896,16 +1804,51 @@ void on_root_password_check_toggled(GtkToggleButton *btn, InstallerApp *app) {
     app->config.same_root_password = active;
 }
 
+static gboolean destroy_window_idle(InstallerApp *app) {
+    gtk_widget_destroy(app->window);
+    return G_SOURCE_REMOVE;
+}
+
+// El hilo cierra la cola justo antes de terminar: vaciada, el join es inmediato
+static gboolean wait_install_thread(InstallerApp *app) {
+    if (!ui_queue_finished(app->ui_queue)) return G_SOURCE_CONTINUE;
+
+    pthread_join(app->install_thread, NULL);
+    app->thread_running = false;
+
+    // Prioridad baja: antes se atienden los avisos que el hilo dejó pendientes
+    g_idle_add_full(G_PRIORITY_LOW, (GSourceFunc)destroy_window_idle, app, NULL);
+    return G_SOURCE_REMOVE;
+}
+
+/*
+ * Cerrar durante la instalación: la ventana se oculta, se cancela y se
+ * destruye cuando el hilo termina. El bucle principal sigue vaciando la cola
+ * mientras tanto, así que ni la interfaz ni el hilo se bloquean.
+ */
+gboolean on_window_delete(GtkWidget *widget, GdkEvent *event, InstallerApp *app) {
+    (void)event;
+    if (!app->thread_running) return FALSE;
+
+    if (!app->closing) {
+        app->closing = true;
+        gtk_widget_hide(widget);
+        cancel_installation(app);
+        g_timeout_add(CHILD_POLL_MS, (GSourceFunc)wait_install_thread, app);
+    }
+    return TRUE;
+}
+
 void on_window_destroy(GtkWidget *widget, InstallerApp *app) {
     (void)widget;
-    if (app->thread_running) {
-        pthread_cancel(app->install_thread);
-        pthread_join(app->install_thread, NULL);
-    }
 
     // Liberar zonas horarias
     free_timezones_hierarchical(app);
 
+    if (app->ui_drain_source) g_source_remove(app->ui_drain_source);
+    ui_queue_free(app->ui_queue);
+    logstore_free(app->log_store);
+
     pthread_mutex_destroy(&app->mutex);
     free(app);
     gtk_main_quit();
@@ -32,7 +32,7 @@ gboolean update_status_ui(gpointer data) {
 }
 
 gboolean show_error_dialog(ErrorData *edata) {
-    if (edata->app) {
+    if (edata->app && !edata->app->closing) {
         edata->app->config.installation_started = false;
         update_navigation_buttons(edata->app);
 
@@ -51,7 +51,7 @@ gboolean show_error_dialog(ErrorData *edata) {
 }
 
 gboolean show_success_dialog(InstallerApp *app) {
-    if (app) {
+    if (app && !app->closing) {
         app->config.installation_complete = true;
         update_navigation_buttons(app);
 
@@ -61,6 +61,13 @@ gboolean show_success_dialog(InstallerApp *app) {
                                                    GTK_BUTTONS_OK,
                                                    _("Installation completed successfully!\n\n"
                                                    "Click 'Finish Installation' to complete."));
+
+        // Dónde se fue el tiempo de la instalación
+        char *summary = format_stage_summary(app);
+        if (summary) {
+            gtk_message_dialog_format_secondary_text(GTK_MESSAGE_DIALOG(dialog), "%s", summary);
+            g_free(summary);
+        }
         gtk_dialog_run(GTK_DIALOG(dialog));
         gtk_widget_destroy(dialog);
     }
@@ -74,32 +81,355 @@ gboolean enable_close_button(gpointer data) {
     return G_SOURCE_REMOVE;
 }
 
-void copy_log_to_clipboard(InstallerApp *app) {
+/*
+ * Vacía la cola del hilo de instalación en un solo lote: todas las líneas van
+ * al fichero de log y, si el visor sigue el final, a la vista en una inserción
+ * y un scroll. Del estado y el progreso solo se aplica el último.
+ */
+gboolean drain_ui_queue(gpointer data) {
+    InstallerApp *app = (InstallerApp*)data;
+    UiQueue *q = app->ui_queue;
+
+    GString *pending = g_string_new(NULL);
+    bool clear_log = false;
+    bool drop_view_tail = false;
+    bool pending_transient = false;
+    bool have_status = false;
+    bool have_progress = false;
+    char status[UI_MESSAGE_TEXT] = "";
+    char progress[UI_MESSAGE_TEXT] = "";
+    int percent = 0;
+    gint64 drain_start = app->simulator ? g_get_monotonic_time() : 0;
+
+    // Como mucho un anillo por lote, para no quedarse aquí si el productor no para
+    const UiMessage *msg;
+    int n = 0;
+    for (; n < UI_QUEUE_SLOTS && (msg = ui_queue_peek(q)) != NULL; n++) {
+        switch (msg->kind) {
+            case UI_MSG_LOG:
+                logstore_append(app->log_store, msg->text);
+                g_string_append(pending, msg->text);
+                g_string_append_c(pending, '\n');
+                pending_transient = false;
+                break;
+
+            case UI_MSG_LOG_REPLACE:
+                logstore_set_transient(app->log_store, msg->text);
+                if (pending_transient) {
+                    // Quitar la línea transitoria pendiente (termina en '\n')
+                    gssize i = (gssize) pending->len - 2;
+                    while (i >= 0 && pending->str[i] != '\n') i--;
+                    g_string_truncate(pending, i + 1);
+                } else if (pending->len == 0 && app->log_tail_transient) {
+                    drop_view_tail = true;
+                }
+                g_string_append(pending, msg->text);
+                g_string_append_c(pending, '\n');
+                pending_transient = true;
+                break;
+
+            case UI_MSG_CLEAR_LOG:
+                logstore_reset(app->log_store);
+                clear_log = true;
+                drop_view_tail = false;
+                pending_transient = false;
+                g_string_truncate(pending, 0);
+                break;
+
+            case UI_MSG_STATUS:
+                g_strlcpy(status, msg->text, sizeof(status));
+                have_status = true;
+                break;
+
+            case UI_MSG_PROGRESS:
+                g_strlcpy(progress, msg->text, sizeof(progress));
+                percent = msg->percent;
+                have_progress = true;
+                break;
+        }
+        ui_queue_release(q);
+    }
+    logstore_flush(app->log_store);
+
+    if (clear_log) {
+        // Instalación nueva: vista vacía siguiendo el final
+        app->log_view_first = 0;
+        app->log_match_line = -1;
+        app->log_following = true;
+        app->log_tail_transient = false;
+        if (app->log_buffer) gtk_text_buffer_set_text(app->log_buffer, "", -1);
+    }
+
+    // En modo página las líneas nuevas solo van al fichero
+    if (app->log_buffer && app->log_following && pending->len > 0) {
+        GtkTextIter start, end;
+
+        if (drop_view_tail) {
+            gtk_text_buffer_get_end_iter(app->log_buffer, &end);
+            start = end;
+            if (gtk_text_iter_backward_line(&start)) {
+                gtk_text_buffer_delete(app->log_buffer, &start, &end);
+            }
+        }
+
+        gtk_text_buffer_get_end_iter(app->log_buffer, &end);
+        gtk_text_buffer_insert(app->log_buffer, &end, pending->str, (gint) pending->len);
+        app->log_tail_transient = pending_transient;
+
+        // Mantener solo las últimas LOG_VIEW_LINES líneas
+        int excess = gtk_text_buffer_get_line_count(app->log_buffer) - 1 - LOG_VIEW_LINES;
+        if (excess > 0) {
+            gtk_text_buffer_get_start_iter(app->log_buffer, &start);
+            gtk_text_buffer_get_iter_at_line(app->log_buffer, &end, excess);
+            gtk_text_buffer_delete(app->log_buffer, &start, &end);
+            app->log_view_first += (size_t) excess;
+        }
+
+        // Auto-scroll una vez por lote
+        if (app->log_text_view) {
+            gtk_text_buffer_get_end_iter(app->log_buffer, &end);
+            gtk_text_view_scroll_to_iter(GTK_TEXT_VIEW(app->log_text_view),
+                                         &end, 0.0, FALSE, 0.0, 1.0);
+        }
+    }
+    g_string_free(pending, TRUE);
+
+    if (have_status && app->status_label) {
+        gtk_label_set_text(GTK_LABEL(app->status_label), status);
+    }
+    if (have_progress && app->progress_bar) {
+        gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(app->progress_bar), percent / 100.0);
+        gtk_progress_bar_set_text(GTK_PROGRESS_BAR(app->progress_bar), progress);
+    }
+
+    if (app->simulator) loop_stats_drain(app, drain_start, n);
+
+    if (ui_queue_finished(q)) {
+        app->ui_drain_source = 0;
+        return G_SOURCE_REMOVE;
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+/* ==================== LOG VIEWER ==================== */
+
+static void log_view_set_lines(InstallerApp *app, size_t first, bool with_transient) {
+    char *text = logstore_read_lines(app->log_store, first, LOG_VIEW_LINES);
+    const char *transient = with_transient ? logstore_transient(app->log_store) : NULL;
+
+    GString *view = g_string_new(text);
+    if (view->len > 0) g_string_append_c(view, '\n');
+    if (transient) {
+        g_string_append(view, transient);
+        g_string_append_c(view, '\n');
+    }
+
+    gtk_text_buffer_set_text(app->log_buffer, view->str, (gint) view->len);
+    app->log_view_first = first;
+    app->log_tail_transient = transient != NULL;
+
+    g_string_free(view, TRUE);
+    free(text);
+}
+
+/* Vuelve a seguir el final del log */
+void log_view_follow(InstallerApp *app) {
     if (!app->log_buffer) return;
 
-    GtkTextIter start, end;
-    gtk_text_buffer_get_start_iter(app->log_buffer, &start);
+    size_t total = logstore_line_count(app->log_store);
+    log_view_set_lines(app, total > LOG_VIEW_LINES ? total - LOG_VIEW_LINES : 0, true);
+    app->log_following = true;
+
+    GtkTextIter end;
     gtk_text_buffer_get_end_iter(app->log_buffer, &end);
+    gtk_text_view_scroll_to_iter(GTK_TEXT_VIEW(app->log_text_view), &end, 0.0, FALSE, 0.0, 1.0);
+}
 
-    gchar *text = gtk_text_buffer_get_text(app->log_buffer, &start, &end, FALSE);
+/* Muestra una página fija del fichero; si llega al final, vuelve a seguirlo */
+static void log_view_show_page(InstallerApp *app, size_t first) {
+    size_t total = logstore_line_count(app->log_store);
+    if (first + LOG_VIEW_LINES >= total) {
+        log_view_follow(app);
+        return;
+    }
 
-    GtkClipboard *clipboard = gtk_clipboard_get(GDK_SELECTION_CLIPBOARD);
-    gtk_clipboard_set_text(clipboard, text, -1);
+    log_view_set_lines(app, first, false);
+    app->log_following = false;
 
-    g_free(text);
+    GtkTextIter start;
+    gtk_text_buffer_get_start_iter(app->log_buffer, &start);
+    gtk_text_view_scroll_to_iter(GTK_TEXT_VIEW(app->log_text_view), &start, 0.0, FALSE, 0.0, 0.0);
+}
+
+static void on_log_older_clicked(GtkButton *btn, InstallerApp *app) {
+    (void)btn;
+    size_t first = app->log_view_first;
+    log_view_show_page(app, first > LOG_VIEW_LINES ? first - LOG_VIEW_LINES : 0);
+}
+
+static void on_log_newer_clicked(GtkButton *btn, InstallerApp *app) {
+    (void)btn;
+    log_view_show_page(app, app->log_view_first + LOG_VIEW_LINES);
+}
+
+static void on_log_latest_clicked(GtkButton *btn, InstallerApp *app) {
+    (void)btn;
+    log_view_follow(app);
+}
+
+static void log_search(InstallerApp *app, bool forward) {
+    const char *needle = gtk_entry_get_text(GTK_ENTRY(app->log_search_entry));
+    size_t total = logstore_line_count(app->log_store);
+    if (!needle || !*needle || total == 0) return;
+
+    // Desde la coincidencia anterior; la primera búsqueda empieza por el final
+    size_t from = app->log_match_line >= 0 ? (size_t) app->log_match_line : total;
+    long match = logstore_find(app->log_store, needle, from, forward);
+    if (match < 0) {
+        // Dar la vuelta
+        match = logstore_find(app->log_store, needle, forward ? (size_t) -1 : total, forward);
+    }
+    if (match < 0) {
+        gtk_widget_error_bell(app->log_search_entry);
+        return;
+    }
+    app->log_match_line = match;
+
+    // Página con la coincidencia en el centro
+    size_t first = (size_t) match > LOG_VIEW_LINES / 2 ? (size_t) match - LOG_VIEW_LINES / 2 : 0;
+    log_view_show_page(app, first);
+
+    GtkTextIter start, end;
+    gtk_text_buffer_get_bounds(app->log_buffer, &start, &end);
+    gtk_text_buffer_remove_tag(app->log_buffer, app->log_match_tag, &start, &end);
+
+    gtk_text_buffer_get_iter_at_line(app->log_buffer, &start, (gint) ((size_t) match - app->log_view_first));
+    end = start;
+    gtk_text_iter_forward_to_line_end(&end);
+    gtk_text_buffer_apply_tag(app->log_buffer, app->log_match_tag, &start, &end);
+    gtk_text_view_scroll_to_iter(GTK_TEXT_VIEW(app->log_text_view), &start, 0.0, TRUE, 0.0, 0.5);
+}
+
+static void on_log_search_activate(GtkEntry *entry, InstallerApp *app) {
+    (void)entry;
+    log_search(app, false);
+}
+
+static void on_log_search_changed(GtkSearchEntry *entry, InstallerApp *app) {
+    (void)entry;
+    app->log_match_line = -1;
+}
+
+static void on_log_next_match(GtkSearchEntry *entry, InstallerApp *app) {
+    (void)entry;
+    log_search(app, true);
+}
+
+static void on_log_previous_match(GtkSearchEntry *entry, InstallerApp *app) {
+    (void)entry;
+    log_search(app, false);
+}
+
+/*
+ * Copia solo lo útil para pegar en un informe: si hubo un error, las líneas
+ * del log que lo preceden; si no, lo que se ve en el visor. El log completo
+ * se exporta con save_log_to_file().
+ */
+void copy_log_to_clipboard(InstallerApp *app) {
+    if (!app->log_buffer) return;
+
+    GString *text = g_string_new(NULL);
+    const char *what;
+
+    if (app->last_error[0] != '\0') {
+        size_t total = logstore_line_count(app->log_store);
+        long match = logstore_find(app->log_store, app->last_error, total, false);
+        size_t end = match >= 0 ? (size_t) match + 1 : total;
+        size_t first = end > COPY_ERROR_CONTEXT ? end - COPY_ERROR_CONTEXT : 0;
+
+        char *lines = logstore_read_lines(app->log_store, first, end - first);
+        g_string_append_printf(text, "Error: %s\n\n%s\n", app->last_error, lines);
+        free(lines);
+        what = _("Error section of the log copied to clipboard");
+    } else {
+        GdkRectangle rect;
+        GtkTextIter start, end;
+        gtk_text_view_get_visible_rect(GTK_TEXT_VIEW(app->log_text_view), &rect);
+        gtk_text_view_get_line_at_y(GTK_TEXT_VIEW(app->log_text_view), &start, rect.y, NULL);
+        gtk_text_view_get_line_at_y(GTK_TEXT_VIEW(app->log_text_view), &end, rect.y + rect.height, NULL);
+        gtk_text_iter_forward_to_line_end(&end);
+
+        gchar *visible = gtk_text_buffer_get_text(app->log_buffer, &start, &end, FALSE);
+        g_string_append(text, visible);
+        g_free(visible);
+        what = _("Visible log lines copied to clipboard");
+    }
+
+    GtkClipboard *clipboard = gtk_clipboard_get(GDK_SELECTION_CLIPBOARD);
+    gtk_clipboard_set_text(clipboard, text->str, (gint) text->len);
+    g_string_free(text, TRUE);
 
     // Mostrar mensaje de confirmación
     GtkWidget *dialog = gtk_message_dialog_new(GTK_WINDOW(app->window),
                                                GTK_DIALOG_MODAL,
                                                GTK_MESSAGE_INFO,
                                                GTK_BUTTONS_OK,
-                                               _("Installation log copied to clipboard"));
+                                               "%s", what);
     gtk_dialog_run(GTK_DIALOG(dialog));
     gtk_widget_destroy(dialog);
 }
 
+/*
+ * Guarda la copia comprimida del log. El fichero ya está escrito por el hilo
+ * del LogSink: basta cerrar el frame en curso y copiarlo, sin cargarlo en memoria.
+ */
+void save_log_to_file(InstallerApp *app) {
+    LogSink *sink = logstore_sink(app->log_store);
+    GError *error = NULL;
+
+    if (!sink || !logsink_sync(sink)) {
+        g_set_error_literal(&error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                            _("The compressed log is not available"));
+    } else {
+        GtkWidget *chooser = gtk_file_chooser_dialog_new(_("Save Installation Log"),
+                                                         GTK_WINDOW(app->window),
+                                                         GTK_FILE_CHOOSER_ACTION_SAVE,
+                                                         _("_Cancel"), GTK_RESPONSE_CANCEL,
+                                                         _("_Save"), GTK_RESPONSE_ACCEPT,
+                                                         NULL);
+        gtk_file_chooser_set_do_overwrite_confirmation(GTK_FILE_CHOOSER(chooser), TRUE);
+
+        GDateTime *now = g_date_time_new_now_local();
+        gchar *name = g_date_time_format(now, "loc-installer-%Y%m%d-%H%M%S.log.zst");
+        gtk_file_chooser_set_current_name(GTK_FILE_CHOOSER(chooser), name);
+        g_free(name);
+        g_date_time_unref(now);
+
+        if (gtk_dialog_run(GTK_DIALOG(chooser)) == GTK_RESPONSE_ACCEPT) {
+            GFile *src = g_file_new_for_path(logsink_path(sink));
+            GFile *dst = gtk_file_chooser_get_file(GTK_FILE_CHOOSER(chooser));
+            g_file_copy(src, dst, G_FILE_COPY_OVERWRITE, NULL, NULL, NULL, &error);
+            g_object_unref(src);
+            g_object_unref(dst);
+        }
+        gtk_widget_destroy(chooser);
+    }
+
+    if (error) {
+        GtkWidget *dialog = gtk_message_dialog_new(GTK_WINDOW(app->window),
+                                                   GTK_DIALOG_MODAL,
+                                                   GTK_MESSAGE_ERROR,
+                                                   GTK_BUTTONS_OK,
+                                                   _("Could not save the log: %s"),
+                                                   error->message);
+        gtk_dialog_run(GTK_DIALOG(dialog));
+        gtk_widget_destroy(dialog);
+        g_error_free(error);
+    }
+}
+
 // Función para configurar el teclado actual en la UI
-void setup_current_keyboard_in_ui(InstallerApp *app) {
+void setup_current_keyboard_in_ui(InstallerApp *app, StrTable *layouts) {
     if (!app || !app->keyboard_combo) return;
 
     // Obtener teclado actual del sistema
@@ -110,38 +440,12 @@ void setup_current_keyboard_in_ui(InstallerApp *app) {
 
     printf("DEBUG: Current system keyboard: '%s'\n", current_kb);
 
-    // Buscar y seleccionar el teclado actual en el combo
-    GtkTreeModel *model = gtk_combo_box_get_model(GTK_COMBO_BOX(app->keyboard_combo));
-    GtkTreeIter iter;
-    int index = 0;
-    int found_index = 0;
-
-    if (gtk_tree_model_get_iter_first(model, &iter)) {
-        do {
-            gchar *item_text;
-            gtk_tree_model_get(model, &iter, 0, &item_text, -1);
-
-            if (item_text) {
-                // Extraer código del formato "code - description"
-                char *dash = strstr(item_text, " - ");
-                if (dash) {
-                    // Cortar temporalmente para comparar
-                    *dash = '\0';
-
-                    if (strcmp(current_kb, item_text) == 0) {
-                        found_index = index;
-                        // Restaurar
-                        *dash = ' ';
-                        g_free(item_text);
-                        break;
-                    }
-                    // Restaurar
-                    *dash = ' ';
-                }
-                g_free(item_text);
-            }
-            index++;
-        } while (gtk_tree_model_iter_next(model, &iter));
+    // Buscar el teclado actual por su código ("code - description"); las
+    // posiciones de la tabla son las del combo
+    strtable_index(layouts, " ");
+    int found_index = strtable_find(layouts, current_kb);
+    if (found_index < 0) {
+        found_index = 0;
     }
 
     // Establecer la selección
@@ -206,47 +510,27 @@ GtkWidget* create_regional_tab(InstallerApp *app) {
     gtk_grid_attach(GTK_GRID(grid), label, 0, 0, 1, 1);
 
     app->language_combo = gtk_combo_box_text_new();
-    int lang_count;
-    char **languages = get_languages(&lang_count);
-    if (languages) {
-        for (int i = 0; i < lang_count; i++) {
-            gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(app->language_combo), languages[i]);
-        }
-        free_string_array(languages, lang_count);
-    } else {
-        gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(app->language_combo), "en_US - English (United States)");
-        gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(app->language_combo), "es_ES - Spanish (Spain)");
-        gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(app->language_combo), "fr_FR - French (France)");
+    StrTable *languages = get_languages();
+    if (strtable_count(languages) == 0) {
+        strtable_free(languages);
+        languages = strtable_new();
+        strtable_add(languages, "en_US - English (United States)");
+        strtable_add(languages, "es_ES - Spanish (Spain)");
+        strtable_add(languages, "fr_FR - French (France)");
+    }
+    for (int i = 0; i < strtable_count(languages); i++) {
+        gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(app->language_combo),
+                                       strtable_get(languages, i));
     }
 
+    // Mismo código que extract_code(): hasta el primer espacio, guión o paréntesis
     char *current_lang_code = get_current_language();
-    int lang_pos = 0;
-    int found_pos = 0;
-
-    GtkTreeModel *model = gtk_combo_box_get_model(GTK_COMBO_BOX(app->language_combo));
-    GtkTreeIter iter;
-
-    if (gtk_tree_model_get_iter_first(model, &iter)) {
-        do {
-            gchar *item_text;
-            gtk_tree_model_get(model, &iter, 0, &item_text, -1);
-
-            char *code = extract_code(item_text);
-            if (code && strcmp(code, current_lang_code) == 0) {
-                found_pos = lang_pos;
-                free(code);
-                g_free(item_text);
-                break;
-            }
-
-            free(code);
-            g_free(item_text);
-            lang_pos++;
-        } while (gtk_tree_model_iter_next(model, &iter));
-    }
+    strtable_index(languages, " -(");
+    int found_pos = strtable_find(languages, current_lang_code);
 
-    gtk_combo_box_set_active(GTK_COMBO_BOX(app->language_combo), found_pos);
+    gtk_combo_box_set_active(GTK_COMBO_BOX(app->language_combo), found_pos >= 0 ? found_pos : 0);
     free(current_lang_code);
+    strtable_free(languages);
     gtk_grid_attach(GTK_GRID(grid), app->language_combo, 1, 0, 2, 1);
 
     /* Timezone */
@@ -270,9 +554,9 @@ GtkWidget* create_regional_tab(InstallerApp *app) {
 
     load_timezones_hierarchical(app);
 
-    for (int i = 0; i < app->region_count; i++) {
+    for (int i = 0; i < strtable_count(app->tz_regions); i++) {
         gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(app->region_combo),
-                                       app->region_names[i]);
+                                       strtable_get(app->tz_regions, i));
     }
 
     g_signal_connect(app->region_combo, "changed",
@@ -293,13 +577,13 @@ GtkWidget* create_regional_tab(InstallerApp *app) {
         default_region = current_tz;
     }
 
-    int region_idx = find_combo_item(GTK_COMBO_BOX_TEXT(app->region_combo), default_region);
+    int region_idx = strtable_find(app->tz_regions, default_region);
     if (region_idx >= 0) {
         gtk_combo_box_set_active(GTK_COMBO_BOX(app->region_combo), region_idx);
         on_region_changed(GTK_COMBO_BOX(app->region_combo), app);
 
         if (default_city[0]) {
-            int city_idx = find_combo_item(GTK_COMBO_BOX_TEXT(app->city_combo), default_city);
+            int city_idx = strtable_find(app->tz_cities[region_idx], default_city);
             if (city_idx >= 0) {
                 gtk_combo_box_set_active(GTK_COMBO_BOX(app->city_combo), city_idx);
             }
@@ -316,22 +600,18 @@ GtkWidget* create_regional_tab(InstallerApp *app) {
     app->keyboard_combo = gtk_combo_box_text_new();
 
     // Cargar layouts
-    int kb_count;
-    char **keyboards = get_keyboard_layouts(&kb_count);
-    if (keyboards) {
-        for (int i = 0; i < kb_count; i++) {
-            gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(app->keyboard_combo),
-                                           keyboards[i]);
-        }
-        free_string_array(keyboards, kb_count);
-    } else {
+    StrTable *keyboards = get_keyboard_layouts();
+    if (strtable_count(keyboards) == 0) {
         // Fallback
+        strtable_free(keyboards);
+        keyboards = strtable_new();
+        strtable_add(keyboards, "us - English (US)");
+        strtable_add(keyboards, "es - Spanish");
+        strtable_add(keyboards, "latam - Spanish (Latin America)");
+    }
+    for (int i = 0; i < strtable_count(keyboards); i++) {
         gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(app->keyboard_combo),
-                                       "us - English (US)");
-        gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(app->keyboard_combo),
-                                       "es - Spanish");
-        gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(app->keyboard_combo),
-                                       "latam - Spanish (Latin America)");
+                                       strtable_get(keyboards, i));
     }
 
     gtk_grid_attach(GTK_GRID(grid), app->keyboard_combo, 1, 2, 2, 1);
@@ -359,7 +639,8 @@ GtkWidget* create_regional_tab(InstallerApp *app) {
                      G_CALLBACK(on_keyboard_variant_changed), app);
 
     // Configurar teclado actual DESPUÉS de conectar las señales
-    setup_current_keyboard_in_ui(app);
+    setup_current_keyboard_in_ui(app, keyboards);
+    strtable_free(keyboards);
 
     gtk_box_pack_start(GTK_BOX(vbox), grid, FALSE, FALSE, 10);
     gtk_box_pack_start(GTK_BOX(vbox), gtk_label_new(""), TRUE, TRUE, 0);
@@ -419,17 +700,19 @@ GtkWidget* create_partition_tab(InstallerApp *app) {
     gtk_grid_attach(GTK_GRID(auto_grid), label, 0, row, 1, 1);
 
     app->disk_combo = gtk_combo_box_text_new();
-    int disk_count;
-    char **disks = get_disks(&disk_count);
-    if (disks) {
+    app->raid_disks_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
+    StrTable *disks = get_disks();
+    int disk_count = strtable_count(disks);
+    if (disk_count > 0) {
         printf("DEBUG: Found %d disks\n", disk_count);
 
         for (int i = 0; i < disk_count; i++) {
-            printf("DEBUG: Raw disk string [%d]: '%s'\n", i, disks[i]);
+            const char *disk = strtable_get(disks, i);
+            printf("DEBUG: Raw disk string [%d]: '%s'\n", i, disk);
 
             // Hacer una copia para no modificar el original
             char disk_copy[512];
-            strncpy(disk_copy, disks[i], sizeof(disk_copy) - 1);
+            strncpy(disk_copy, disk, sizeof(disk_copy) - 1);
             disk_copy[sizeof(disk_copy) - 1] = '\0';
 
             char *pipe1 = strchr(disk_copy, '|');
@@ -475,25 +758,87 @@ GtkWidget* create_partition_tab(InstallerApp *app) {
                                           device_name,      // ID: "/dev/sda"
                                           display_text);    // Texto: "/dev/sda - 10G - QEMU HARDDISK disk ata"
 
+                // Mismo disco como posible miembro del RAID
+                GtkWidget *raid_disk = gtk_check_button_new_with_label(display_text);
+                g_object_set_data_full(G_OBJECT(raid_disk), "device", g_strdup(device_name), g_free);
+                gtk_box_pack_start(GTK_BOX(app->raid_disks_box), raid_disk, FALSE, FALSE, 0);
+
                                           g_free(display_text);
             } else {
-                printf("  DEBUG: No pipe found, using whole string: '%s'\n", disks[i]);
+                printf("  DEBUG: No pipe found, using whole string: '%s'\n", disk);
                 gtk_combo_box_text_append(GTK_COMBO_BOX_TEXT(app->disk_combo),
-                                          disks[i], disks[i]);
+                                          disk, disk);
+
+                GtkWidget *raid_disk = gtk_check_button_new_with_label(disk);
+                g_object_set_data_full(G_OBJECT(raid_disk), "device", g_strdup(disk), g_free);
+                gtk_box_pack_start(GTK_BOX(app->raid_disks_box), raid_disk, FALSE, FALSE, 0);
             }
         }
-
-        free_string_array(disks, disk_count);
     } else {
         printf("DEBUG: No disks detected!\n");
         gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(app->disk_combo), "");
         gtk_label_new(_("Sorry, no disks detected"));
     }
+    strtable_free(disks);
     gtk_combo_box_set_active(GTK_COMBO_BOX(app->disk_combo), 0);
     g_signal_connect(app->disk_combo, "changed", G_CALLBACK(on_disk_changed), app);
     gtk_grid_attach(GTK_GRID(auto_grid), app->disk_combo, 1, row, 2, 1);
     row++;
 
+    /* Sistema de ficheros: solo los que el sistema en vivo sabe crear */
+    label = gtk_label_new(_("Filesystem:"));
+    gtk_label_set_xalign(GTK_LABEL(label), 0);
+    gtk_grid_attach(GTK_GRID(auto_grid), label, 0, row, 1, 1);
+
+    static const struct { const char *id; const char *text; } filesystems[] = {
+        { "ext4",  N_("ext4") },
+        { "btrfs", N_("Btrfs - zstd compression, fewer bytes written") },
+        { "xfs",   N_("XFS") },
+        { "f2fs",  N_("F2FS - for flash storage, zstd compression") },
+    };
+
+    app->root_fs_combo = gtk_combo_box_text_new();
+    for (size_t i = 0; i < G_N_ELEMENTS(filesystems); i++) {
+        gchar *mkfs = g_strdup_printf("mkfs.%s", filesystems[i].id);
+        gchar *path = g_find_program_in_path(mkfs);
+        if (path || strcmp(filesystems[i].id, "ext4") == 0) {
+            gtk_combo_box_text_append(GTK_COMBO_BOX_TEXT(app->root_fs_combo),
+                                      filesystems[i].id, _(filesystems[i].text));
+        }
+        g_free(path);
+        g_free(mkfs);
+    }
+    gtk_combo_box_set_active_id(GTK_COMBO_BOX(app->root_fs_combo), app->config.root_fs);
+    gtk_grid_attach(GTK_GRID(auto_grid), app->root_fs_combo, 1, row, 2, 1);
+    row++;
+
+    /* RAID por software: solo con más de un disco */
+    app->raid_check = gtk_check_button_new_with_label(_("Use several disks (software RAID)"));
+    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(app->raid_check), FALSE);
+    gtk_widget_set_sensitive(app->raid_check, disk_count > 1);
+    g_signal_connect(app->raid_check, "toggled", G_CALLBACK(on_raid_toggled), app);
+    gtk_grid_attach(GTK_GRID(auto_grid), app->raid_check, 0, row, 3, 1);
+    row++;
+
+    app->raid_options_container = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
+    gtk_widget_set_margin_start(app->raid_options_container, 20);
+
+    app->raid_level_combo = gtk_combo_box_text_new();
+    gtk_combo_box_text_append(GTK_COMBO_BOX_TEXT(app->raid_level_combo), "0",
+                              _("RAID 0 - Striped (faster, no redundancy)"));
+    gtk_combo_box_text_append(GTK_COMBO_BOX_TEXT(app->raid_level_combo), "1",
+                              _("RAID 1 - Mirrored (survives a disk failure)"));
+    gtk_combo_box_set_active_id(GTK_COMBO_BOX(app->raid_level_combo), "1");
+
+    GtkWidget *raid_disks_label = gtk_label_new(_("Also use:"));
+    gtk_label_set_xalign(GTK_LABEL(raid_disks_label), 0);
+
+    gtk_box_pack_start(GTK_BOX(app->raid_options_container), app->raid_level_combo, FALSE, FALSE, 0);
+    gtk_box_pack_start(GTK_BOX(app->raid_options_container), raid_disks_label, FALSE, FALSE, 0);
+    gtk_box_pack_start(GTK_BOX(app->raid_options_container), app->raid_disks_box, FALSE, FALSE, 0);
+    gtk_grid_attach(GTK_GRID(auto_grid), app->raid_options_container, 0, row, 3, 1);
+    row++;
+
     /* UEFI detection info */
     GtkWidget *uefi_label;
     if (app->config.uefi_mode) {
@@ -710,6 +1055,11 @@ GtkWidget* create_partition_tab(InstallerApp *app) {
 
     gtk_box_pack_start(GTK_BOX(vbox), scrolled, TRUE, TRUE, 10);
 
+    /* Otros sistemas en el menú de arranque (detectados por el instalador, sin os-prober) */
+    app->other_os_check = gtk_check_button_new_with_label(_("Add other operating systems to the boot menu"));
+    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(app->other_os_check), app->config.probe_other_os);
+    gtk_box_pack_start(GTK_BOX(vbox), app->other_os_check, FALSE, FALSE, 0);
+
     return vbox;
 }
 
@@ -869,6 +1219,29 @@ GtkWidget* create_progress_tab(InstallerApp *app) {
     GtkWidget *log_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
     gtk_container_set_border_width(GTK_CONTAINER(log_box), 10);
 
+    /* Search and paging over the full log file */
+    GtkWidget *log_tools = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 5);
+
+    app->log_search_entry = gtk_search_entry_new();
+    gtk_entry_set_placeholder_text(GTK_ENTRY(app->log_search_entry), _("Search log"));
+    g_signal_connect(app->log_search_entry, "activate", G_CALLBACK(on_log_search_activate), app);
+    g_signal_connect(app->log_search_entry, "search-changed", G_CALLBACK(on_log_search_changed), app);
+    g_signal_connect(app->log_search_entry, "next-match", G_CALLBACK(on_log_next_match), app);
+    g_signal_connect(app->log_search_entry, "previous-match", G_CALLBACK(on_log_previous_match), app);
+    gtk_box_pack_start(GTK_BOX(log_tools), app->log_search_entry, TRUE, TRUE, 0);
+
+    GtkWidget *older_btn = gtk_button_new_with_label(_("Older"));
+    GtkWidget *newer_btn = gtk_button_new_with_label(_("Newer"));
+    GtkWidget *latest_btn = gtk_button_new_with_label(_("Latest"));
+    g_signal_connect(older_btn, "clicked", G_CALLBACK(on_log_older_clicked), app);
+    g_signal_connect(newer_btn, "clicked", G_CALLBACK(on_log_newer_clicked), app);
+    g_signal_connect(latest_btn, "clicked", G_CALLBACK(on_log_latest_clicked), app);
+    gtk_box_pack_start(GTK_BOX(log_tools), older_btn, FALSE, FALSE, 0);
+    gtk_box_pack_start(GTK_BOX(log_tools), newer_btn, FALSE, FALSE, 0);
+    gtk_box_pack_start(GTK_BOX(log_tools), latest_btn, FALSE, FALSE, 0);
+
+    gtk_box_pack_start(GTK_BOX(log_box), log_tools, FALSE, FALSE, 0);
+
     app->log_scrolled_window = gtk_scrolled_window_new(NULL, NULL);
     gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(app->log_scrolled_window),
                                    GTK_POLICY_AUTOMATIC,
@@ -878,9 +1251,12 @@ GtkWidget* create_progress_tab(InstallerApp *app) {
     app->log_text_view = gtk_text_view_new();
     gtk_text_view_set_editable(GTK_TEXT_VIEW(app->log_text_view), FALSE);
     gtk_text_view_set_monospace(GTK_TEXT_VIEW(app->log_text_view), TRUE);
-    gtk_text_view_set_wrap_mode(GTK_TEXT_VIEW(app->log_text_view), GTK_WRAP_WORD_CHAR);
+    // Sin ajuste de línea: el reflow de líneas largas (set -x) es lo más caro del redibujado
+    gtk_text_view_set_wrap_mode(GTK_TEXT_VIEW(app->log_text_view), GTK_WRAP_NONE);
 
     app->log_buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(app->log_text_view));
+    app->log_match_tag = gtk_text_buffer_create_tag(app->log_buffer, "search-match",
+                                                    "background", "yellow", NULL);
 
     gtk_container_add(GTK_CONTAINER(app->log_scrolled_window), app->log_text_view);
     gtk_box_pack_start(GTK_BOX(log_box), app->log_scrolled_window, TRUE, TRUE, 0);
@@ -889,7 +1265,15 @@ GtkWidget* create_progress_tab(InstallerApp *app) {
     app->copy_log_btn = gtk_button_new_with_label(_("Copy Log to Clipboard"));
     g_signal_connect_swapped(app->copy_log_btn, "clicked",
                              G_CALLBACK(copy_log_to_clipboard), app);
-    gtk_box_pack_start(GTK_BOX(log_box), app->copy_log_btn, FALSE, FALSE, 5);
+
+    /* Save compressed log button */
+    GtkWidget *log_buttons = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 5);
+    GtkWidget *save_log_btn = gtk_button_new_with_label(_("Save Log..."));
+    g_signal_connect_swapped(save_log_btn, "clicked",
+                             G_CALLBACK(save_log_to_file), app);
+    gtk_box_pack_start(GTK_BOX(log_buttons), app->copy_log_btn, TRUE, TRUE, 0);
+    gtk_box_pack_start(GTK_BOX(log_buttons), save_log_btn, TRUE, TRUE, 0);
+    gtk_box_pack_start(GTK_BOX(log_box), log_buttons, FALSE, FALSE, 5);
 
     gtk_container_add(GTK_CONTAINER(log_frame), log_box);
     gtk_box_pack_start(GTK_BOX(vbox), log_frame, TRUE, TRUE, 10);
@@ -923,11 +1307,44 @@ void append_to_log(InstallerApp *app, const char *text) {
     }
 }
 
+/* Construye el contenido de una pestaña la primera vez que se necesita. La de
+ * particionado lista discos y particiones: así no retrasa la primera ventana */
+void ensure_tab_built(InstallerApp *app, int page) {
+    if (page < 0 || page >= TAB_COUNT || app->tab_built[page]) return;
+    app->tab_built[page] = true;
+
+    gint64 start = g_get_monotonic_time();
+    GtkWidget *content = NULL;
+    switch (page) {
+        case TAB_REGIONAL:     content = create_regional_tab(app); break;
+        case TAB_PARTITIONING: content = create_partition_tab(app); break;
+        case TAB_USER:         content = create_user_tab(app); break;
+        case TAB_PROGRESS:     content = create_progress_tab(app); break;
+    }
+
+    gtk_box_pack_start(GTK_BOX(app->tab_pages[page]), content, TRUE, TRUE, 0);
+    gtk_widget_show_all(content);
+
+    // Ocultar los contenedores que dependen de opciones aún sin marcar
+    if (page == TAB_PARTITIONING) {
+        gtk_widget_hide(app->home_combo_container);
+        gtk_widget_hide(app->boot_combo_container);
+        gtk_widget_hide(app->swap_combo_container);
+        gtk_widget_hide(app->swap_options_container);
+        gtk_widget_hide(app->raid_options_container);
+    } else if (page == TAB_USER) {
+        gtk_widget_hide(app->root_password_container);
+    }
+
+    startup_timing_mark("tab %d built in %.1f ms", page, (g_get_monotonic_time() - start) / 1000.0);
+}
+
 void create_main_window(InstallerApp *app) {
     app->window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
     gtk_window_set_title(GTK_WINDOW(app->window), _("LOC-OS 24 Installer"));
     gtk_window_set_default_size(GTK_WINDOW(app->window), 800, 650);
     gtk_window_set_position(GTK_WINDOW(app->window), GTK_WIN_POS_CENTER);
+    g_signal_connect(app->window, "delete-event", G_CALLBACK(on_window_delete), app);
     g_signal_connect(app->window, "destroy", G_CALLBACK(on_window_destroy), app);
 
     GtkWidget *vbox = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
@@ -949,19 +1366,13 @@ void create_main_window(InstallerApp *app) {
     gtk_notebook_set_show_tabs(GTK_NOTEBOOK(app->notebook), FALSE);
     gtk_notebook_set_show_border(GTK_NOTEBOOK(app->notebook), FALSE);
 
-    /* Añadir pestañas al notebook usando NULL como etiqueta ya que no se muestran */
-    gtk_notebook_append_page(GTK_NOTEBOOK(app->notebook),
-                             create_regional_tab(app),
-                             NULL);
-    gtk_notebook_append_page(GTK_NOTEBOOK(app->notebook),
-                             create_partition_tab(app),
-                             NULL);
-    gtk_notebook_append_page(GTK_NOTEBOOK(app->notebook),
-                             create_user_tab(app),
-                             NULL);
-    gtk_notebook_append_page(GTK_NOTEBOOK(app->notebook),
-                             create_progress_tab(app),
-                             NULL);
+    /* Añadir pestañas al notebook usando NULL como etiqueta ya que no se muestran.
+     * Cada página es un contenedor vacío; solo la primera se llena ahora */
+    for (int i = 0; i < TAB_COUNT; i++) {
+        app->tab_pages[i] = gtk_box_new(GTK_ORIENTATION_VERTICAL, 0);
+        gtk_notebook_append_page(GTK_NOTEBOOK(app->notebook), app->tab_pages[i], NULL);
+    }
+    ensure_tab_built(app, TAB_REGIONAL);
 
     /* IMPORTANTE: Conectar señal de cambio de página */
     g_signal_connect(app->notebook, "switch-page",
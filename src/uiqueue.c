@@ -0,0 +1,78 @@
+/*
+ * uiqueue.c - SPSC ring for install thread -> UI messages (sin dependencias de GTK)
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "uiqueue.h"
+
+#define UI_QUEUE_MASK       (UI_QUEUE_SLOTS - 1)
+#define UI_QUEUE_WAIT_US    1000
+
+UiQueue* ui_queue_new(void) {
+    UiQueue *q = aligned_alloc(64, sizeof(UiQueue));
+    if (!q) return NULL;
+
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    atomic_init(&q->closed, false);
+    return q;
+}
+
+void ui_queue_free(UiQueue *q) {
+    free(q);
+}
+
+void ui_queue_reset(UiQueue *q) {
+    atomic_store(&q->tail, atomic_load(&q->head));
+    atomic_store(&q->closed, false);
+}
+
+/* ==================== PRODUCER ==================== */
+
+void ui_queue_push(UiQueue *q, UiMessageKind kind, int percent, const char *text) {
+    size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+
+    // Lleno: esperar a que el hilo principal vacíe un lote. Si la cola ya está
+    // cerrada nadie la va a vaciar: el mensaje se descarta
+    while (head - atomic_load_explicit(&q->tail, memory_order_acquire) >= UI_QUEUE_SLOTS) {
+        if (atomic_load_explicit(&q->closed, memory_order_acquire)) return;
+        usleep(UI_QUEUE_WAIT_US);
+    }
+
+    UiMessage *msg = &q->slots[head & UI_QUEUE_MASK];
+    msg->kind = kind;
+    msg->percent = percent;
+    if (text) {
+        size_t len = strnlen(text, sizeof(msg->text) - 1);
+        memcpy(msg->text, text, len);
+        msg->text[len] = '\0';
+    } else {
+        msg->text[0] = '\0';
+    }
+
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+}
+
+void ui_queue_close(UiQueue *q) {
+    atomic_store_explicit(&q->closed, true, memory_order_release);
+}
+
+/* ==================== CONSUMER ==================== */
+
+const UiMessage* ui_queue_peek(UiQueue *q) {
+    size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    if (tail == atomic_load_explicit(&q->head, memory_order_acquire)) return NULL;
+    return &q->slots[tail & UI_QUEUE_MASK];
+}
+
+void ui_queue_release(UiQueue *q) {
+    size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+}
+
+bool ui_queue_finished(UiQueue *q) {
+    // closed se lee antes que head: todo lo encolado antes de cerrar es visible
+    return atomic_load_explicit(&q->closed, memory_order_acquire) && ui_queue_peek(q) == NULL;
+}
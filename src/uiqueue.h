@@ -0,0 +1,62 @@
+#ifndef UIQUEUE_H
+#define UIQUEUE_H
+
+/*
+ * uiqueue.h - Single-producer/single-consumer ring between the install
+ * thread and the GTK main loop (sin dependencias de GTK)
+ *
+ * El hilo de instalación encola mensajes sin reservar memoria ni tocar el
+ * bucle de GTK; un temporizador en el hilo principal los vacía por lotes
+ * (UI_DRAIN_INTERVAL_MS) y aplica todas las líneas de log, pero solo el
+ * último progreso y el último estado.
+ *
+ * Si el anillo se llena, el productor espera: la salida del instalador
+ * se frena en su tubería en lugar de perder líneas. Con la cola cerrada
+ * (consumidor desaparecido) y llena, los mensajes se descartan.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#define UI_QUEUE_SLOTS          1024    /* potencia de 2 */
+#define UI_MESSAGE_TEXT         1024
+#define UI_DRAIN_INTERVAL_MS    33      /* ~30 Hz */
+
+typedef enum {
+    UI_MSG_LOG = 0,             /* añadir línea al log */
+    UI_MSG_LOG_REPLACE,         /* sustituir la última línea del log */
+    UI_MSG_CLEAR_LOG,
+    UI_MSG_STATUS,
+    UI_MSG_PROGRESS
+} UiMessageKind;
+
+typedef struct {
+    UiMessageKind kind;
+    int percent;
+    char text[UI_MESSAGE_TEXT];
+} UiMessage;
+
+typedef struct {
+    _Alignas(64) atomic_size_t head;    /* solo lo escribe el productor */
+    _Alignas(64) atomic_size_t tail;    /* solo lo escribe el consumidor */
+    _Alignas(64) atomic_bool closed;
+    UiMessage slots[UI_QUEUE_SLOTS];
+} UiQueue;
+
+UiQueue* ui_queue_new(void);
+void ui_queue_free(UiQueue *q);
+
+/* Vacía la cola y la vuelve a abrir. Solo sin productor activo. */
+void ui_queue_reset(UiQueue *q);
+
+/* Productor */
+void ui_queue_push(UiQueue *q, UiMessageKind kind, int percent, const char *text);
+void ui_queue_close(UiQueue *q);
+
+/* Consumidor: peek devuelve NULL si está vacía; release libera el hueco */
+const UiMessage* ui_queue_peek(UiQueue *q);
+void ui_queue_release(UiQueue *q);
+bool ui_queue_finished(UiQueue *q);
+
+#endif /* UIQUEUE_H */
@@ -0,0 +1,410 @@
+/*
+ * userdb.c - User database rewriter for LOC-OS 24 Installer
+ *
+ * Carga passwd, shadow, group y gshadow del sistema destino una sola vez,
+ * aplica en memoria el renombrado del usuario, el cambio de home, la
+ * pertenencia a grupos y las contraseñas, y escribe cada fichero modificado
+ * de forma atómica (temporal + fsync + rename) exactamente una vez.
+ *
+ * Uso:
+ *   loc-userdb --root=/mnt/installer [--rename=OLD:NEW] [--home=USER:DIR]
+ *              [--add-groups=USER:G1,G2,...] [--passwords-from-stdin]
+ *
+ * Con --passwords-from-stdin lee líneas "usuario:contraseña" (formato chpasswd)
+ * y guarda el hash con el método por defecto de libcrypt.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <crypt.h>
+
+#define MAX_FIELDS  10
+#define MAX_GROUPS  32
+
+typedef struct {
+    char path[4096];
+    char **lines;
+    int count;
+    int capacity;
+    bool changed;
+    bool exists;
+    struct stat st;
+} DbFile;
+
+typedef struct {
+    char *fields[MAX_FIELDS];
+    int count;
+} Entry;
+
+enum { DB_PASSWD, DB_SHADOW, DB_GROUP, DB_GSHADOW, DB_COUNT };
+
+static const char *db_names[DB_COUNT] = {
+    "/etc/passwd", "/etc/shadow", "/etc/group", "/etc/gshadow"
+};
+
+/* ==================== HELPERS ==================== */
+
+static void die(const char *fmt, const char *arg) {
+    fprintf(stderr, "loc-userdb: ");
+    fprintf(stderr, fmt, arg);
+    fprintf(stderr, "\n");
+    exit(EXIT_FAILURE);
+}
+
+static char* xstrdup(const char *s) {
+    char *copy = strdup(s);
+    if (!copy) die("%s", "out of memory");
+    return copy;
+}
+
+/* Divide una línea "a:b:c" en campos (modifica la copia recibida) */
+static void split_entry(char *line, Entry *entry) {
+    entry->count = 0;
+    char *p = line;
+    while (entry->count < MAX_FIELDS) {
+        entry->fields[entry->count++] = p;
+        char *colon = strchr(p, ':');
+        if (!colon) break;
+        *colon = '\0';
+        p = colon + 1;
+    }
+}
+
+static char* join_entry(const Entry *entry) {
+    size_t len = 0;
+    for (int i = 0; i < entry->count; i++) len += strlen(entry->fields[i]) + 1;
+
+    char *line = malloc(len + 1);
+    if (!line) die("%s", "out of memory");
+
+    line[0] = '\0';
+    for (int i = 0; i < entry->count; i++) {
+        if (i > 0) strcat(line, ":");
+        strcat(line, entry->fields[i]);
+    }
+    return line;
+}
+
+/* Sustituye el campo idx de la línea n por value */
+static void set_field(DbFile *db, int n, int idx, const char *value) {
+    char *copy = xstrdup(db->lines[n]);
+    Entry entry;
+    split_entry(copy, &entry);
+
+    if (idx >= entry.count) {
+        free(copy);
+        return;
+    }
+    if (strcmp(entry.fields[idx], value) != 0) {
+        entry.fields[idx] = (char *) value;
+        free(db->lines[n]);
+        db->lines[n] = join_entry(&entry);
+        db->changed = true;
+    }
+    free(copy);
+}
+
+static int find_entry(const DbFile *db, const char *name) {
+    size_t len = strlen(name);
+    for (int i = 0; i < db->count; i++) {
+        if (strncmp(db->lines[i], name, len) == 0 && db->lines[i][len] == ':') {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* ==================== LOAD / SAVE ==================== */
+
+static void db_load(DbFile *db, const char *root, const char *name) {
+    memset(db, 0, sizeof(*db));
+    snprintf(db->path, sizeof(db->path), "%s%s", root, name);
+
+    FILE *fp = fopen(db->path, "r");
+    if (!fp) {
+        if (errno == ENOENT) return;
+        die("cannot open %s", db->path);
+    }
+    db->exists = true;
+    fstat(fileno(fp), &db->st);
+
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+    while ((len = getline(&line, &cap, fp)) != -1) {
+        if (len > 0 && line[len - 1] == '\n') line[len - 1] = '\0';
+        if (db->count == db->capacity) {
+            db->capacity = db->capacity ? db->capacity * 2 : 64;
+            db->lines = realloc(db->lines, db->capacity * sizeof(char *));
+            if (!db->lines) die("%s", "out of memory");
+        }
+        db->lines[db->count++] = xstrdup(line);
+    }
+    free(line);
+    fclose(fp);
+}
+
+/* Escritura atómica: temporal en el mismo directorio, mismo modo y dueño, fsync, rename */
+static void db_save(DbFile *db) {
+    if (!db->exists || !db->changed) return;
+
+    char tmp[sizeof(db->path) + 16];
+    if (snprintf(tmp, sizeof(tmp), "%s.loc-tmp", db->path) >= (int) sizeof(tmp)) {
+        die("path too long: %s", db->path);
+    }
+
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) die("cannot create %s", tmp);
+
+    FILE *fp = fdopen(fd, "w");
+    if (!fp) die("cannot write %s", tmp);
+
+    for (int i = 0; i < db->count; i++) {
+        fputs(db->lines[i], fp);
+        fputc('\n', fp);
+    }
+
+    if (fflush(fp) != 0 ||
+        fchown(fd, db->st.st_uid, db->st.st_gid) != 0 ||
+        fchmod(fd, db->st.st_mode & 07777) != 0 ||
+        fsync(fd) != 0) {
+        unlink(tmp);
+        die("cannot write %s", tmp);
+    }
+    fclose(fp);
+
+    if (rename(tmp, db->path) != 0) {
+        unlink(tmp);
+        die("cannot replace %s", db->path);
+    }
+}
+
+static void db_free(DbFile *db) {
+    for (int i = 0; i < db->count; i++) free(db->lines[i]);
+    free(db->lines);
+}
+
+/* ==================== OPERATIONS ==================== */
+
+/* Sustituye old por new en una lista "a,b,c" */
+static char* rename_in_list(const char *list, const char *old_name, const char *new_name, bool *found) {
+    // Peor caso: cada elemento de la lista se sustituye por new_name
+    size_t cap = strlen(list) + (strlen(list) + 1) * strlen(new_name) + 1;
+    char *out = malloc(cap);
+    char *copy = xstrdup(list);
+    if (!out) die("%s", "out of memory");
+    out[0] = '\0';
+    *found = false;
+
+    char *save = NULL;
+    for (char *tok = strtok_r(copy, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        if (out[0]) strcat(out, ",");
+        if (strcmp(tok, old_name) == 0) {
+            strcat(out, new_name);
+            *found = true;
+        } else {
+            strcat(out, tok);
+        }
+    }
+    free(copy);
+    return out;
+}
+
+static bool list_contains(const char *list, const char *name) {
+    size_t len = strlen(name);
+    for (const char *p = list; *p; ) {
+        if (strncmp(p, name, len) == 0 && (p[len] == ',' || p[len] == '\0')) return true;
+        p = strchr(p, ',');
+        if (!p) break;
+        p++;
+    }
+    return false;
+}
+
+/* Renombra la entrada y sus referencias en las listas de miembros (campos first_list..last_list) */
+static void rename_in_db(DbFile *db, const char *old_name, const char *new_name,
+                         int first_list, int last_list) {
+    int n = find_entry(db, old_name);
+    if (n >= 0) set_field(db, n, 0, new_name);
+
+    if (first_list < 0) return;
+
+    for (int i = 0; i < db->count; i++) {
+        char *copy = xstrdup(db->lines[i]);
+        Entry entry;
+        split_entry(copy, &entry);
+
+        for (int f = first_list; f <= last_list && f < entry.count; f++) {
+            bool found = false;
+            char *renamed = rename_in_list(entry.fields[f], old_name, new_name, &found);
+            if (found) set_field(db, i, f, renamed);
+            free(renamed);
+        }
+        free(copy);
+    }
+}
+
+/* Añade user a la lista de miembros (campo idx) del grupo group */
+static void add_member(DbFile *db, const char *group, const char *user, int idx) {
+    int n = find_entry(db, group);
+    if (n < 0) return;
+
+    char *copy = xstrdup(db->lines[n]);
+    Entry entry;
+    split_entry(copy, &entry);
+
+    if (idx < entry.count && !list_contains(entry.fields[idx], user)) {
+        const char *members = entry.fields[idx];
+        char *updated = malloc(strlen(members) + strlen(user) + 2);
+        if (!updated) die("%s", "out of memory");
+        sprintf(updated, "%s%s%s", members, members[0] ? "," : "", user);
+        set_field(db, n, idx, updated);
+        free(updated);
+    }
+    free(copy);
+}
+
+static void set_password(DbFile *shadow, const char *user, const char *password) {
+    int n = find_entry(shadow, user);
+    if (n < 0) {
+        fprintf(stderr, "loc-userdb: user %s not found in shadow\n", user);
+        exit(EXIT_FAILURE);
+    }
+
+    const char *salt = crypt_gensalt(NULL, 0, NULL, 0);
+    if (!salt) die("%s", "cannot generate salt");
+
+    const char *hash = crypt(password, salt);
+    if (!hash || hash[0] == '*') die("cannot hash password for %s", user);
+
+    char lastchg[32];
+    snprintf(lastchg, sizeof(lastchg), "%ld", (long) (time(NULL) / 86400));
+
+    set_field(shadow, n, 1, hash);
+    set_field(shadow, n, 2, lastchg);
+}
+
+/* Divide "a:b" en dos cadenas; devuelve false si falta el separador */
+static bool split_pair(const char *arg, char **first, char **second) {
+    const char *colon = strchr(arg, ':');
+    if (!colon || colon == arg || colon[1] == '\0') return false;
+    *first = strndup(arg, colon - arg);
+    *second = xstrdup(colon + 1);
+    return *first != NULL;
+}
+
+/* ==================== MAIN ==================== */
+
+int main(int argc, char *argv[]) {
+    const char *root = "";
+    const char *rename_arg = NULL;
+    const char *home_arg = NULL;
+    const char *groups_arg[MAX_GROUPS];
+    int groups_count = 0;
+    bool passwords = false;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (strncmp(arg, "--root=", 7) == 0) {
+            root = arg + 7;
+        } else if (strncmp(arg, "--rename=", 9) == 0) {
+            rename_arg = arg + 9;
+        } else if (strncmp(arg, "--home=", 7) == 0) {
+            home_arg = arg + 7;
+        } else if (strncmp(arg, "--add-groups=", 13) == 0 && groups_count < MAX_GROUPS) {
+            groups_arg[groups_count++] = arg + 13;
+        } else if (strcmp(arg, "--passwords-from-stdin") == 0) {
+            passwords = true;
+        } else {
+            die("unknown option: %s", arg);
+        }
+    }
+
+    DbFile db[DB_COUNT];
+    for (int i = 0; i < DB_COUNT; i++) db_load(&db[i], root, db_names[i]);
+
+    if (!db[DB_PASSWD].exists) die("cannot find %s", db[DB_PASSWD].path);
+
+    // 1. Renombrar usuario y su grupo primario, y referencias en listas de miembros
+    if (rename_arg) {
+        char *old_name = NULL, *new_name = NULL;
+        if (!split_pair(rename_arg, &old_name, &new_name)) die("invalid --rename: %s", rename_arg);
+        if (find_entry(&db[DB_PASSWD], old_name) < 0) die("user not found: %s", old_name);
+        if (find_entry(&db[DB_PASSWD], new_name) >= 0) die("user already exists: %s", new_name);
+
+        rename_in_db(&db[DB_PASSWD], old_name, new_name, -1, -1);
+        rename_in_db(&db[DB_SHADOW], old_name, new_name, -1, -1);
+        rename_in_db(&db[DB_GROUP], old_name, new_name, 3, 3);      // nombre:x:gid:miembros
+        rename_in_db(&db[DB_GSHADOW], old_name, new_name, 2, 3);    // nombre:pw:admins:miembros
+
+        fprintf(stderr, "loc-userdb: renamed %s to %s\n", old_name, new_name);
+        free(old_name);
+        free(new_name);
+    }
+
+    // 2. Directorio home
+    if (home_arg) {
+        char *user = NULL, *dir = NULL;
+        if (!split_pair(home_arg, &user, &dir)) die("invalid --home: %s", home_arg);
+        int n = find_entry(&db[DB_PASSWD], user);
+        if (n < 0) die("user not found: %s", user);
+        set_field(&db[DB_PASSWD], n, 5, dir);
+        free(user);
+        free(dir);
+    }
+
+    // 3. Grupos suplementarios
+    for (int g = 0; g < groups_count; g++) {
+        char *user = NULL, *list = NULL;
+        if (!split_pair(groups_arg[g], &user, &list)) die("invalid --add-groups: %s", groups_arg[g]);
+
+        char *save = NULL;
+        for (char *group = strtok_r(list, ",", &save); group; group = strtok_r(NULL, ",", &save)) {
+            add_member(&db[DB_GROUP], group, user, 3);
+            add_member(&db[DB_GSHADOW], group, user, 3);
+        }
+        free(user);
+        free(list);
+    }
+
+    // 4. Contraseñas (formato chpasswd)
+    if (passwords) {
+        char *line = NULL;
+        size_t cap = 0;
+        ssize_t len;
+        while ((len = getline(&line, &cap, stdin)) != -1) {
+            if (len > 0 && line[len - 1] == '\n') line[len - 1] = '\0';
+            char *colon = strchr(line, ':');
+            if (!colon || colon == line) continue;
+            *colon = '\0';
+            set_password(&db[DB_SHADOW], line, colon + 1);
+        }
+        if (line) {
+            explicit_bzero(line, cap);
+            free(line);
+        }
+    }
+
+    // 5. Escribir cada fichero modificado una sola vez
+    for (int i = 0; i < DB_COUNT; i++) {
+        db_save(&db[i]);
+        db_free(&db[i]);
+    }
+
+    char etc[4096];
+    snprintf(etc, sizeof(etc), "%s/etc", root);
+    int dirfd = open(etc, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirfd >= 0) {
+        fsync(dirfd);
+        close(dirfd);
+    }
+
+    return EXIT_SUCCESS;
+}